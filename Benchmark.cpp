@@ -0,0 +1,1050 @@
+﻿/*
+    Benchmark of the JsonReader class:
+    - Measures the throughput of reading the same JSON data in indented and minified form.
+    - Measures the throughput of reading long string values.
+    - Measures the throughput of extracting one value by its path, which allows to skip the rest of elements.
+    - Measures the throughput of reading many small messages, subscribing the callbacks before each read or once.
+    - Measures the throughput of reading many small messages with a new reader for each one.
+    - Measures the throughput of reading many small messages from several threads, with a new reader for each one and
+      with readers borrowed from a pool.
+    - Measures the cost of notifying every value to a lambda expression and to a std::function. Both reach the
+      callback through one virtual call: the lambda only saves the indirection of the std::function wrapper.
+    - Measures the throughput of notifying the same values as wide strings to one and to several callbacks.
+    - Measures the throughput of converting UTF-8 text to wide strings and back, compared with <codecvt>.
+    - Measures the throughput of filling a vector of structs using callbacks and binding the objects to the struct.
+    - Measures the throughput of reading floating-point numbers, converted by the reader or by the client, one by one
+      or in batches.
+    - Measures the throughput of reading newline-delimited JSON with one thread and with one thread per core.
+    - Measures the throughput of reading one large array sequentially and in parallel.
+    - Measures the throughput of reading a file with buffers of different sizes, synchronously and read ahead.
+    - Measures the throughput of reading a gzip file, decompressed synchronously and ahead (if built with zlib).
+    - Reads a corpus of documents (similar to 'twitter.json' and 'canada.json', deep nesting, long strings and NDJSON)
+      with readFile, readBuffer and getPathsFromBuffer, reporting MB/s, events/s and allocations per MB.
+    - Run 'Benchmark corpus' or 'Benchmark features' to run only one of the suites.
+    - Build it with optimizations enabled, e.g. 'g++ -std=c++11 -O2 -pthread JsonReader.cpp Benchmark.cpp -o Benchmark'.
+    - Add the flag '-DJSONREADER_NO_SIMD' to measure the scalar version of the parser.
+*/
+
+#include "JsonReader.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <codecvt>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <locale>
+#include <new>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef JSONREADER_ZLIB
+#include <zlib.h>
+#endif
+
+// Builds a JSON object containing an array of 'numUsers' users.
+// If 'indent' is true, the elements are written in separate lines and indented with spaces.
+static std::string buildUsers(size_t numUsers, bool indent)
+{
+    const char* newLine = indent ? "\n" : "";
+    std::string pad1 = indent ? std::string(4, ' ') : "";
+    std::string pad2 = indent ? std::string(8, ' ') : "";
+    std::string pad3 = indent ? std::string(12, ' ') : "";
+    const char* separator = indent ? ": " : ":";
+    std::string json;
+
+    json += std::string("{") + newLine + pad1 + "\"users\"" + separator + "[" + newLine;
+    for (size_t i = 0; i < numUsers; i++)
+    {
+        json += pad2 + "{" + newLine;
+        json += pad3 + "\"name\"" + separator + "\"user" + std::to_string(i) + "\"," + newLine;
+        json += pad3 + "\"id\"" + separator + std::to_string(i) + "," + newLine;
+        json += pad3 + "\"active\"" + separator + (i % 2 ? "true" : "false") + newLine;
+        json += pad2 + (i + 1 < numUsers ? "}," : "}") + newLine;
+    }
+    json += pad1 + "]" + newLine + "}";
+    return json;
+}
+
+// Builds a JSON array of 'numTexts' objects, each one containing a string value of 'textLen' characters.
+static std::string buildTexts(size_t numTexts, size_t textLen)
+{
+    std::string text;
+    for (size_t i = 0; i < textLen; i++)
+        text += (char)('a' + i % 26);
+    std::string json = "[";
+    for (size_t i = 0; i < numTexts; i++)
+        json += std::string(i > 0 ? "," : "") + "{\"id\":" + std::to_string(i) + ",\"text\":\"" + text + "\"}";
+    json += "]";
+    return json;
+}
+
+// Builds a JSON array of 'numValues' floating-point numbers.
+static std::string buildNumbers(size_t numValues)
+{
+    std::string json = "[";
+    for (size_t i = 0; i < numValues; i++)
+        json += std::string(i > 0 ? "," : "") + std::to_string(i * 0.731 - 1000.0);
+    json += "]";
+    return json;
+}
+
+// Reads 'json' several times and prints the best throughput in MB/s.
+// If 'typed' is true, the array items are notified as numbers. Otherwise, they are converted with 'strtod'.
+// If 'batched' is true as well, the numbers are passed in batches.
+static void runNumbers(const char* title, const std::string& json, bool typed, bool batched = false)
+{
+    const int numRuns = 5;
+    double bestSeconds = 0;
+    double sum = 0;
+
+    for (int run = 0; run < numRuns; run++)
+    {
+        JsonReader reader;
+        if (typed && batched)
+        {
+            reader.onArrayItemsDouble("[",
+                                      [&sum](const double* values, size_t count)
+                                      {
+                                          for (size_t i = 0; i < count; i++)
+                                              sum += values[i];
+                                      });
+        }
+        else if (typed)
+            reader.onArrayItemDouble("[", [&sum](double value) { sum += value; });
+        else
+            reader.onArrayItem("[", [&sum](const char* value) { sum += strtod(value, nullptr); });
+
+        auto start = std::chrono::steady_clock::now();
+        if (!reader.readBuffer(json.c_str(), json.length()))
+        {
+            std::cout << "Error: " << reader.getErrorDescription() << std::endl;
+            return;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < bestSeconds)
+            bestSeconds = elapsed.count();
+    }
+
+    double megabytes = json.length() / (1024.0 * 1024.0);
+    std::cout << title << ":\t" << megabytes << " MB\t" << megabytes / bestSeconds << " MB/s\t(sum " << sum / numRuns
+              << ")" << std::endl;
+}
+
+// Reads 'json' several times and prints the best throughput in MB/s.
+// The values of the key 'element' (a name or a path) are counted.
+// If 'stopWhenFound' is true, the reading stops at the first value found.
+static void run(const char* title, const std::string& json, const char* element = "id", bool stopWhenFound = false)
+{
+    const int numRuns = 5;
+    double bestSeconds = 0;
+    size_t numIds = 0;
+
+    for (int run = 0; run < numRuns; run++)
+    {
+        JsonReader reader;
+        reader.onPair(element,
+                      [&](const char*)
+                      {
+                          numIds++;
+                          if (stopWhenFound)
+                              reader.stop();
+                      });
+
+        auto start = std::chrono::steady_clock::now();
+        if (!reader.readBuffer(json.c_str()))
+        {
+            std::cout << "Error: " << reader.getErrorDescription() << std::endl;
+            return;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < bestSeconds)
+            bestSeconds = elapsed.count();
+    }
+
+    double megabytes = json.length() / (1024.0 * 1024.0);
+    std::cout << title << ":\t" << megabytes << " MB\t" << megabytes / bestSeconds << " MB/s\t(" << numIds / numRuns
+              << " ids)" << std::endl;
+}
+
+// Reads 'json' several times, notifying all pairs and array items, and prints the best throughput in MB/s of
+// passing the callbacks as lambda expressions and as std::function objects. The lambdas are stored without the
+// wrapper, but both are called through the virtual 'Callback::notify'. The two kinds alternate, so that they are
+// measured under the same conditions (e.g. the warm-up of the caches and of the CPU frequency).
+static void runDispatch(const std::string& json)
+{
+    const int numRuns = 10;
+    double bestSeconds[2] = {0, 0};
+    size_t numValues = 0;
+
+    for (int run = 0; run < numRuns * 2; run++)
+    {
+        bool useStdFunction = (run % 2) != 0;
+        JsonReader reader;
+        auto count = [&numValues](const char*, size_t) { numValues++; };
+        if (useStdFunction)
+        {
+            std::function<void(const char*, size_t)> function = count;
+            reader.onPair((const char*)nullptr, function);
+            reader.onArrayItem((const char*)nullptr, function);
+        }
+        else
+        {
+            reader.onPair((const char*)nullptr, count);
+            reader.onArrayItem((const char*)nullptr, count);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if (!reader.readBuffer(json.c_str(), json.length()))
+        {
+            std::cout << "Error: " << reader.getErrorDescription() << std::endl;
+            return;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double& best = bestSeconds[useStdFunction ? 1 : 0];
+        if (run < 2 || elapsed.count() < best)
+            best = elapsed.count();
+    }
+
+    double megabytes = json.length() / (1024.0 * 1024.0);
+    const char* titles[2] = {"Dispatch (lambda)", "Dispatch (std::function)"};
+    for (int i = 0; i < 2; i++)
+        std::cout << titles[i] << ":\t" << megabytes << " MB\t" << megabytes / bestSeconds[i] << " MB/s\t("
+                  << numValues / (numRuns * 2) << " values)" << std::endl;
+}
+
+// Reads 'json' several times, notifying the names of the users as wide strings, and prints the best throughput.
+// The same value is notified to 'numCallbacks' callbacks (by name, by path and for all pairs), converted once.
+static void runWide(const char* title, const std::string& json, int numCallbacks)
+{
+    const int numRuns = 5;
+    double bestSeconds = 0;
+    size_t numChars = 0;
+
+    for (int run = 0; run < numRuns; run++)
+    {
+        JsonReader reader;
+        auto count = [&numChars](const wchar_t* value) { numChars += wcslen(value); };
+        reader.onPair(L"name", count);
+        if (numCallbacks > 1)
+            reader.onPair(L"{users[{name", count);
+        if (numCallbacks > 2)
+            reader.onPair((const wchar_t*)nullptr, count);
+
+        auto start = std::chrono::steady_clock::now();
+        if (!reader.readBuffer(json.c_str(), json.length()))
+        {
+            std::cout << "Error: " << reader.getErrorDescription() << std::endl;
+            return;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < bestSeconds)
+            bestSeconds = elapsed.count();
+    }
+
+    double megabytes = json.length() / (1024.0 * 1024.0);
+    std::cout << title << ":\t" << megabytes << " MB\t" << megabytes / bestSeconds << " MB/s\t("
+              << numChars / numRuns << " chars)" << std::endl;
+}
+
+// Builds a UTF-8 text of about 'textLen' bytes, made of ASCII characters only or mixing them with 2, 3 and 4-byte
+// characters.
+static std::string buildText(size_t textLen, bool isAscii)
+{
+    const char* words = isAscii ? "The quick brown fox jumps over the lazy dog. "
+                                : u8"Gr\u00FC\u00DFe, \u4E16\u754C! \U0001F600 The quick brown fox. ";
+    std::string text;
+    while (text.length() < textLen)
+        text += words;
+    return text;
+}
+
+// Converts 'text' to a wide string and back to UTF-8 several times, and prints the best throughput in MB/s.
+// If 'useCodecvt' is true, std::wstring_convert is used instead of JsonReader::TextConverter.
+static void runTranscoding(const char* title, const std::string& text, bool useCodecvt)
+{
+    const int numRuns = 5, numConversions = 20;
+    double bestSeconds = 0;
+    size_t numChars = 0;
+    JsonReader::TextConverter converter;
+    std::wstring_convert<std::codecvt_utf8<wchar_t>> codecvt;
+
+    for (int run = 0; run < numRuns; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < numConversions; i++)
+        {
+            if (useCodecvt)
+            {
+                std::wstring wide = codecvt.from_bytes(text);
+                numChars += codecvt.to_bytes(wide).length();
+            }
+            else
+            {
+                size_t lenWide = 0, lenUtf8 = 0;
+                const wchar_t* wide = converter.Utf8ToWide(text.c_str(), text.length(), &lenWide);
+                converter.WideToUtf8(wide, lenWide, &lenUtf8);
+                numChars += lenUtf8;
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < bestSeconds)
+            bestSeconds = elapsed.count();
+    }
+
+    double megabytes = text.length() * numConversions / (1024.0 * 1024.0);
+    std::cout << title << ":\t" << megabytes << " MB\t" << megabytes / bestSeconds << " MB/s\t("
+              << numChars / numRuns / numConversions << " bytes)" << std::endl;
+}
+
+// Reads the users in 'json' into a vector of structs several times and prints the best throughput in MB/s.
+// If 'useBinding' is true, the objects are bound to the struct. Otherwise, their values are copied by callbacks.
+static void runBinding(const char* title, const std::string& json, bool useBinding)
+{
+    struct USER
+    {
+        std::string name;
+        int64_t id;
+        bool active;
+    };
+    JsonReader::Binding<USER> binding;
+    binding.field("name", &USER::name).field("id", &USER::id).field("active", &USER::active);
+
+    const int numRuns = 5;
+    double bestSeconds = 0;
+    size_t numUsers = 0;
+
+    for (int run = 0; run < numRuns; run++)
+    {
+        JsonReader reader;
+        std::vector<USER> users;
+        USER user;
+        if (useBinding)
+            reader.bind("{users[{", binding, users);
+        else
+        {
+            reader.onPair("{users[{name", [&user](const char* value) { user.name = value ? value : ""; });
+            reader.onPairInt64("{users[{id", [&user](int64_t value) { user.id = value; });
+            reader.onPair("{users[{active", [&user](const char* value) { user.active = value && *value == 't'; });
+            reader.onObjectEnd("{users[{", [&]() { users.push_back(user); });
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if (!reader.readBuffer(json.c_str(), json.length()))
+        {
+            std::cout << "Error: " << reader.getErrorDescription() << std::endl;
+            return;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < bestSeconds)
+            bestSeconds = elapsed.count();
+        numUsers += users.size();
+    }
+
+    double megabytes = json.length() / (1024.0 * 1024.0);
+    std::cout << title << ":\t" << megabytes << " MB\t" << megabytes / bestSeconds << " MB/s\t("
+              << numUsers / numRuns << " users)" << std::endl;
+}
+
+// Reads 'numMessages' small messages and prints the throughput in MB/s.
+// If 'reuseSubscriptions' is true, the callbacks are subscribed once to a set bound to the reader.
+// Otherwise, they are subscribed again before each read.
+static void runMessages(const char* title, size_t numMessages, bool reuseSubscriptions)
+{
+    std::string message = "{\"id\":12345,\"type\":\"event\",\"user\":{\"name\":\"user\",\"active\":true}}";
+    size_t numIds = 0;
+    JsonReader reader;
+    JsonReader::Subscriptions subscriptions;
+    if (reuseSubscriptions)
+    {
+        subscriptions.onPair("{id", [&numIds](const char*) { numIds++; });
+        subscriptions.onPair("{user{name", [](const char*) {});
+        subscriptions.onPair("{user{active", [](const char*) {});
+        reader.useSubscriptions(&subscriptions);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < numMessages; i++)
+    {
+        if (!reuseSubscriptions)
+        {
+            reader.onPair("{id", [&numIds](const char*) { numIds++; });
+            reader.onPair("{user{name", [](const char*) {});
+            reader.onPair("{user{active", [](const char*) {});
+        }
+        if (!reader.readBuffer(message.c_str(), message.length()))
+        {
+            std::cout << "Error: " << reader.getErrorDescription() << std::endl;
+            return;
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double megabytes = message.length() * numMessages / (1024.0 * 1024.0);
+    std::cout << title << ":\t" << megabytes << " MB\t" << megabytes / elapsed.count() << " MB/s\t(" << numIds
+              << " ids)" << std::endl;
+}
+
+// Reads 'numMessages' small messages, each one with a new reader, and prints the throughput in MB/s.
+static void runReaders(const char* title, size_t numMessages)
+{
+    std::string message = "{\"id\":12345,\"type\":\"event\",\"user\":{\"name\":\"user\",\"active\":true}}";
+    size_t numIds = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < numMessages; i++)
+    {
+        JsonReader reader;
+        reader.onPair("{id", [&numIds](const char*) { numIds++; });
+        reader.onPair("{user{name", [](const char*) {});
+        reader.onPair("{user{active", [](const char*) {});
+        if (!reader.readBuffer(message.c_str(), message.length()))
+        {
+            std::cout << "Error: " << reader.getErrorDescription() << std::endl;
+            return;
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double megabytes = message.length() * numMessages / (1024.0 * 1024.0);
+    std::cout << title << ":\t" << megabytes << " MB\t" << megabytes / elapsed.count() << " MB/s\t(" << numIds
+              << " ids)" << std::endl;
+}
+
+// Reads 'numMessages' small messages split among one thread per core and prints the throughput in MB/s.
+// If 'usePool' is true, the threads borrow their readers from a pool sharing one set of subscriptions. Otherwise,
+// each message is read by a new reader with its own callbacks.
+static void runPool(const char* title, size_t numMessages, bool usePool)
+{
+    std::string message = "{\"id\":12345,\"type\":\"event\",\"user\":{\"name\":\"user\",\"active\":true}}";
+    unsigned numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::atomic<size_t> numIds(0);
+
+    JsonReader::Subscriptions subscriptions;
+    subscriptions.onPair("{id", [](const char*) { (*(size_t*)JsonReader::getCurrentReader()->getUserData())++; });
+    subscriptions.onPair("{user{name", [](const char*) {});
+    subscriptions.onPair("{user{active", [](const char*) {});
+    JsonReader::CONFIG config;
+    config.subscriptions = &subscriptions;
+    JsonReader::Pool pool(config);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned thread = 0; thread < numThreads; thread++)
+    {
+        threads.emplace_back(
+            [&, thread]()
+            {
+                size_t threadIds = 0;
+                for (size_t i = thread; i < numMessages; i += numThreads)
+                {
+                    if (usePool)
+                    {
+                        JsonReader::Pool::Handle reader = pool.acquire();
+                        reader->setUserData(&threadIds);
+                        reader->readBuffer(message.c_str(), message.length());
+                    }
+                    else
+                    {
+                        JsonReader reader;
+                        reader.onPair("{id", [&threadIds](const char*) { threadIds++; });
+                        reader.onPair("{user{name", [](const char*) {});
+                        reader.onPair("{user{active", [](const char*) {});
+                        reader.readBuffer(message.c_str(), message.length());
+                    }
+                }
+                numIds += threadIds;
+            });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double megabytes = message.length() * numMessages / (1024.0 * 1024.0);
+    std::cout << title << ":\t" << megabytes << " MB\t" << megabytes / elapsed.count() << " MB/s\t(" << numIds
+              << " ids, " << numThreads << " threads)" << std::endl;
+}
+
+// Builds newline-delimited JSON with one user per line.
+static std::string buildLines(size_t numUsers)
+{
+    std::string json;
+    for (size_t i = 0; i < numUsers; i++)
+        json += "{\"name\":\"user" + std::to_string(i) + "\",\"id\":" + std::to_string(i) + ",\"active\":" +
+                (i % 2 ? "true" : "false") + "}\n";
+    return json;
+}
+
+// Reads the lines of 'json' with 'numThreads' threads several times and prints the best throughput in MB/s.
+static void runLines(const char* title, const std::string& json, unsigned numThreads)
+{
+    const int numRuns = 5;
+    double bestSeconds = 0;
+    // One counter per thread, each one in a different cache line.
+    struct COUNTER
+    {
+        size_t value;
+        char padding[64 - sizeof(size_t)];
+    };
+    std::vector<COUNTER> numIds(std::max(numThreads, 1u), COUNTER());
+
+    for (int run = 0; run < numRuns; run++)
+    {
+        JsonReader reader;
+        auto setup = [&numIds](JsonReader& threadReader, unsigned thread)
+        {
+            threadReader.onPair("{id", [&numIds, thread](const char*) { numIds[thread].value++; });
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        if (!reader.readBufferLines(json.c_str(), json.length(), setup, nullptr, numThreads))
+        {
+            std::cout << "Error: " << reader.getErrorDescription() << std::endl;
+            return;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < bestSeconds)
+            bestSeconds = elapsed.count();
+    }
+
+    size_t totalIds = 0;
+    for (const COUNTER& ids : numIds)
+        totalIds += ids.value;
+    double megabytes = json.length() / (1024.0 * 1024.0);
+    std::cout << title << ":\t" << megabytes << " MB\t" << megabytes / bestSeconds << " MB/s\t(" << totalIds / numRuns
+              << " ids)" << std::endl;
+}
+
+// Reads 'json' several times and prints the best throughput in MB/s.
+// If 'numThreads' is 0, the document is read sequentially. Otherwise, the items of the array '{users[' are parsed by
+// 'numThreads' threads.
+static void runArray(const char* title, const std::string& json, unsigned numThreads)
+{
+    const int numRuns = 5;
+    double bestSeconds = 0;
+    struct COUNTER
+    {
+        size_t value;
+        char padding[64 - sizeof(size_t)];
+    };
+    std::vector<COUNTER> numIds(std::max(numThreads, 1u), COUNTER());
+
+    for (int run = 0; run < numRuns; run++)
+    {
+        JsonReader reader;
+        bool succeeded;
+        auto start = std::chrono::steady_clock::now();
+        if (numThreads == 0)
+        {
+            reader.onPair("{users[{id", [&numIds](const char*) { numIds[0].value++; });
+            succeeded = reader.readBuffer(json.c_str(), json.length());
+        }
+        else
+        {
+            auto setup = [&numIds](JsonReader& threadReader, unsigned thread)
+            {
+                threadReader.onPair("{users[{id", [&numIds, thread](const char*) { numIds[thread].value++; });
+            };
+            succeeded = reader.readBufferParallel(json.c_str(), json.length(), "{users[", setup, nullptr, numThreads);
+        }
+        if (!succeeded)
+        {
+            std::cout << "Error: " << reader.getErrorDescription() << std::endl;
+            return;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < bestSeconds)
+            bestSeconds = elapsed.count();
+    }
+
+    size_t totalIds = 0;
+    for (const COUNTER& ids : numIds)
+        totalIds += ids.value;
+    double megabytes = json.length() / (1024.0 * 1024.0);
+    std::cout << title << ":\t" << megabytes << " MB\t" << megabytes / bestSeconds << " MB/s\t(" << totalIds / numRuns
+              << " ids)" << std::endl;
+}
+
+// Writes 'json' to a file, reads it several times with the file buffers set by 'setFileBuffers' and prints the best
+// throughput in MB/s. If 'numBuffers' is greater than 1, the file is read ahead by a background thread.
+static void runFile(const char* title, const std::string& json, size_t bufferLen, unsigned numBuffers)
+{
+    const int numRuns = 5;
+    const char* fileName = "JsonReader_benchmark.json";
+    double bestSeconds = 0;
+    size_t numIds = 0;
+
+    FILE* file = fopen(fileName, "wb");
+    bool written = file && fwrite(json.data(), 1, json.length(), file) == json.length();
+    if (file)
+        fclose(file);
+    if (!written)
+    {
+        std::cout << "Error: cannot write " << fileName << std::endl;
+        return;
+    }
+
+    for (int run = 0; run < numRuns; run++)
+    {
+        JsonReader reader;
+        reader.setFileBuffers(bufferLen, numBuffers);
+        reader.onPair("{users[{id", [&numIds](const char*) { numIds++; });
+
+        auto start = std::chrono::steady_clock::now();
+        if (!reader.readFile(fileName))
+        {
+            std::cout << "Error: " << reader.getErrorDescription() << std::endl;
+            break;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < bestSeconds)
+            bestSeconds = elapsed.count();
+    }
+    std::remove(fileName);
+
+    double megabytes = json.length() / (1024.0 * 1024.0);
+    std::cout << title << ":\t" << megabytes << " MB\t" << megabytes / bestSeconds << " MB/s\t(" << numIds / numRuns
+              << " ids)" << std::endl;
+}
+
+// Writes 'json' to a file, reads the element 'element' from it several times and prints the best throughput in MB/s.
+// If 'useIndex' is true, an index of the file is written first, so that the values skipped are jumped over.
+static void runIndexedFile(const char* title, const std::string& json, const char* element, bool useIndex)
+{
+    const int numRuns = 5;
+    const char* fileName = "JsonReader_benchmark.json";
+    const char* indexName = "JsonReader_benchmark.json.jri";
+    double bestSeconds = 0;
+    size_t numIds = 0;
+
+    FILE* file = fopen(fileName, "wb");
+    bool written = file && fwrite(json.data(), 1, json.length(), file) == json.length();
+    if (file)
+        fclose(file);
+    if (!written || (useIndex && !JsonReader().writeIndex(fileName, indexName)))
+    {
+        std::cout << "Error: cannot write " << fileName << std::endl;
+        return;
+    }
+
+    for (int run = 0; run < numRuns; run++)
+    {
+        JsonReader reader;
+        reader.onPair(element, [&numIds](const char*) { numIds++; });
+
+        auto start = std::chrono::steady_clock::now();
+        if (!(useIndex ? reader.readFileIndexed(fileName, indexName) : reader.readFile(fileName)))
+        {
+            std::cout << "Error: " << reader.getErrorDescription() << std::endl;
+            break;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < bestSeconds)
+            bestSeconds = elapsed.count();
+    }
+    std::remove(fileName);
+    std::remove(indexName);
+
+    double megabytes = json.length() / (1024.0 * 1024.0);
+    std::cout << title << ":\t" << megabytes << " MB\t" << megabytes / bestSeconds << " MB/s\t(" << numIds / numRuns
+              << " ids)" << std::endl;
+}
+
+#ifdef JSONREADER_ZLIB
+// Writes 'json' to a gzip file, reads it several times and prints the best throughput in MB/s of uncompressed data.
+// If 'numBuffers' is greater than 1, the file is decompressed ahead by a background thread.
+static void runGzipFile(const char* title, const std::string& json, unsigned numBuffers)
+{
+    const int numRuns = 5;
+    const char* fileName = "JsonReader_benchmark.json.gz";
+    double bestSeconds = 0;
+    size_t numIds = 0;
+
+    gzFile file = gzopen(fileName, "wb");
+    bool written = file && gzwrite(file, json.data(), (unsigned)json.length()) == (int)json.length();
+    if (file)
+        gzclose(file);
+    if (!written)
+    {
+        std::cout << "Error: cannot write " << fileName << std::endl;
+        return;
+    }
+
+    for (int run = 0; run < numRuns; run++)
+    {
+        JsonReader reader;
+        reader.setFileBuffers(1 << 20, numBuffers);
+        reader.onPair("{users[{id", [&numIds](const char*) { numIds++; });
+
+        auto start = std::chrono::steady_clock::now();
+        if (!reader.readFile(fileName))
+        {
+            std::cout << "Error: " << reader.getErrorDescription() << std::endl;
+            break;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < bestSeconds)
+            bestSeconds = elapsed.count();
+    }
+    std::remove(fileName);
+
+    double megabytes = json.length() / (1024.0 * 1024.0);
+    std::cout << title << ":\t" << megabytes << " MB\t" << megabytes / bestSeconds << " MB/s\t(" << numIds / numRuns
+              << " ids)" << std::endl;
+}
+#endif
+
+// Number of calls to the global allocation functions, used to report the allocations per MB of input.
+// Every form of the functions is replaced, so that the compiler and the library (e.g. those that pass the size or the
+// alignment to 'delete') never pair one of them with the default implementation of another.
+// They are not inlined, since GCC would then pair 'free' with the 'operator new' of the library headers.
+static std::atomic<size_t> g_numAllocations(0);
+
+#if defined(__GNUC__)
+#define NO_INLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define NO_INLINE __declspec(noinline)
+#else
+#define NO_INLINE
+#endif
+
+NO_INLINE static void* allocate(size_t size, size_t alignment)
+{
+    g_numAllocations++;
+    if (size == 0)
+        size = 1;
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    void* ptr = nullptr;
+    return posix_memalign(&ptr, std::max(alignment, sizeof(void*)), size) == 0 ? ptr : nullptr;
+#endif
+}
+
+NO_INLINE static void deallocate(void* ptr)
+{
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+static void* allocateOrThrow(size_t size, size_t alignment)
+{
+    if (void* ptr = allocate(size, alignment))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size) { return allocateOrThrow(size, alignof(std::max_align_t)); }
+void* operator new[](size_t size) { return allocateOrThrow(size, alignof(std::max_align_t)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size, alignof(std::max_align_t)); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size, alignof(std::max_align_t)); }
+void operator delete(void* ptr) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { deallocate(ptr); }
+
+#ifdef __cpp_aligned_new
+void* operator new(size_t size, std::align_val_t alignment) { return allocateOrThrow(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return allocateOrThrow(size, (size_t)alignment); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocate(size, (size_t)alignment);
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocate(size, (size_t)alignment);
+}
+void operator delete(void* ptr, std::align_val_t) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { deallocate(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { deallocate(ptr); }
+#endif
+
+// Linear congruential generator, so that the corpus is the same in every run and platform.
+class Random
+{
+public:
+    explicit Random(uint32_t seed) : m_state(seed) {}
+    uint32_t next(uint32_t range) // Returns a number from 0 to 'range' - 1.
+    {
+        m_state = m_state * 1664525u + 1013904223u;
+        return (m_state >> 8) % range;
+    }
+
+private:
+    uint32_t m_state;
+};
+
+// Builds a document similar to 'twitter.json': an array of 'numStatuses' statuses with nested users and entities,
+// short texts mixing ASCII and non-ASCII characters, escape sequences, large integers, booleans and nulls.
+static std::string buildTwitter(size_t numStatuses)
+{
+    static const char* words[] = {"the",   "json", "reader", "\xE3\x81\x93\xE3\x82\x93\xE3\x81\xAB\xE3\x81\xA1\xE3\x81\xAF",
+                                  "caf\xC3\xA9", "stream", "\\\"quoted\\\"", "line\\nbreak", "\\u00e9t\\u00e9",
+                                  "\xF0\x9F\x98\x80", "fast", "parser"};
+    const uint32_t numWords = sizeof(words) / sizeof(words[0]);
+    Random random(1);
+    std::string json = "{\"statuses\":[";
+
+    for (size_t i = 0; i < numStatuses; i++)
+    {
+        std::string id = std::to_string(850000000000000000ull + i * 7919);
+        std::string text;
+        for (uint32_t w = 0, numWordsInText = 5 + random.next(15); w < numWordsInText; w++)
+            text += std::string(w > 0 ? " " : "") + words[random.next(numWords)];
+        std::string userId = std::to_string(1000000 + random.next(9000000));
+
+        json += std::string(i > 0 ? "," : "") + "{\"created_at\":\"Sun Aug 31 00:29:15 +0000 2014\",\"id\":" + id +
+                ",\"id_str\":\"" + id + "\",\"text\":\"" + text +
+                "\",\"source\":\"<a href=\\\"https://example.com\\\" rel=\\\"nofollow\\\">web</a>\",\"truncated\":false,"
+                "\"in_reply_to_status_id\":null,\"user\":{\"id\":" + userId + ",\"id_str\":\"" + userId +
+                "\",\"name\":\"user" + std::to_string(i) + "\",\"screen_name\":\"screen_" + std::to_string(i) +
+                "\",\"description\":\"" + words[random.next(numWords)] + "\",\"followers_count\":" +
+                std::to_string(random.next(100000)) + ",\"friends_count\":" + std::to_string(random.next(5000)) +
+                ",\"verified\":" + (random.next(10) == 0 ? "true" : "false") +
+                ",\"profile_image_url\":\"http://pbs.example.com/profile_images/" + userId +
+                "/normal.jpeg\",\"lang\":\"ja\"},\"geo\":null,\"coordinates\":null,\"entities\":{\"hashtags\":[";
+        for (uint32_t h = 0, numHashtags = random.next(3); h < numHashtags; h++)
+            json += std::string(h > 0 ? "," : "") + "{\"text\":\"tag" + std::to_string(h) + "\",\"indices\":[" +
+                    std::to_string(h * 10) + "," + std::to_string(h * 10 + 4) + "]}";
+        json += "],\"urls\":[],\"user_mentions\":[]},\"retweet_count\":" + std::to_string(random.next(1000)) +
+                ",\"favorite_count\":" + std::to_string(random.next(1000)) +
+                ",\"favorited\":false,\"retweeted\":false,\"lang\":\"ja\"}";
+    }
+    json += "],\"search_metadata\":{\"completed_in\":0.087,\"max_id\":505874924095815681,\"count\":" +
+            std::to_string(numStatuses) + "}}";
+    return json;
+}
+
+// Builds a document similar to 'canada.json': a GeoJSON feature whose polygon has 'numRings' rings of
+// 'numPoints' coordinates, written as floating-point numbers with many digits.
+static std::string buildCanada(size_t numRings, size_t numPoints)
+{
+    Random random(2);
+    std::string json = "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\",\"properties\":{\"name\":"
+                       "\"Canada\"},\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[";
+    char number[32];
+
+    for (size_t ring = 0; ring < numRings; ring++)
+    {
+        json += ring > 0 ? ",[" : "[";
+        for (size_t point = 0; point < numPoints; point++)
+        {
+            double longitude = -141.0 + random.next(8000000) / 100000.0 + 0.000000000000023;
+            double latitude = 41.0 + random.next(4200000) / 100000.0 + 0.000000000000009;
+            snprintf(number, sizeof(number), point > 0 ? ",[%.15f," : "[%.15f,", longitude);
+            json += number;
+            snprintf(number, sizeof(number), "%.15f]", latitude);
+            json += number;
+        }
+        json += "]";
+    }
+    json += "]}}]}";
+    return json;
+}
+
+// Builds an array of 'numItems' values, each one made of 'depth' nested objects and arrays.
+static std::string buildDeep(size_t numItems, size_t depth)
+{
+    std::string open, close;
+    for (size_t level = 0; level < depth; level++)
+    {
+        open += level % 2 ? "[" : "{\"level\":";
+        close = (level % 2 ? "]" : "}") + close;
+    }
+    std::string json = "[";
+    for (size_t i = 0; i < numItems; i++)
+        json += std::string(i > 0 ? "," : "") + open + std::to_string(i) + close;
+    json += "]";
+    return json;
+}
+
+// Builds an array of 'numTexts' objects, each one containing a string value of about 'textLen' bytes with some escape
+// sequences and non-ASCII characters.
+static std::string buildLongStrings(size_t numTexts, size_t textLen)
+{
+    std::string text;
+    while (text.length() < textLen)
+    {
+        for (int i = 0; i < 200; i++)
+            text += (char)('a' + i % 26);
+        text += text.length() % 3 ? "\\\"caf\xC3\xA9\\\"\\t" : "\\u4e2d\\n";
+    }
+    std::string json = "[";
+    for (size_t i = 0; i < numTexts; i++)
+        json += std::string(i > 0 ? "," : "") + "{\"id\":" + std::to_string(i) + ",\"text\":\"" + text + "\"}";
+    json += "]";
+    return json;
+}
+
+// Reads the document 'json' of the corpus several times with 'readFile', 'readBuffer' and 'getPathsFromBuffer', and
+// prints the best throughput of each method in MB/s and events/s, and the number of allocations per MB.
+// The events are the objects, arrays, pairs and array items found, all of which are notified to callbacks when the
+// document is read (the paths are extracted without callbacks).
+// If 'isLines' is true, the document is newline-delimited JSON, which is read with 'readFileLines' and
+// 'readBufferLines' using one thread.
+static void runCorpus(const char* title, const std::string& json, bool isLines)
+{
+    const int numRuns = 5;
+    const char* fileName = "JsonReader_benchmark.json";
+    enum { READ_FILE, READ_BUFFER, GET_PATHS, NUM_METHODS };
+    const char* methodNames[] = {"readFile", "readBuffer", "getPathsFromBuffer"};
+
+    FILE* file = fopen(fileName, "wb");
+    if (!file || fwrite(json.data(), 1, json.length(), file) != json.length())
+    {
+        std::cout << "Error: cannot write " << fileName << std::endl;
+        if (file)
+            fclose(file);
+        return;
+    }
+    fclose(file);
+
+    double megabytes = json.length() / (1024.0 * 1024.0);
+    size_t numEvents = 0;
+
+    for (int method = READ_FILE; method < NUM_METHODS; method++)
+    {
+        if (isLines && method == GET_PATHS)
+            continue; // Paths are extracted from a single JSON value.
+
+        double bestSeconds = 0;
+        size_t numAllocations = 0;
+        for (int run = 0; run < numRuns; run++)
+        {
+            size_t events = 0;
+            auto count0 = [&events]() { events++; };
+            auto count1 = [&events](const char*, size_t) { events++; };
+            auto setup = [&](JsonReader& reader, unsigned)
+            {
+                reader.onObjectBegin((const char*)nullptr, count0);
+                reader.onArrayBegin((const char*)nullptr, count0);
+                reader.onPair((const char*)nullptr, count1);
+                reader.onArrayItem((const char*)nullptr, count1);
+            };
+            JsonReader reader;
+            std::set<std::wstring> paths;
+            bool succeeded = false;
+
+            size_t allocationsBefore = g_numAllocations;
+            auto start = std::chrono::steady_clock::now();
+            if (method == GET_PATHS)
+                succeeded = reader.getPathsFromBuffer(json.c_str(), json.length(), paths);
+            else if (isLines)
+                succeeded = (method == READ_FILE) ? reader.readFileLines(fileName, setup, nullptr, 1)
+                                                  : reader.readBufferLines(json.c_str(), json.length(), setup, nullptr, 1);
+            else
+            {
+                setup(reader, 0);
+                succeeded = (method == READ_FILE) ? reader.readFile(fileName)
+                                                  : reader.readBuffer(json.c_str(), json.length());
+            }
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            if (!succeeded)
+            {
+                std::cout << "Error: " << reader.getErrorDescription() << std::endl;
+                std::remove(fileName);
+                return;
+            }
+            numAllocations = g_numAllocations - allocationsBefore;
+            if (method != GET_PATHS)
+                numEvents = events;
+            if (run == 0 || elapsed.count() < bestSeconds)
+                bestSeconds = elapsed.count();
+        }
+
+        std::cout << title << " (" << methodNames[method] << "):\t" << megabytes << " MB\t" << megabytes / bestSeconds
+                  << " MB/s\t" << numEvents / bestSeconds / 1e6 << " M events/s\t" << numAllocations / megabytes
+                  << " allocations/MB" << std::endl;
+    }
+    std::remove(fileName);
+}
+
+// Reads the documents of the corpus, which are generated in memory and are the same in every run.
+static void runCorpusSuite()
+{
+    runCorpus("Corpus twitter", buildTwitter(50000), false);
+    runCorpus("Corpus canada", buildCanada(50, 10000), false);
+    runCorpus("Corpus deep nesting", buildDeep(20000, 64), false);
+    runCorpus("Corpus long strings", buildLongStrings(2000, 20000), false);
+    runCorpus("Corpus NDJSON", buildLines(400000), true);
+}
+
+// Runs the micro-benchmarks of specific features of the reader.
+static void runFeatureSuite()
+{
+    const size_t numUsers = 200000;
+
+    run("Indented", buildUsers(numUsers, true));
+    run("Minified", buildUsers(numUsers, false));
+    run("Minified (by path)", buildUsers(numUsers, false), "{users[{id");
+    run("Minified (by pattern)", buildUsers(numUsers, false), "{*[{id");
+    run("Minified (by JSON Pointer)", buildUsers(numUsers, false), "/users/*/id");
+    run("Strings", buildTexts(numUsers / 10, 1000));
+    run("Selective", "{\"meta\":{\"id\":1},\"data\":" + buildUsers(numUsers, true) + "}", "{meta{id");
+    run("Selective (by pattern)", "{\"meta\":{\"id\":1},\"data\":" + buildUsers(numUsers, true) + "}", "/meta/*");
+    run("Selective (stop)", "{\"meta\":{\"id\":1},\"data\":" + buildUsers(numUsers, true) + "}", "{meta{id", true);
+    runMessages("Messages", numUsers, false);
+    runMessages("Messages (reused subscriptions)", numUsers, true);
+    runReaders("Messages (new reader each)", numUsers);
+    runPool("Messages (threads, new reader each)", numUsers, false);
+    runPool("Messages (threads, pool)", numUsers, true);
+    std::string numbers = buildNumbers(numUsers * 5);
+    runNumbers("Numbers (strtod)", numbers, false);
+    runNumbers("Numbers (typed)", numbers, true);
+    runNumbers("Numbers (typed, batched)", numbers, true, true);
+    runDispatch(numbers);
+    std::string minified = buildUsers(numUsers, false);
+    runWide("Wide (1 callback)", minified, 1);
+    runWide("Wide (3 callbacks)", minified, 3);
+    std::string asciiText = buildText(1 << 20, true), mixedText = buildText(1 << 20, false);
+    runTranscoding("Transcoding ASCII (codecvt)", asciiText, true);
+    runTranscoding("Transcoding ASCII", asciiText, false);
+    runTranscoding("Transcoding mixed (codecvt)", mixedText, true);
+    runTranscoding("Transcoding mixed", mixedText, false);
+    runBinding("Structs (callbacks)", minified, false);
+    runBinding("Structs (binding)", minified, true);
+    std::string lines = buildLines(numUsers * 2);
+    unsigned numCores = std::max(std::thread::hardware_concurrency(), 1u);
+    runLines("Lines (1 thread)", lines, 1);
+    runLines(("Lines (" + std::to_string(numCores) + " threads)").c_str(), lines, numCores);
+    std::string users = buildUsers(numUsers * 2, false);
+    runArray("Array (sequential)", users, 0);
+    runArray("Array (1 thread)", users, 1);
+    runArray(("Array (" + std::to_string(numCores) + " threads)").c_str(), users, numCores);
+    runFile("File (64 KB buffer)", users, 0, 1);
+    runFile("File (1 MB buffer)", users, 1 << 20, 1);
+    runFile("File (read ahead, 4 x 1 MB)", users, 1 << 20, 4);
+    std::string selective = "{\"data\":" + users + ",\"meta\":{\"id\":1}}";
+    runIndexedFile("File (selective)", selective, "{meta{id", false);
+    runIndexedFile("File (selective, indexed)", selective, "{meta{id", true);
+#ifdef JSONREADER_ZLIB
+    runGzipFile("Gzip file", users, 1);
+    runGzipFile("Gzip file (decompressed ahead)", users, 4);
+#endif
+}
+
+// Runs both suites by default. The argument 'corpus' or 'features' runs only one of them.
+int main(int argc, char* argv[])
+{
+    std::string suite = argc > 1 ? argv[1] : "";
+    if (!suite.empty() && suite != "corpus" && suite != "features")
+    {
+        std::cout << "Usage: " << argv[0] << " [corpus|features]" << std::endl;
+        return 1;
+    }
+    if (suite != "features")
+        runCorpusSuite();
+    if (suite != "corpus")
+        runFeatureSuite();
+    return 0;
+}
@@ -1,1012 +1,4469 @@
 ﻿#include "JsonReader.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <climits>
 #include <clocale>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
 #include <sstream>
 #include <stdarg.h>
+#include <thread>
+
+#if defined(USE_STRING_VIEW) && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#if defined(__cpp_lib_to_chars) || (defined(_MSC_VER) && _MSC_VER >= 1924)
+#define USE_FROM_CHARS // Floating-point numbers are converted by std::from_chars, independently of the locale.
+#endif
+#endif
+#endif
+#if !defined(USE_FROM_CHARS) &&                                                                                     \
+    (defined(USE_WINAPI) || defined(__GLIBC__) || defined(__APPLE__) || defined(__FreeBSD__))
+#define USE_STRTOD_L // Otherwise, they are converted by strtod_l with the C locale.
+#include <cerrno>
+#include <cmath>
+#include <locale.h>
+#include <stdlib.h>
+#if defined(__APPLE__) || defined(__FreeBSD__)
+#include <xlocale.h>
+#endif
+#endif
 
 #ifdef USE_WINAPI
+#include <sys/stat.h>
 #include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
-#define FILE_BUFFER_LEN 65536
-#define RESIZE_FACTOR 1.2f
+#ifdef JSONREADER_ZLIB
+#include <zlib.h>
+#endif
+#ifdef JSONREADER_ZSTD
+#include <zstd.h>
+#endif
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// class JsonReader
+#define FILE_BUFFER_LEN 65536 // Default size of the blocks in which files are read (see 'setFileBuffers').
+#define COMPRESSED_BUFFER_LEN 65536 // Size of the blocks of compressed data read by GzipSource and ZstdSource.
+#define PARALLEL_CHUNK_LEN (1 << 20) // Approximate size of the chunks of input parsed by each thread.
+#define RESIZE_FACTOR 1.2f
+#define INITIAL_DEPTH 64 // Number of nested objects and arrays for which the frames are allocated beforehand.
+#define CHECK_INTERVAL 65536 // Number of bytes parsed between checks of the progress and the cancellation.
+#define BATCH_SIZE 1024 // Default number of array items passed at once by 'onArrayItems'.
+#define BATCH_DATA_LEN 65536 // Initial size of the copies of the values of a batch of array items.
+#define POOL_CAPACITY 64 // Default number of idle readers kept by a Pool.
+#define PATTERN_CACHE_LEN 65536 // Maximum number of paths whose matched patterns are kept by a reader.
+#define INDEX_MIN_LEN 4096 // Minimum size of the objects and arrays added to the index of a file (see 'writeIndex').
+#define INDEX_VERSION 2 // Version of the format of the index files.
+#define INDEX_CHECK_LEN 16 // Bytes next to each bracket of an indexed object or array that are checked before a jump.
+
+// Adds 'value' to a counter of the stats, which are only compiled if JSONREADER_STATS is defined.
+#ifdef JSONREADER_STATS
+#define COUNT_STAT(counter, value) ((counter) += (value))
+#else
+#define COUNT_STAT(counter, value) ((void)0)
+#endif
 
-JsonReader::JsonReader() { clear(); }
+// Vector instructions are used to scan the JSON text in blocks. Define JSONREADER_NO_SIMD to build the scalar
+// version only.
+#ifndef JSONREADER_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define USE_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(_MSC_VER)
+#define USE_AVX2 // Only used if the CPU supports it, which is checked at runtime.
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define USE_NEON
+#include <arm_neon.h>
+#endif
+#endif
 
-JsonReader::~JsonReader()
+#if defined(__GNUC__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define COUNT_TRAILING_ZEROS(mask) __builtin_ctz(mask)
+#define COUNT_TRAILING_ZEROS64(mask) __builtin_ctzll(mask)
+#else
+#define TARGET_AVX2
+static inline int countTrailingZeros(unsigned long mask)
 {
-    clear();
-    m_cancel = false;
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (int)idx;
+}
+static inline int countTrailingZeros64(unsigned long long mask)
+{
+#ifdef _M_X64
+    unsigned long idx;
+    _BitScanForward64(&idx, mask);
+    return (int)idx;
+#else
+    return ((unsigned long)mask) ? countTrailingZeros((unsigned long)mask)
+                                 : 32 + countTrailingZeros((unsigned long)(mask >> 32));
+#endif
 }
+#define COUNT_TRAILING_ZEROS(mask) countTrailingZeros(mask)
+#define COUNT_TRAILING_ZEROS64(mask) countTrailingZeros64(mask)
+#endif
 
-void JsonReader::clear()
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers to scan blocks of JSON text.
+// -> 'skipSeparators' functions return the number of consecutive separators between elements (spaces, new lines,
+//    colons, commas...) found from the beginning of the block of 'len' bytes.
+// -> 'findStringDelimiter' functions return the index of the first quotation mark or backslash in the block of 'len'
+//    bytes (or 'len' if not found). The argument 'isAscii' is set to false if a non-ASCII byte precedes that index.
+// -> 'findStructural' functions return the index of the first quotation mark or bracket in the block of 'len' bytes
+//    (or 'len' if not found).
+// -> 'classifyBlock' functions set the bits of three 64-bit masks according to the 64 bytes of the block: quotation
+//    marks, backslashes, and brackets or commas.
+// -> 'widenAscii' functions copy the ASCII characters found from the beginning of the block of 'len' bytes into the
+//    wide string 'out', and return their number.
+
+static inline bool isSeparator(char ch)
 {
-    m_useLocale = false;
-    m_notifyProgress = false;
-    m_currentPublisher = nullptr;
-    m_input.clear();
-    clearStrings();
-    unsubscribe();
+    return (ch == ' ' || ch == '\r' || ch == '\n' || ch == '\t' || ch == ':' || ch == ',' || ch == '\0');
 }
 
-void JsonReader::clearStrings()
+static size_t skipSeparatorsScalar(const char* str, size_t len)
 {
-    m_elemName.clear();
-    m_elemValue.clear();
-    m_path.clear();
-    m_currentElemName.clear();
+    size_t i = 0;
+    while (i < len && isSeparator(str[i]))
+        i++;
+    return i;
 }
 
-void JsonReader::unsubscribe()
+static inline bool isStructural(char ch) { return (ch == '\"' || (ch | 0x20) == '{' || (ch | 0x20) == '}'); }
+
+static size_t findStructuralScalar(const char* str, size_t len)
 {
-    m_onObjectBegin.unsubscribe();
-    m_onObjectEnd.unsubscribe();
-    m_onArrayBegin.unsubscribe();
-    m_onArrayEnd.unsubscribe();
-    m_onArrayItem.unsubscribe();
-    m_onPair.unsubscribe();
+    size_t i = 0;
+    while (i < len && !isStructural(str[i]))
+        i++;
+    return i;
 }
 
-void JsonReader::updateCurrentPath(size_t& pathLen)
+static void classifyBlockScalar(const char* block, uint64_t& quotes, uint64_t& backslashes, uint64_t& structurals)
 {
-    if (m_elemName.length > 0)
+    quotes = backslashes = structurals = 0;
+    for (int i = 0; i < 64; i++)
     {
-        memcpy((char*)(m_path.str + pathLen), m_elemName.str, m_elemName.length);
-        pathLen += m_elemName.length;
-        if (pathLen >= m_path.capacity)
-            m_path.resize((size_t)(pathLen * RESIZE_FACTOR));
-        m_path.setLength(pathLen);
-        m_path.isAscii &= m_elemName.isAscii;
+        char ch = block[i];
+        if (ch == '\"')
+            quotes |= 1ull << i;
+        else if (ch == '\\')
+            backslashes |= 1ull << i;
+        else if ((ch | 0x20) == '{' || (ch | 0x20) == '}' || ch == ',')
+            structurals |= 1ull << i;
     }
 }
 
-void JsonReader::parseObject(size_t pathLen, size_t namePos, size_t elemNameLen)
+static size_t findStringDelimiterScalar(const char* str, size_t len, bool& isAscii)
 {
-    m_path.str[pathLen++] = '{';
+    size_t i = 0;
+    unsigned char highBits = 0;
+    for (; i < len && str[i] != '\"' && str[i] != '\\'; i++)
+        highBits |= static_cast<unsigned char>(str[i]);
+    if (highBits > 0x7F)
+        isAscii = false;
+    return i;
+}
 
-    notify(&m_onObjectBegin, namePos, elemNameLen, pathLen);
+static size_t widenAsciiScalar(const char* str, size_t len, wchar_t* out)
+{
+    size_t i = 0;
+    for (; i < len && static_cast<unsigned char>(str[i]) <= 0x7F; i++)
+        out[i] = static_cast<wchar_t>(str[i]);
+    return i;
+}
 
-    while (m_input.getNextChar() != '}')
+#ifdef USE_SSE2
+static size_t skipSeparatorsSSE2(const char* str, size_t len)
+{
+    const __m128i space = _mm_set1_epi8(' '), cr = _mm_set1_epi8('\r'), lf = _mm_set1_epi8('\n');
+    const __m128i tab = _mm_set1_epi8('\t'), colon = _mm_set1_epi8(':'), comma = _mm_set1_epi8(',');
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
     {
-        parseString(m_elemName);
-        m_input.getNextChar();
-        parseValue(pathLen);
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        __m128i isSep = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, cr)),
+                                     _mm_or_si128(_mm_cmpeq_epi8(chunk, lf), _mm_cmpeq_epi8(chunk, tab)));
+        isSep = _mm_or_si128(isSep, _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, colon), _mm_cmpeq_epi8(chunk, comma)),
+                                                 _mm_cmpeq_epi8(chunk, zero)));
+        unsigned int mask = ~(unsigned int)_mm_movemask_epi8(isSep) & 0xFFFF;
+        if (mask)
+            return i + COUNT_TRAILING_ZEROS(mask);
     }
-    m_elemName.clear();
-    m_elemValue.clear();
-    notify(&m_onObjectEnd, namePos, elemNameLen, pathLen);
+    return i + skipSeparatorsScalar(str + i, len - i);
 }
 
-void JsonReader::parseArray(size_t pathLen, size_t namePos, size_t elemNameLen)
+static size_t findStructuralSSE2(const char* str, size_t len)
 {
-    m_path.str[pathLen++] = '[';
-
-    notify(&m_onArrayBegin, namePos, elemNameLen, pathLen);
-
-    while (m_input.getNextChar() != ']')
+    // Square brackets are turned into curly brackets by setting bit 5, which no other character maps to.
+    const __m128i quote = _mm_set1_epi8('\"'), open = _mm_set1_epi8('{'), close = _mm_set1_epi8('}');
+    const __m128i bit5 = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
     {
-        m_elemName.clear();
-        m_elemValue.clear();
-        m_arrayItem.clear();
-        parseValue(pathLen, &m_arrayItem);
-        notify(&m_onArrayItem, namePos, elemNameLen, pathLen, m_arrayItem.getValue());
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        __m128i lowered = _mm_or_si128(chunk, bit5);
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(
+            _mm_cmpeq_epi8(chunk, quote), _mm_or_si128(_mm_cmpeq_epi8(lowered, open), _mm_cmpeq_epi8(lowered, close))));
+        if (mask)
+            return i + COUNT_TRAILING_ZEROS(mask);
     }
-    m_elemName.clear();
-    m_elemValue.clear();
-    m_arrayItem.clear();
-    notify(&m_onArrayEnd, namePos, elemNameLen, pathLen);
+    return i + findStructuralScalar(str + i, len - i);
 }
 
-void JsonReader::parseValue(size_t pathLen, ARRAY_ITEM* arrayItem)
+static size_t findStringDelimiterSSE2(const char* str, size_t len, bool& isAscii)
 {
-    size_t namePos = pathLen;
-    size_t elemNameLen = m_elemName.length;
-    bool isPathAscii = m_path.isAscii;
-    STR* elemValue = &m_elemValue;
-
-    updateCurrentPath(pathLen);
-    char ch = m_input.getCurrentChar();
-
-    if (ch == '{')
-        parseObject(pathLen, namePos, elemNameLen);
-    else if (ch == '[')
-        parseArray(pathLen, namePos, elemNameLen);
-    else
+    const __m128i quote = _mm_set1_epi8('\"'), backslash = _mm_set1_epi8('\\');
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
     {
-        if (ch == '\"') // key / value pair.
-            parseString(m_elemValue);
-        else if ((ch >= '0' && ch <= '9') || ch == '-') // number.
-            parseNumber(m_elemValue);
-        else if (parseTrue())
-            m_elemValue.copy("true", 4);
-        else if (parseFalse())
-            m_elemValue.copy("false", 5);
-        else if (parseNull())
-            elemValue = nullptr;
-        else
-            throwException("Unexpected character '%c'.", ch);
-        if (!arrayItem)
-            notify(&m_onPair, namePos, elemNameLen, pathLen, elemValue);
-        else
-            arrayItem->setValue(elemValue);
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        unsigned int mask =
+            (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        unsigned int highBits = (unsigned int)_mm_movemask_epi8(chunk); // Bytes above 0x7F.
+        if (mask)
+        {
+            int idx = COUNT_TRAILING_ZEROS(mask);
+            if (highBits & ((1u << idx) - 1))
+                isAscii = false;
+            return i + idx;
+        }
+        if (highBits)
+            isAscii = false;
     }
-    m_path.isAscii = isPathAscii;
-
-    if (m_notifyProgress)
-        m_input.notifyProgress();
-    if (m_cancel)
-        throwException("The process has been cancelled.");
+    return i + findStringDelimiterScalar(str + i, len - i, isAscii);
 }
 
-void JsonReader::parseString(STR& text)
+static void classifyBlockSSE2(const char* block, uint64_t& quotes, uint64_t& backslashes, uint64_t& structurals)
 {
-    char ch = 0;
-    text.length = 0;
-    text.isAscii = true;
-    text.isQuoted = true;
+    const __m128i quote = _mm_set1_epi8('\"'), backslash = _mm_set1_epi8('\\'), comma = _mm_set1_epi8(',');
+    const __m128i open = _mm_set1_epi8('{'), close = _mm_set1_epi8('}'), bit5 = _mm_set1_epi8(0x20);
+    quotes = backslashes = structurals = 0;
+    for (int i = 0; i < 64; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        __m128i lowered = _mm_or_si128(chunk, bit5);
+        quotes |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)) << i;
+        backslashes |= (uint64_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash)) << i;
+        structurals |= (uint64_t)_mm_movemask_epi8(_mm_or_si128(
+                           _mm_cmpeq_epi8(chunk, comma),
+                           _mm_or_si128(_mm_cmpeq_epi8(lowered, open), _mm_cmpeq_epi8(lowered, close))))
+                       << i;
+    }
+}
 
-    m_input.goToNextQuote();
-    while ((ch = m_input.getNextChar(true)) != '\"')
+static size_t widenAsciiSSE2(const char* str, size_t len, wchar_t* out)
+{
+    // The bytes are interleaved with zeros once to get 16-bit characters, and twice to get 32-bit characters.
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
     {
-        if (ch == '\\')
-            m_input.readEscapeSequence(text);
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        if (_mm_movemask_epi8(chunk))
+            break; // Bytes above 0x7F.
+        __m128i low = _mm_unpacklo_epi8(chunk, zero), high = _mm_unpackhi_epi8(chunk, zero);
+        __m128i* dest = reinterpret_cast<__m128i*>(out + i);
+        if (sizeof(wchar_t) == 2)
+        {
+            _mm_storeu_si128(dest, low);
+            _mm_storeu_si128(dest + 1, high);
+        }
         else
         {
-            if (text.length >= text.capacity)
-                text.resize((size_t)(text.length * RESIZE_FACTOR));
-            if (static_cast<unsigned char>(ch) > 0x7F)
-                text.isAscii = false;
-            text.str[text.length++] = ch;
+            _mm_storeu_si128(dest, _mm_unpacklo_epi16(low, zero));
+            _mm_storeu_si128(dest + 1, _mm_unpackhi_epi16(low, zero));
+            _mm_storeu_si128(dest + 2, _mm_unpacklo_epi16(high, zero));
+            _mm_storeu_si128(dest + 3, _mm_unpackhi_epi16(high, zero));
         }
     }
-    text.str[text.length] = 0;
+    return i + widenAsciiScalar(str + i, len - i, out + i);
 }
+#endif
 
-void JsonReader::parseNumber(STR& number)
+#ifdef USE_AVX2
+TARGET_AVX2 static size_t skipSeparatorsAVX2(const char* str, size_t len)
 {
-    number.length = 0;
-    number.isAscii = true;
-    number.isQuoted = false;
-
-    while (isNumericCharacter(m_input.getCurrentChar()))
+    const __m256i space = _mm256_set1_epi8(' '), cr = _mm256_set1_epi8('\r'), lf = _mm256_set1_epi8('\n');
+    const __m256i tab = _mm256_set1_epi8('\t'), colon = _mm256_set1_epi8(':'), comma = _mm256_set1_epi8(',');
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32)
     {
-        if (number.length >= number.capacity)
-            number.resize((size_t)(number.length * RESIZE_FACTOR));
-        number.str[number.length++] = m_input.getCurrentChar();
-        m_input.getNextChar(true);
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i));
+        __m256i isSep =
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, cr)),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, lf), _mm256_cmpeq_epi8(chunk, tab)));
+        isSep = _mm256_or_si256(
+            isSep, _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, colon), _mm256_cmpeq_epi8(chunk, comma)),
+                                   _mm256_cmpeq_epi8(chunk, zero)));
+        unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(isSep);
+        if (mask)
+            return i + COUNT_TRAILING_ZEROS(mask);
     }
-    m_input.goToPreviousChar();
-    number.str[number.length] = 0;
-}
-
-bool JsonReader::isNumericCharacter(char ch)
-{
-    if ((ch < '0' || ch > '9') && ch != '.' && ch != '+' && ch != '-' && ch != 'e' && ch != 'E')
-        return false;
-    return true;
+    return i + skipSeparatorsSSE2(str + i, len - i);
 }
 
-bool JsonReader::parseTrue()
+TARGET_AVX2 static size_t findStructuralAVX2(const char* str, size_t len)
 {
-    return (m_input.getCurrentChar() == 't' && m_input.getNextChar(true) == 'r' && m_input.getNextChar(true) == 'u' &&
-            m_input.getNextChar(true) == 'e');
+    const __m256i quote = _mm256_set1_epi8('\"'), open = _mm256_set1_epi8('{'), close = _mm256_set1_epi8('}');
+    const __m256i bit5 = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i));
+        __m256i lowered = _mm256_or_si256(chunk, bit5);
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_or_si256(_mm256_cmpeq_epi8(lowered, open),
+                                                                             _mm256_cmpeq_epi8(lowered, close))));
+        if (mask)
+            return i + COUNT_TRAILING_ZEROS(mask);
+    }
+    return i + findStructuralSSE2(str + i, len - i);
 }
 
-bool JsonReader::parseFalse()
+TARGET_AVX2 static size_t findStringDelimiterAVX2(const char* str, size_t len, bool& isAscii)
 {
-    return (m_input.getCurrentChar() == 'f' && m_input.getNextChar(true) == 'a' && m_input.getNextChar(true) == 'l' &&
-            m_input.getNextChar(true) == 's' && m_input.getNextChar(true) == 'e');
+    const __m256i quote = _mm256_set1_epi8('\"'), backslash = _mm256_set1_epi8('\\');
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)));
+        unsigned int highBits = (unsigned int)_mm256_movemask_epi8(chunk); // Bytes above 0x7F.
+        if (mask)
+        {
+            int idx = COUNT_TRAILING_ZEROS(mask);
+            if (idx > 0 && (highBits << (32 - idx)))
+                isAscii = false;
+            return i + idx;
+        }
+        if (highBits)
+            isAscii = false;
+    }
+    return i + findStringDelimiterSSE2(str + i, len - i, isAscii);
 }
 
-bool JsonReader::parseNull()
+TARGET_AVX2 static void classifyBlockAVX2(const char* block, uint64_t& quotes, uint64_t& backslashes,
+                                          uint64_t& structurals)
 {
-    return (m_input.getCurrentChar() == 'n' && m_input.getNextChar(true) == 'u' && m_input.getNextChar(true) == 'l' &&
-            m_input.getNextChar(true) == 'l');
+    const __m256i quote = _mm256_set1_epi8('\"'), backslash = _mm256_set1_epi8('\\'), comma = _mm256_set1_epi8(',');
+    const __m256i open = _mm256_set1_epi8('{'), close = _mm256_set1_epi8('}'), bit5 = _mm256_set1_epi8(0x20);
+    quotes = backslashes = structurals = 0;
+    for (int i = 0; i < 64; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+        __m256i lowered = _mm256_or_si256(chunk, bit5);
+        quotes |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, quote)) << i;
+        backslashes |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, backslash)) << i;
+        structurals |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_or_si256(
+                           _mm256_cmpeq_epi8(chunk, comma),
+                           _mm256_or_si256(_mm256_cmpeq_epi8(lowered, open), _mm256_cmpeq_epi8(lowered, close))))
+                       << i;
+    }
 }
 
-bool JsonReader::readFile(const char* fileFullPath) { return read(fileFullPath, true); }
-
-bool JsonReader::readBuffer(const char* buffer) { return read(buffer, false); }
-
-bool JsonReader::read(const char* source, bool isFile, std::set<std::wstring>* pathList)
+TARGET_AVX2 static size_t widenAsciiAVX2(const char* str, size_t len, wchar_t* out)
 {
-    bool succeeded = true;
-    m_cancel = false;
-    try
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32)
     {
-        clearStrings();
-
-        m_input.init(source, isFile);
-
-        if (pathList)
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i));
+        if (_mm256_movemask_epi8(chunk))
+            break; // Bytes above 0x7F.
+        __m128i low = _mm256_castsi256_si128(chunk), high = _mm256_extracti128_si256(chunk, 1);
+        __m256i* dest = reinterpret_cast<__m256i*>(out + i);
+        if (sizeof(wchar_t) == 2)
         {
-            // Store unique JSON paths in array 'pathList'.
-            std::function<void()> callback = [&]() { pathList->insert(getCurrentElementPathWide()); };
-            std::function<void(const wchar_t*)> funcPair = [&](const wchar_t*)
-            {
-                pathList->insert(getCurrentElementPathWide());
-            };
-            onObjectBegin((const char*)nullptr, callback);
-            onArrayBegin((const char*)nullptr, callback);
-            onPair((const char*)nullptr, funcPair);
+            _mm256_storeu_si256(dest, _mm256_cvtepu8_epi16(low));
+            _mm256_storeu_si256(dest + 1, _mm256_cvtepu8_epi16(high));
         }
-
-        if (m_input.findFirstChar())
-            parseValue(0);
-        if (m_notifyProgress)
-            m_input.notifyProgressEnd();
-    }
-    catch (std::exception& e)
-    {
-        std::ostringstream description;
-        description << e.what();
-        if (!m_cancel)
+        else
         {
-            if (m_input.getPosition() > 0)
-                description << " Byte Position: " << m_input.getPosition() << ".";
-            if (strlen(m_path.str) > 0)
-                description << " JSON path: '" << m_path.str << "'.";
+            _mm256_storeu_si256(dest, _mm256_cvtepu8_epi32(low));
+            _mm256_storeu_si256(dest + 1, _mm256_cvtepu8_epi32(_mm_srli_si128(low, 8)));
+            _mm256_storeu_si256(dest + 2, _mm256_cvtepu8_epi32(high));
+            _mm256_storeu_si256(dest + 3, _mm256_cvtepu8_epi32(_mm_srli_si128(high, 8)));
         }
-        m_errDescription = description.str();
-        succeeded = false;
     }
-    clear();
-    return succeeded;
+    _mm256_zeroupper(); // Not always inserted by the compiler here, it avoids the penalty of returning to SSE code.
+    return i + widenAsciiSSE2(str + i, len - i, out + i);
 }
 
-std::string JsonReader::getCurrentElementPath() { return std::string(m_path.toNarrow()); }
-
-std::wstring JsonReader::getCurrentElementPathWide() { return std::wstring(m_path.toWide()); }
-
-void JsonReader::getCurrentElementPath(std::string& elementPath) { elementPath = m_path.toNarrow(); }
-
-void JsonReader::getCurrentElementPathWide(std::wstring& elementPath) { elementPath = m_path.toWide(); }
-
-std::string JsonReader::getCurrentElementName()
+static bool isAVX2Supported()
 {
-    std::string str;
-    getCurrentElementName(str);
-    return str;
+#if defined(__GNUC__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#else
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 0x6) == 0x6);
+    __cpuidex(info, 7, 0);
+    return osSavesYmm && (info[1] & (1 << 5));
+#endif
 }
+#endif
 
-std::wstring JsonReader::getCurrentElementNameWide()
+#ifdef USE_NEON
+// Returns a 64-bit mask with 4 bits per byte of the comparison result, since NEON lacks a 'movemask' instruction.
+static inline uint64_t neonMask(uint8x16_t cmp)
 {
-    std::wstring wstr;
-    getCurrentElementNameWide(wstr);
-    return wstr;
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4)), 0);
 }
 
-void JsonReader::getCurrentElementName(std::string& elementName)
+static size_t skipSeparatorsNEON(const char* str, size_t len)
 {
-    if (m_currentPublisher)
+    const uint8x16_t space = vdupq_n_u8(' '), cr = vdupq_n_u8('\r'), lf = vdupq_n_u8('\n');
+    const uint8x16_t tab = vdupq_n_u8('\t'), colon = vdupq_n_u8(':'), comma = vdupq_n_u8(',');
+    const uint8x16_t zero = vdupq_n_u8(0);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
     {
-        m_currentPublisher->getCurrentElementName(m_currentElemName);
-        elementName.assign(m_currentElemName.toNarrow());
+        uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(str + i));
+        uint8x16_t isSep = vorrq_u8(vorrq_u8(vceqq_u8(chunk, space), vceqq_u8(chunk, cr)),
+                                    vorrq_u8(vceqq_u8(chunk, lf), vceqq_u8(chunk, tab)));
+        isSep = vorrq_u8(isSep, vorrq_u8(vorrq_u8(vceqq_u8(chunk, colon), vceqq_u8(chunk, comma)), vceqq_u8(chunk, zero)));
+        uint64_t mask = ~neonMask(isSep);
+        if (mask)
+            return i + (COUNT_TRAILING_ZEROS64(mask) >> 2);
     }
-    else
-        elementName.clear();
+    return i + skipSeparatorsScalar(str + i, len - i);
 }
 
-void JsonReader::getCurrentElementNameWide(std::wstring& elementName)
+static size_t findStructuralNEON(const char* str, size_t len)
 {
-    if (m_currentPublisher)
+    const uint8x16_t quote = vdupq_n_u8('\"'), open = vdupq_n_u8('{'), close = vdupq_n_u8('}');
+    const uint8x16_t bit5 = vdupq_n_u8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
     {
-        m_currentPublisher->getCurrentElementName(m_currentElemName);
-        elementName.assign(m_currentElemName.toWide());
+        uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(str + i));
+        uint8x16_t lowered = vorrq_u8(chunk, bit5);
+        uint64_t mask = neonMask(
+            vorrq_u8(vceqq_u8(chunk, quote), vorrq_u8(vceqq_u8(lowered, open), vceqq_u8(lowered, close))));
+        if (mask)
+            return i + (COUNT_TRAILING_ZEROS64(mask) >> 2);
     }
-    else
-        elementName.clear();
+    return i + findStructuralScalar(str + i, len - i);
 }
 
-bool JsonReader::getPathsFromFile(const char* fileFullPath, std::set<std::wstring>& paths)
+static size_t findStringDelimiterNEON(const char* str, size_t len, bool& isAscii)
 {
-    return read(fileFullPath, true, &paths);
+    const uint8x16_t quote = vdupq_n_u8('\"'), backslash = vdupq_n_u8('\\'), highBit = vdupq_n_u8(0x80);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
+    {
+        uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(str + i));
+        uint64_t mask = neonMask(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash)));
+        uint64_t highBits = neonMask(vcgeq_u8(chunk, highBit)); // Bytes above 0x7F.
+        if (mask)
+        {
+            int idx = COUNT_TRAILING_ZEROS64(mask);
+            if (idx > 0 && (highBits << (64 - idx)))
+                isAscii = false;
+            return i + (idx >> 2);
+        }
+        if (highBits)
+            isAscii = false;
+    }
+    return i + findStringDelimiterScalar(str + i, len - i, isAscii);
 }
 
-bool JsonReader::getPathsFromBuffer(const char* buffer, std::set<std::wstring>& paths)
+static size_t widenAsciiNEON(const char* str, size_t len, wchar_t* out)
 {
-    return read(buffer, false, &paths);
+    const uint8x16_t highBit = vdupq_n_u8(0x80);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
+    {
+        uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(str + i));
+        if (neonMask(vcgeq_u8(chunk, highBit)))
+            break; // Bytes above 0x7F.
+        uint16x8_t low = vmovl_u8(vget_low_u8(chunk)), high = vmovl_u8(vget_high_u8(chunk));
+        if (sizeof(wchar_t) == 2)
+        {
+            uint16_t* dest = reinterpret_cast<uint16_t*>(out + i);
+            vst1q_u16(dest, low);
+            vst1q_u16(dest + 8, high);
+        }
+        else
+        {
+            uint32_t* dest = reinterpret_cast<uint32_t*>(out + i);
+            vst1q_u32(dest, vmovl_u16(vget_low_u16(low)));
+            vst1q_u32(dest + 4, vmovl_u16(vget_high_u16(low)));
+            vst1q_u32(dest + 8, vmovl_u16(vget_low_u16(high)));
+            vst1q_u32(dest + 12, vmovl_u16(vget_high_u16(high)));
+        }
+    }
+    return i + widenAsciiScalar(str + i, len - i, out + i);
 }
 
-void JsonReader::throwException(const char* format, ...)
+#if defined(__aarch64__) || defined(_M_ARM64)
+// Returns a 64-bit mask with one bit per byte of the four comparison results, which cover 64 consecutive bytes.
+static inline uint64_t neonMask64(uint8x16_t cmp0, uint8x16_t cmp1, uint8x16_t cmp2, uint8x16_t cmp3)
 {
-    char buffer[2048];
-    va_list argptr;
-    va_start(argptr, format);
-    vsnprintf(buffer, 2048, format, argptr);
-    va_end(argptr);
-    throw std::runtime_error(std::string(buffer));
+    static const uint8_t bitWeights[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t weights = vld1q_u8(bitWeights);
+    uint8x16_t sum0 = vpaddq_u8(vandq_u8(cmp0, weights), vandq_u8(cmp1, weights));
+    uint8x16_t sum1 = vpaddq_u8(vandq_u8(cmp2, weights), vandq_u8(cmp3, weights));
+    sum0 = vpaddq_u8(sum0, sum1);
+    sum0 = vpaddq_u8(sum0, sum0);
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
 }
 
-void JsonReader::useLocale(bool useLocale, const char* locale)
+static void classifyBlockNEON(const char* block, uint64_t& quotes, uint64_t& backslashes, uint64_t& structurals)
 {
-    m_useLocale = useLocale;
-    m_elemName.useLocale = useLocale;
-    m_elemValue.useLocale = useLocale;
-    m_path.useLocale = useLocale;
-    m_currentElemName.useLocale = useLocale;
-
-    if (locale == NULL)
-        setlocale(LC_ALL, "");
-    else if (setlocale(LC_ALL, locale) == NULL)
-        throwException("Locale '%s' not found.", locale);
+    const uint8x16_t quote = vdupq_n_u8('\"'), backslash = vdupq_n_u8('\\'), comma = vdupq_n_u8(',');
+    const uint8x16_t open = vdupq_n_u8('{'), close = vdupq_n_u8('}'), bit5 = vdupq_n_u8(0x20);
+    uint8x16_t chunks[4], isQuote[4], isBackslash[4], isStructural[4];
+    for (int i = 0; i < 4; i++)
+    {
+        chunks[i] = vld1q_u8(reinterpret_cast<const uint8_t*>(block + i * 16));
+        uint8x16_t lowered = vorrq_u8(chunks[i], bit5);
+        isQuote[i] = vceqq_u8(chunks[i], quote);
+        isBackslash[i] = vceqq_u8(chunks[i], backslash);
+        isStructural[i] =
+            vorrq_u8(vceqq_u8(chunks[i], comma), vorrq_u8(vceqq_u8(lowered, open), vceqq_u8(lowered, close)));
+    }
+    quotes = neonMask64(isQuote[0], isQuote[1], isQuote[2], isQuote[3]);
+    backslashes = neonMask64(isBackslash[0], isBackslash[1], isBackslash[2], isBackslash[3]);
+    structurals = neonMask64(isStructural[0], isStructural[1], isStructural[2], isStructural[3]);
 }
+#endif
+#endif
 
-void JsonReader::notify(Publisher* publisher, size_t namePos, size_t nameLen, size_t pathLen, STR* value)
+// Scanning functions of the widest instruction set supported by the CPU. The pointers are constant-initialized to
+// resolvers that select the functions on their first call, so that a text can be read during the dynamic
+// initialization of another translation unit. They are atomic because several threads may select them at once.
+struct SCAN_FUNCTIONS
 {
-    m_path.setLength(pathLen);
-    m_currentPublisher = publisher;
-    publisher->notify(m_path.str, namePos, nameLen, pathLen, value);
-}
+    size_t skipSeparators(const char* str, size_t len) const
+    {
+        return skipSeparatorsFunc.load(std::memory_order_relaxed)(str, len);
+    }
+    size_t findStringDelimiter(const char* str, size_t len, bool& isAscii) const
+    {
+        return findStringDelimiterFunc.load(std::memory_order_relaxed)(str, len, isAscii);
+    }
+    size_t findStructural(const char* str, size_t len) const
+    {
+        return findStructuralFunc.load(std::memory_order_relaxed)(str, len);
+    }
+    void classifyBlock(const char* block, uint64_t& quotes, uint64_t& backslashes, uint64_t& structurals) const
+    {
+        classifyBlockFunc.load(std::memory_order_relaxed)(block, quotes, backslashes, structurals);
+    }
+    size_t widenAscii(const char* str, size_t len, wchar_t* out) const
+    {
+        return widenAsciiFunc.load(std::memory_order_relaxed)(str, len, out);
+    }
 
-// Methods for subscribing to events.
-// -> Wide character string versions.
-void JsonReader::onObjectBegin(const wchar_t* element, std::function<void()> callback)
-{
-    m_onObjectBegin.subscribe(element, new Callback0(callback));
-}
-void JsonReader::onObjectEnd(const wchar_t* element, std::function<void()> callback)
+    std::atomic<size_t (*)(const char* str, size_t len)> skipSeparatorsFunc;
+    std::atomic<size_t (*)(const char* str, size_t len, bool& isAscii)> findStringDelimiterFunc;
+    std::atomic<size_t (*)(const char* str, size_t len)> findStructuralFunc;
+    std::atomic<void (*)(const char* block, uint64_t& quotes, uint64_t& backslashes, uint64_t& structurals)>
+        classifyBlockFunc;
+    std::atomic<size_t (*)(const char* str, size_t len, wchar_t* out)> widenAsciiFunc;
+};
+
+static size_t resolveSkipSeparators(const char* str, size_t len);
+static size_t resolveFindStringDelimiter(const char* str, size_t len, bool& isAscii);
+static size_t resolveFindStructural(const char* str, size_t len);
+static void resolveClassifyBlock(const char* block, uint64_t& quotes, uint64_t& backslashes, uint64_t& structurals);
+static size_t resolveWidenAscii(const char* str, size_t len, wchar_t* out);
+
+static SCAN_FUNCTIONS scan = {{resolveSkipSeparators}, {resolveFindStringDelimiter}, {resolveFindStructural},
+                              {resolveClassifyBlock}, {resolveWidenAscii}};
+
+// Replaces the resolvers with the functions for the CPU.
+static void selectScanFunctions()
 {
-    m_onObjectEnd.subscribe(element, new Callback0(callback));
+    size_t (*skipSeparators)(const char* str, size_t len) = skipSeparatorsScalar;
+    size_t (*findStringDelimiter)(const char* str, size_t len, bool& isAscii) = findStringDelimiterScalar;
+    size_t (*findStructural)(const char* str, size_t len) = findStructuralScalar;
+    void (*classifyBlock)(const char* block, uint64_t& quotes, uint64_t& backslashes, uint64_t& structurals) =
+        classifyBlockScalar;
+    size_t (*widenAscii)(const char* str, size_t len, wchar_t* out) = widenAsciiScalar;
+#if defined(USE_SSE2)
+    skipSeparators = skipSeparatorsSSE2;
+    findStringDelimiter = findStringDelimiterSSE2;
+    findStructural = findStructuralSSE2;
+    classifyBlock = classifyBlockSSE2;
+    widenAscii = widenAsciiSSE2;
+#elif defined(USE_NEON)
+    skipSeparators = skipSeparatorsNEON;
+    findStringDelimiter = findStringDelimiterNEON;
+    findStructural = findStructuralNEON;
+    widenAscii = widenAsciiNEON;
+#if defined(__aarch64__) || defined(_M_ARM64)
+    classifyBlock = classifyBlockNEON;
+#endif
+#endif
+#ifdef USE_AVX2
+    if (isAVX2Supported())
+    {
+        skipSeparators = skipSeparatorsAVX2;
+        findStringDelimiter = findStringDelimiterAVX2;
+        findStructural = findStructuralAVX2;
+        classifyBlock = classifyBlockAVX2;
+        widenAscii = widenAsciiAVX2;
+    }
+#endif
+    scan.skipSeparatorsFunc.store(skipSeparators, std::memory_order_relaxed);
+    scan.findStringDelimiterFunc.store(findStringDelimiter, std::memory_order_relaxed);
+    scan.findStructuralFunc.store(findStructural, std::memory_order_relaxed);
+    scan.classifyBlockFunc.store(classifyBlock, std::memory_order_relaxed);
+    scan.widenAsciiFunc.store(widenAscii, std::memory_order_relaxed);
 }
-void JsonReader::onArrayBegin(const wchar_t* element, std::function<void()> callback)
+
+static size_t resolveSkipSeparators(const char* str, size_t len)
 {
-    m_onArrayBegin.subscribe(element, new Callback0(callback));
+    selectScanFunctions();
+    return scan.skipSeparators(str, len);
 }
-void JsonReader::onArrayEnd(const wchar_t* element, std::function<void()> callback)
+static size_t resolveFindStringDelimiter(const char* str, size_t len, bool& isAscii)
 {
-    m_onArrayEnd.subscribe(element, new Callback0(callback));
+    selectScanFunctions();
+    return scan.findStringDelimiter(str, len, isAscii);
 }
-void JsonReader::onArrayItem(const wchar_t* element, std::function<void(const char*)> callback)
+static size_t resolveFindStructural(const char* str, size_t len)
 {
-    m_onArrayItem.subscribe(element, new Callback1(callback));
+    selectScanFunctions();
+    return scan.findStructural(str, len);
 }
-void JsonReader::onArrayItem(const wchar_t* element, std::function<void(const wchar_t*)> callback)
+static void resolveClassifyBlock(const char* block, uint64_t& quotes, uint64_t& backslashes, uint64_t& structurals)
 {
-    m_onArrayItem.subscribe(element, new Callback1(callback));
+    selectScanFunctions();
+    scan.classifyBlock(block, quotes, backslashes, structurals);
 }
-void JsonReader::onPair(const wchar_t* element, std::function<void(const char*)> callback)
+static size_t resolveWidenAscii(const char* str, size_t len, wchar_t* out)
 {
-    m_onPair.subscribe(element, new Callback1(callback));
+    selectScanFunctions();
+    return scan.widenAscii(str, len, out);
 }
-void JsonReader::onPair(const wchar_t* element, std::function<void(const wchar_t*)> callback)
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers to transcode between UTF-8 and wide strings, which are encoded as UTF-16 if 'wchar_t' has 2 bytes (as in
+// Windows) or as UTF-32 otherwise. The UTF-8 input is validated while it is decoded: malformed sequences, overlong
+// forms, surrogates and code points above U+10FFFF are replaced by U+FFFD, as are unpaired surrogates in wide strings.
+
+static const uint32_t REPLACEMENT_CHARACTER = 0xFFFD;
+static const size_t MAX_UTF8_PER_WIDE = sizeof(wchar_t) == 2 ? 3 : 4; // Maximum UTF-8 bytes per wide character.
+
+static inline bool isSurrogate(uint32_t codePoint) { return codePoint >= 0xD800 && codePoint <= 0xDFFF; }
+
+// Encodes a valid code point into 'out', which must have room for 4 bytes, and returns the number of bytes written.
+static inline size_t encodeUtf8(uint32_t codePoint, char* out)
 {
-    m_onPair.subscribe(element, new Callback1(callback));
+    if (codePoint <= 0x7F)
+    {
+        out[0] = static_cast<char>(codePoint);
+        return 1;
+    }
+    if (codePoint <= 0x7FF)
+    {
+        out[0] = static_cast<char>(0xC0 | (codePoint >> 6));
+        out[1] = static_cast<char>(0x80 | (codePoint & 0x3F));
+        return 2;
+    }
+    if (codePoint <= 0xFFFF)
+    {
+        out[0] = static_cast<char>(0xE0 | (codePoint >> 12));
+        out[1] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out[2] = static_cast<char>(0x80 | (codePoint & 0x3F));
+        return 3;
+    }
+    out[0] = static_cast<char>(0xF0 | (codePoint >> 18));
+    out[1] = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+    out[2] = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+    out[3] = static_cast<char>(0x80 | (codePoint & 0x3F));
+    return 4;
 }
-// -> UTF-8 string versions.
-void JsonReader::onObjectBegin(const char* elementUtf8, std::function<void()> callback)
+
+// Decodes the multibyte sequence at the beginning of 'str', of up to 'len' bytes, and returns the number of bytes
+// consumed. If the sequence is malformed, 'codePoint' is set to U+FFFD and only its valid prefix is consumed.
+static size_t decodeUtf8(const unsigned char* str, size_t len, uint32_t& codePoint)
 {
-    m_onObjectBegin.subscribe(elementUtf8, new Callback0(callback));
+    // The second byte has a narrower range in some cases, which excludes overlong forms, surrogates and code
+    // points above U+10FFFF.
+    unsigned char lead = str[0], low = 0x80, high = 0xBF;
+    size_t numTrailing = 0;
+    uint32_t value = 0;
+    if (lead >= 0xC2 && lead <= 0xDF)
+    {
+        numTrailing = 1;
+        value = lead & 0x1F;
+    }
+    else if (lead >= 0xE0 && lead <= 0xEF)
+    {
+        numTrailing = 2;
+        value = lead & 0x0F;
+        low = (lead == 0xE0) ? 0xA0 : 0x80;
+        high = (lead == 0xED) ? 0x9F : 0xBF;
+    }
+    else if (lead >= 0xF0 && lead <= 0xF4)
+    {
+        numTrailing = 3;
+        value = lead & 0x07;
+        low = (lead == 0xF0) ? 0x90 : 0x80;
+        high = (lead == 0xF4) ? 0x8F : 0xBF;
+    }
+    else
+    {
+        codePoint = REPLACEMENT_CHARACTER;
+        return 1;
+    }
+    for (size_t i = 1; i <= numTrailing; i++)
+    {
+        if (i >= len || str[i] < low || str[i] > high)
+        {
+            codePoint = REPLACEMENT_CHARACTER;
+            return i;
+        }
+        value = (value << 6) | (str[i] & 0x3F);
+        low = 0x80;
+        high = 0xBF;
+    }
+    codePoint = value;
+    return numTrailing + 1;
 }
-void JsonReader::onObjectEnd(const char* elementUtf8, std::function<void()> callback)
+
+// Converts 'len' bytes of UTF-8 into 'out', which must have room for 'len' wide characters, and returns the number
+// of wide characters written. Runs of ASCII characters are widened in blocks.
+static size_t utf8ToWide(const char* str, size_t len, wchar_t* out)
 {
-    m_onObjectEnd.subscribe(elementUtf8, new Callback0(callback));
-}
-void JsonReader::onArrayBegin(const char* elementUtf8, std::function<void()> callback)
-{
-    m_onArrayBegin.subscribe(elementUtf8, new Callback0(callback));
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(str);
+    size_t i = 0, numChars = 0;
+    while (i < len)
+    {
+        if (bytes[i] <= 0x7F)
+        {
+            size_t numAscii = scan.widenAscii(str + i, len - i, out + numChars);
+            i += numAscii;
+            numChars += numAscii;
+            continue;
+        }
+        uint32_t codePoint;
+        i += decodeUtf8(bytes + i, len - i, codePoint);
+        if (sizeof(wchar_t) == 2 && codePoint > 0xFFFF) // Surrogate pair, from a 4-byte sequence.
+        {
+            codePoint -= 0x10000;
+            out[numChars++] = static_cast<wchar_t>(0xD800 + (codePoint >> 10));
+            out[numChars++] = static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF));
+        }
+        else
+            out[numChars++] = static_cast<wchar_t>(codePoint);
+    }
+    return numChars;
 }
-void JsonReader::onArrayEnd(const char* elementUtf8, std::function<void()> callback)
+
+// Converts 'len' wide characters into 'out', which must have room for 'len * MAX_UTF8_PER_WIDE' bytes, and returns
+// the number of bytes written.
+static size_t wideToUtf8(const wchar_t* str, size_t len, char* out)
 {
-    m_onArrayEnd.subscribe(elementUtf8, new Callback0(callback));
+    size_t numBytes = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        uint32_t codePoint = static_cast<uint32_t>(str[i]);
+        if (codePoint <= 0x7F)
+        {
+            out[numBytes++] = static_cast<char>(codePoint);
+            continue;
+        }
+        if (sizeof(wchar_t) == 2 && codePoint >= 0xD800 && codePoint <= 0xDBFF && i + 1 < len)
+        {
+            uint32_t next = static_cast<uint32_t>(str[i + 1]);
+            if (next >= 0xDC00 && next <= 0xDFFF) // Surrogate pair.
+            {
+                codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (next - 0xDC00);
+                i++;
+            }
+        }
+        if (isSurrogate(codePoint) || codePoint > 0x10FFFF)
+            codePoint = REPLACEMENT_CHARACTER;
+        numBytes += encodeUtf8(codePoint, out + numBytes);
+    }
+    return numBytes;
 }
-void JsonReader::onArrayItem(const char* elementUtf8, std::function<void(const char*)> callback)
+
+// Returns a mask where each bit is the XOR of all the bits of 'mask' up to its position. Applied to a mask of
+// quotation marks, it sets the bits of the characters enclosed in strings (and of the opening quotation marks).
+static inline uint64_t prefixXor(uint64_t mask)
 {
-    m_onArrayItem.subscribe(elementUtf8, new Callback1(callback));
+    mask ^= mask << 1;
+    mask ^= mask << 2;
+    mask ^= mask << 4;
+    mask ^= mask << 8;
+    mask ^= mask << 16;
+    mask ^= mask << 32;
+    return mask;
 }
-void JsonReader::onArrayItem(const char* elementUtf8, std::function<void(const wchar_t*)> callback)
+
+// Builds the structural index of the array that begins at 'str' (with a square bracket) in blocks of 64 bytes:
+// finds the brackets and commas that are not enclosed in strings in order to locate the end of the array without
+// parsing it, as well as the commas between its items where it can be split.
+// Returns the index of the closing bracket, or 'len' if it is not found within 'len' bytes. The position of the first
+// comma between items found after every 'chunkLen' bytes is stored in 'cuts'.
+static size_t indexArray(const char* str, size_t len, size_t chunkLen, std::vector<size_t>& cuts)
 {
-    m_onArrayItem.subscribe(elementUtf8, new Callback1(callback));
+    uint64_t prevInString = 0; // All bits are set if the previous block ended inside a string.
+    uint64_t prevEscaped = 0;  // Bit 0 is set if the previous block ended with an unescaped backslash.
+    size_t depth = 0;
+    size_t nextCut = chunkLen;
+    char lastBlock[64];
+
+    for (size_t blockPos = 0; blockPos < len; blockPos += 64)
+    {
+        const char* block = str + blockPos;
+        if (len - blockPos < 64)
+        {
+            // The last block is padded with spaces.
+            memset(lastBlock, ' ', 64);
+            memcpy(lastBlock, block, len - blockPos);
+            block = lastBlock;
+        }
+        uint64_t quotes, backslashes, structurals;
+        scan.classifyBlock(block, quotes, backslashes, structurals);
+
+        // The characters that follow an unescaped backslash are escaped (backslashes are rare, so they are
+        // processed one by one).
+        uint64_t escaped = prevEscaped;
+        prevEscaped = 0;
+        while (backslashes)
+        {
+            int idx = COUNT_TRAILING_ZEROS64(backslashes);
+            backslashes &= backslashes - 1;
+            if (escaped & (1ull << idx))
+                continue;
+            if (idx == 63)
+                prevEscaped = 1;
+            else
+                escaped |= 1ull << (idx + 1);
+        }
+
+        uint64_t inString = prefixXor(quotes & ~escaped) ^ prevInString;
+        prevInString = (uint64_t)((int64_t)inString >> 63);
+        structurals &= ~inString;
+
+        while (structurals)
+        {
+            size_t pos = blockPos + COUNT_TRAILING_ZEROS64(structurals);
+            structurals &= structurals - 1;
+            char ch = str[pos];
+            if (ch == ',')
+            {
+                if (depth == 1 && pos >= nextCut)
+                {
+                    cuts.push_back(pos);
+                    nextCut = pos + chunkLen;
+                }
+            }
+            else if (ch == '[' || ch == '{')
+                depth++;
+            else if (--depth == 0)
+                return pos;
+        }
+    }
+    return len;
 }
-void JsonReader::onPair(const char* elementUtf8, std::function<void(const char*)> callback)
+
+struct JsonReader::STREAM
+{
+    std::vector<char> data; // Text received and not parsed yet, from the end of the last member completed.
+    const char* buffer;     // Text being parsed, which is either 'data' or the fragment passed to 'feed'.
+    size_t len;
+    size_t position;       // Position of the beginning of 'buffer' in the whole text.
+    size_t resumePosition; // Position after the last member completed, from which the parsing goes on.
+    bool isPathAscii;      // State of the path at that point.
+    bool isStarted;        // True once the root value has begun, so its objects and arrays are kept in 'm_frames'.
+    bool isInString;       // True if the last fragment ended in a string, so the next one without quotes is kept only.
+    bool isFinished;       // True once 'finish' is called, so the end of 'buffer' is the end of the text.
+    bool isDone;           // True once the root value is complete or the text is found to be invalid.
+    bool succeeded;        // Result of the parsing, once done.
+};
+
+struct JsonReader::READ_AHEAD
+{
+    std::mutex mutex;
+    std::condition_variable changed; // Notified whenever any of the following members changes.
+    std::vector<std::unique_ptr<char[]>> buffers;
+    std::vector<size_t> lengths;  // Number of bytes read into each buffer.
+    std::vector<size_t> consumed; // Number of bytes consumed by the source once each buffer was read.
+    std::exception_ptr error;     // Exception thrown while reading, rethrown by the parser once it needs more data.
+    size_t first;     // Index of the first filled buffer, which is the one being parsed if 'isHeld'.
+    size_t numFilled; // Number of buffers filled and not released by the parser yet.
+    bool isHeld;      // True while the parser reads the first filled buffer.
+    bool isFinished;  // True once the end of the file has been reached.
+    bool isStopped;   // True once the parser does not need any more data.
+    std::thread reader;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// class JsonReader
+
+// Reader whose read is being executed by the calling thread (see 'getCurrentReader').
+static thread_local JsonReader* s_currentReader = nullptr;
+
+JsonReader::JsonReader()
 {
-    m_onPair.subscribe(elementUtf8, new Callback1(callback));
+    m_subscriptions = &m_ownSubscriptions;
+    m_patternCache.patternsId = 0;
+    m_parallelRead = nullptr;
+    m_arrayRange = nullptr;
+    m_newIndex = nullptr;
+    m_index = nullptr;
+    m_indexPos = 0;
+    m_userData = nullptr;
+    m_stream = nullptr;
+    m_maxDepth = 0;
+    m_baseDepth = 0;
+    m_cancel = false;
+    m_stop = false;
+    m_nextCheck = 0;
+    m_errorCode = ERROR_NONE;
+    m_errorPosition = 0;
+#ifdef JSONREADER_STATS
+    resetStats();
+#endif
+    clear();
 }
-void JsonReader::onPair(const char* elementUtf8, std::function<void(const wchar_t*)> callback)
+
+JsonReader::~JsonReader()
 {
-    m_onPair.subscribe(elementUtf8, new Callback1(callback));
+    discardStream();
+    clear();
+    m_cancel = false;
 }
-void JsonReader::onProgress(int step, std::function<void(int progress)> progressCallback)
+
+void JsonReader::clear()
 {
-    m_notifyProgress = ((step > 0 && step < 100) && progressCallback != nullptr);
-    if (m_notifyProgress)
-        m_input.setProgressParams(step, progressCallback);
+    m_skipValues = false;
+    m_hashPaths = false;
+    m_useLocale = false;
+    m_notifyProgress = false;
+    m_currentName = nullptr;
+    m_currentNameLen = 0;
+    m_pathList = nullptr;
+    m_frames.clear(); // The allocated frames are kept for the next read.
+    m_input.clear();
+    clearStrings();
+    m_ownSubscriptions.clear();
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// class JsonReader::TextConverter
+void JsonReader::discardStream()
+{
+    if (!m_stream)
+        return;
+    if (!m_stream->isDone && m_subscriptions->m_hasBatches)
+        flushPendingBatches(true); // The arrays of the text were left open.
+    delete m_stream;
+    m_stream = nullptr;
+    clear();
+}
 
-JsonReader::TextConverter::TextConverter()
+void JsonReader::clearStrings()
 {
-    m_lenMaxNarrow = 1;
-    m_bufferNarrow = new char[m_lenMaxNarrow + 1];
-    m_bufferNarrow[0] = 0;
-    m_lenMaxWide = 1;
-    m_bufferWide = new wchar_t[m_lenMaxWide + 1];
-    m_bufferWide[0] = 0;
+    m_elemName.clear();
+    m_elemValue.clear();
+    m_path.clear();
+    m_currentElemName.clear();
 }
 
-JsonReader::TextConverter::~TextConverter()
+void JsonReader::updateCurrentPath(size_t& pathLen)
 {
-    if (m_bufferNarrow)
-        delete[] m_bufferNarrow;
-    if (m_bufferWide)
-        delete[] m_bufferWide;
+    // Leave room for the element's name, a bracket and the null terminator.
+    if (pathLen + m_elemName.length + 2 > m_path.capacity)
+    {
+        m_path.setLength(pathLen); // The characters of the path up to its length are kept.
+        m_path.resize((size_t)((pathLen + m_elemName.length + 2) * RESIZE_FACTOR));
+    }
+    if (m_elemName.length > 0)
+    {
+        memcpy((char*)(m_path.str + pathLen), m_elemName.data(), m_elemName.length);
+        pathLen += m_elemName.length;
+        m_path.setLength(pathLen);
+        m_path.isAscii &= m_elemName.isAscii;
+    }
 }
 
-const char* JsonReader::TextConverter::WideToUtf8(const wchar_t* bufferWide, const size_t lenWide, size_t* lenOut)
+void JsonReader::parseArrayInParallel(size_t pathLen, size_t namePos, size_t elemNameLen)
 {
-    if (!bufferWide)
-        return nullptr;
+    if (!m_input.isContiguous())
+        throwError(ERROR_NOT_CONTIGUOUS);
+
+    // Stage 1: find the end of the array and the commas between items where it can be split.
+    const char* array = m_input.getCurrentPtr();
+    size_t remainingLen = m_input.getRemainingLength();
+    std::vector<size_t> chunkEnds;
+    size_t arrayEnd = indexArray(array, remainingLen, PARALLEL_CHUNK_LEN, chunkEnds);
+    if (arrayEnd == remainingLen)
+        throwError(ERROR_UNEXPECTED_END);
+    chunkEnds.push_back(arrayEnd);
+
+    // Stage 2: parse the chunks of items concurrently, starting from the path of the array.
+    // The hash of the path is computed here, since the readers of the threads may need it even if this one does not.
+    ARRAY_RANGE range = {m_path.str, pathLen, namePos, elemNameLen, m_input.getPosition() - 1,
+                         m_baseDepth + m_frames.size(), Publisher::hash(m_path.str, pathLen)};
+    size_t maxDepth = m_maxDepth;
+    CHUNK_PARSER parseChunk = [array, &range, maxDepth](JsonReader& reader, size_t begin, size_t end,
+                                                        size_t& errorPosition, std::string& errorDescription)
+    {
+        ARRAY_RANGE chunkRange = range;
+        chunkRange.position += begin;
+        reader.setMaxDepth(maxDepth);
+        if (reader.read(array + begin, end - begin, false, nullptr, &chunkRange))
+            return true;
+        errorPosition = begin;
+        errorDescription = reader.getErrorDescription();
+        return false;
+    };
+    if (!parseChunks(1, chunkEnds, parseChunk, *m_parallelRead->setup, *m_parallelRead->commit,
+                     m_parallelRead->numThreads))
+        throwError(m_errorCode); // The description has already been built.
+
+    m_input.moveForward(arrayEnd - 1); // The next character is the closing bracket.
+}
 
-    if (lenWide == 0)
+void JsonReader::parseArrayItems(const ARRAY_RANGE& range)
+{
+    m_input.setPosition(range.position);
+    m_path.copy(range.path, range.pathLen, true, true);
+    Callback* batch = nullptr;
+#ifndef JSONREADER_STATS
+    if (m_subscriptions->m_hasBatches)
     {
-        m_bufferNarrow[0] = 0;
-        return m_bufferNarrow;
+        bool hasPending;
+        batch = findBatch(range.namePos, range.nameLen, range.pathLen, range.pathHash, hasPending);
+    }
+#endif
+    while (true)
+    {
+        m_input.getNextChar();
+        if (m_input.isEOF())
+            break;
+        m_elemName.clear();
+        m_elemValue.clear();
+        m_arrayItem.clear();
+        parseValue(range.pathLen, range.pathHash, true);
+        if (m_stop || m_cancel)
+            break;
+        if (batch)
+            notifyBatch(batch, range.namePos, range.nameLen, range.pathLen, range.pathHash, m_arrayItem.getValue());
+        else
+            notify(&m_subscriptions->m_onArrayItem, range.namePos, range.nameLen, range.pathLen, range.pathHash,
+                   m_arrayItem.getValue());
     }
+}
 
-    size_t length = 0;
-#ifdef USE_WINAPI
-    length = WideCharToMultiByte(CP_UTF8, 0, bufferWide, (int)lenWide, nullptr, 0, nullptr, nullptr);
-#else
-    auto p = reinterpret_cast<const wchar_t*>(bufferWide);
-    m_str = m_codecvt.to_bytes(p, p + lenWide);
-    length = m_str.length();
+void JsonReader::parseValue(size_t pathLen, uint64_t pathHash, bool isArrayItem, bool isResumed)
+{
+    // Objects and arrays are parsed iteratively: a frame is pushed onto 'm_frames' when one begins, its members are
+    // parsed in this same loop, and the frame is popped when it ends.
+    size_t baseDepth = isResumed ? 0 : m_frames.size();
+    while (true)
+    {
+        // Parse the value that begins at the current character, whose name (if any) is 'm_elemName'.
+        size_t namePos = pathLen;
+        size_t elemNameLen = m_elemName.length;
+        bool isPathAscii = m_path.isAscii;
+        bool isValueComplete = true;
+
+        if (isResumed)
+        {
+            // The last member completed by the previous fragment has been notified, and its frame is kept.
+            m_path.isAscii = m_stream->isPathAscii;
+            isResumed = false;
+            isValueComplete = false;
+        }
+        else
+        {
+            if (m_input.isEOF())
+                throwError(ERROR_UNEXPECTED_END);
+            if (m_hashPaths) // Extend the hash with the name.
+                pathHash = Publisher::hash(m_elemName.data(), m_elemName.length, pathHash);
+            updateCurrentPath(pathLen);
+            char ch = m_input.getCurrentChar();
+
+            // The values of the pairs of a bound object are not skipped, unless they are objects or arrays.
+            // The scalar items of an array with a batch are notified, so they are not skipped either.
+            // Neither are the objects and arrays of a stream, which would be skipped again from their beginning along
+            // with each fragment.
+            Binder* binder = (!isArrayItem && !m_frames.empty()) ? m_frames.back().binder : nullptr;
+            bool isBatchItem = isArrayItem && !m_frames.empty() && m_frames.back().batch;
+            if (m_skipValues && !((binder || isBatchItem) && ch != '{' && ch != '[') &&
+                !(m_stream && (ch == '{' || ch == '[')) &&
+                !m_subscriptions->isValueNeeded(m_path.str, pathLen, pathHash, ch, isArrayItem) &&
+                !(m_subscriptions->hasPatterns() && isPatternValueNeeded(pathLen, pathHash, ch, isArrayItem)))
+            {
+                if (!(m_index && (ch == '{' || ch == '[') && jumpOverValue(Publisher::hash(&ch, 1, pathHash))))
+                    m_input.skipValue();
+            }
+            else if (ch == '{' || ch == '[')
+            {
+                if (m_maxDepth > 0 && m_baseDepth + m_frames.size() >= m_maxDepth)
+                    throwError(ERROR_MAX_DEPTH);
+                bool isArray = (ch == '[');
+                m_path.str[pathLen++] = ch;
+                if (m_hashPaths)
+                    pathHash = Publisher::hash(&ch, 1, pathHash);
+                Callback* batch = nullptr;
+                if (isArray && m_subscriptions->m_hasBatches)
+                {
+                    // The items of a batch must belong to one array, so those of an enclosing array are passed first.
+                    bool hasPending;
+                    m_path.setLength(pathLen);
+                    batch = findBatch(namePos, elemNameLen, pathLen, pathHash, hasPending);
+                    if (hasPending)
+                        flushPendingBatches(false);
+#ifdef JSONREADER_STATS
+                    batch = nullptr; // The items are passed by 'notify', which counts the lookups and the callbacks.
 #endif
+                }
+                binder = (!isArray && m_subscriptions->hasBinders())
+                             ? m_subscriptions->findBinder(m_path.str, pathLen, pathHash)
+                             : nullptr;
+                size_t position = m_newIndex ? m_input.getPosition() - 1 : 0;
+                FRAME frame = {pathLen, namePos, elemNameLen, isPathAscii, isArray, pathHash, binder, batch, position};
+                m_frames.push_back(frame);
+                if (binder)
+                    binder->begin();
+                if (isArray)
+                {
+                    notify(&m_subscriptions->m_onArrayBegin, namePos, elemNameLen, pathLen, pathHash);
+                    if (m_parallelRead && pathLen == m_parallelRead->arrayPath.length() &&
+                        memcmp(m_path.str, m_parallelRead->arrayPath.c_str(), pathLen) == 0)
+                        parseArrayInParallel(pathLen, namePos, elemNameLen);
+                }
+                else
+                    notify(&m_subscriptions->m_onObjectBegin, namePos, elemNameLen, pathLen, pathHash);
+                isValueComplete = false;
+            }
+            else
+            {
+                STR* elemValue = &m_elemValue;
+                if (ch == '\"') // key / value pair.
+                    parseString(m_elemValue);
+                else if ((ch >= '0' && ch <= '9') || ch == '-') // number.
+                    parseNumber(m_elemValue);
+                else if (parseTrue())
+                    m_elemValue.copy("true", 4);
+                else if (parseFalse())
+                    m_elemValue.copy("false", 5);
+                else if (parseNull())
+                {
+                    m_elemValue.clear(); // Do not keep the attributes of a previous value.
+                    elemValue = nullptr;
+                }
+                else
+                    throwError(ERROR_UNEXPECTED_CHARACTER, ch);
+                if (!isArrayItem)
+                {
+                    notify(&m_subscriptions->m_onPair, namePos, elemNameLen, pathLen, pathHash, elemValue);
+                    if (binder)
+                        binder->set(m_path.str + namePos, elemNameLen, elemValue);
+                }
+                else
+                    m_arrayItem.setValue(elemValue);
+                m_path.isAscii = isPathAscii;
+            }
+        }
 
-    if (length == 0)
-        return nullptr;
+        // Go on with the next member of the innermost object or array, ending those that are complete.
+        while (true)
+        {
+            if (isValueComplete)
+            {
+                if (m_input.getPosition() >= m_nextCheck && checkpoint())
+                    return; // The read is interrupted without unwinding, whatever the depth.
+                if (m_frames.size() == baseDepth)
+                    return;
+                const FRAME& parent = m_frames.back();
+                if (parent.batch)
+                    notifyBatch(parent.batch, parent.namePos, parent.nameLen, parent.pathLen, parent.pathHash,
+                                m_arrayItem.getValue());
+                else if (parent.isArray)
+                    notify(&m_subscriptions->m_onArrayItem, parent.namePos, parent.nameLen, parent.pathLen,
+                           parent.pathHash, m_arrayItem.getValue());
+            }
+
+            if (m_stream)
+            {
+                // If the text received ends before the next member, the parsing goes on from here.
+                m_stream->resumePosition = m_input.getPosition();
+                m_stream->isPathAscii = m_path.isAscii;
+                m_stream->isStarted = true;
+            }
+            const FRAME& frame = m_frames.back();
+            pathLen = frame.pathLen;
+            pathHash = frame.pathHash;
+            char ch = m_input.getNextChar();
+            if (frame.isArray && ch != ']')
+            {
+                m_elemName.clear();
+                m_elemValue.clear();
+                m_arrayItem.clear();
+                isArrayItem = true;
+                break;
+            }
+            if (!frame.isArray && ch != '}')
+            {
+                if (m_input.isEOF())
+                    throwError(ERROR_UNEXPECTED_END);
+                if (ch != '\"')
+                    throwError(ERROR_UNEXPECTED_CHARACTER, ch); // Such as the closing bracket of an array.
+                parseString(m_elemName);
+                m_input.getNextChar();
+                isArrayItem = false;
+                break;
+            }
+
+            // End of the object or array.
+            m_elemName.clear();
+            m_elemValue.clear();
+            if (frame.isArray)
+            {
+                m_arrayItem.clear();
+                if (m_subscriptions->m_hasBatches)
+                    flushBatches(frame.namePos, frame.nameLen, pathLen, pathHash, false);
+                notify(&m_subscriptions->m_onArrayEnd, frame.namePos, frame.nameLen, pathLen, pathHash);
+            }
+            else
+            {
+                if (frame.binder)
+                    frame.binder->end(); // The object is complete when its end is notified.
+                notify(&m_subscriptions->m_onObjectEnd, frame.namePos, frame.nameLen, pathLen, pathHash);
+            }
+            if (m_newIndex && m_input.getPosition() - frame.position >= INDEX_MIN_LEN)
+            {
+                // The current character is the closing bracket.
+                INDEX_ENTRY entry = {frame.position, m_input.getPosition() - 1, pathHash, 0};
+                entry.check = getIndexCheck(entry.begin, entry.end);
+                m_newIndex->push_back(entry);
+            }
+            m_path.isAscii = frame.isPathAscii;
+            m_frames.pop_back();
+            isValueComplete = true;
+        }
+    }
+}
 
-    if (length > m_lenMaxNarrow)
+bool JsonReader::checkpoint()
+{
+    size_t position = m_input.getPosition();
+    m_nextCheck = position + CHECK_INTERVAL;
+    if (m_notifyProgress)
     {
-        if (m_bufferNarrow)
-            delete[] m_bufferNarrow;
-        m_lenMaxNarrow = length;
-        m_bufferNarrow = new char[m_lenMaxNarrow + 1];
+        m_input.notifyProgress();
+        m_nextCheck = std::min(m_nextCheck, std::max(m_input.getNextProgress(), position + 1));
     }
+    return m_stop || m_cancel;
+}
 
-    if (lenOut)
-        (*lenOut) = length - 1;
+void JsonReader::parseString(STR& text)
+{
+    text.length = 0;
+    text.view = nullptr;
+    text.number = nullptr;
+    text.invalidate();
+    text.isAscii = true;
+    text.isQuoted = true;
 
-#ifdef USE_WINAPI
-    WideCharToMultiByte(CP_UTF8, 0, bufferWide, (int)lenWide, m_bufferNarrow, (int)length, nullptr, nullptr);
-    m_bufferNarrow[length] = 0;
-    return m_bufferNarrow;
-#else
-    return m_str.c_str();
-#endif
+    m_input.goToNextQuote();
+    char ch = m_input.isContiguous() ? m_input.readStringView(text) : m_input.readStringChars(text);
+    if (text.view)
+        return; // The string refers to the input data.
+    while (ch == '\\')
+    {
+        m_input.readEscapeSequence(text);
+        ch = m_input.readStringChars(text);
+    }
+    text.str[text.length] = 0;
 }
 
-const wchar_t* JsonReader::TextConverter::Utf8ToWide(const char* bufferUtf8, const size_t lenUtf8, size_t* lenOut)
+void JsonReader::parseNumber(STR& number)
 {
-    if (!bufferUtf8)
-        return nullptr;
+    number.length = 0;
+    number.view = nullptr;
+    number.number = &m_number;
+    number.invalidate();
+    number.isAscii = true;
+    number.isQuoted = false;
 
-    if (lenUtf8 == 0)
+    if (m_input.isContiguous())
     {
-        m_bufferWide[0] = 0;
-        return m_bufferWide;
+        // Numbers cannot contain escape sequences, so they always refer to the input data.
+        // They are converted directly from it, reading each character once.
+        number.view = m_input.getCurrentPtr();
+        number.length = m_number.parse(number.view, m_input.getRemainingLength());
+        m_input.moveForward(number.length - 1); // The current character is the last one of the number.
+        return;
     }
 
-    size_t length = 0;
-#ifdef USE_WINAPI
-    length = MultiByteToWideChar(CP_UTF8, 0, bufferUtf8, (int)lenUtf8, nullptr, 0);
-#else
-    m_wstr = m_codecvt.from_bytes(bufferUtf8);
-    length = m_wstr.length();
-#endif
+    char ch = m_input.getCurrentChar();
+    while (isNumericCharacter(ch))
+    {
+        if (number.length + 1 >= number.capacity)
+            number.resize((size_t)(number.length * RESIZE_FACTOR) + 2);
+        number.str[number.length++] = ch;
+        ch = m_input.getNextChar(true);
+    }
+    if (!m_input.isEOF()) // Otherwise the index was not moved.
+        m_input.goToPreviousChar();
+    number.str[number.length] = 0;
+    m_number.parse(number.str, number.length);
+}
 
-    if (length == 0)
-        return nullptr;
+bool JsonReader::isNumericCharacter(char ch)
+{
+    if ((ch < '0' || ch > '9') && ch != '.' && ch != '+' && ch != '-' && ch != 'e' && ch != 'E')
+        return false;
+    return true;
+}
+
+bool JsonReader::parseTrue() { return parseLiteral("true"); }
+
+bool JsonReader::parseFalse() { return parseLiteral("false"); }
 
-    if (length > m_lenMaxWide)
+bool JsonReader::parseNull() { return parseLiteral("null"); }
+
+bool JsonReader::parseLiteral(const char* literal)
+{
+    if (m_input.getCurrentChar() != *literal)
+        return false;
+    while (*++literal)
     {
-        if (m_bufferWide)
-            delete[] m_bufferWide;
-        m_lenMaxWide = length;
-        m_bufferWide = new wchar_t[m_lenMaxWide + 1];
-        m_bufferWide[0] = 0;
+        char ch = m_input.getNextChar(true);
+        if (m_input.isEOF()) // The character is not read if the input ends.
+            throwError(ERROR_UNEXPECTED_END);
+        if (ch != *literal)
+            throwError(ERROR_UNEXPECTED_CHARACTER, ch);
     }
+    return true;
+}
 
-    if (lenOut)
-        (*lenOut) = length - 1;
+bool JsonReader::readFile(const char* fileFullPath) { return read(fileFullPath, 0, true); }
 
-#ifdef USE_WINAPI
-    MultiByteToWideChar(CP_UTF8, 0, bufferUtf8, -1, m_bufferWide, (int)length);
-    m_bufferWide[length] = 0;
-    return m_bufferWide;
-#else
-    return m_wstr.c_str();
+bool JsonReader::readBuffer(const char* buffer) { return read(buffer, buffer ? strlen(buffer) : 0, false); }
+
+bool JsonReader::readBuffer(const char* buffer, size_t bufferLen) { return read(buffer, bufferLen, false); }
+
+bool JsonReader::readSource(Source& source)
+{
+    m_input.setSource(&source);
+    return read(nullptr, 0, false);
+}
+
+bool JsonReader::read(const char* source, size_t sourceLen, bool isFile, PATH_LIST* pathList,
+                      const ARRAY_RANGE* arrayRange)
+{
+    bool succeeded = true;
+    JsonReader* previousReader = s_currentReader; // A callback may read another text.
+    s_currentReader = this;
+    m_cancel = false;
+    m_stop = false;
+    m_nextCheck = 0; // The progress is checked after the first value.
+    m_errorCode = ERROR_NONE;
+    m_errDescription.clear();
+    // A text received in fragments goes on from the last member completed, once its root value has begun.
+    bool isResumed = m_stream && m_stream->isStarted;
+    try
+    {
+        if (!isResumed)
+            clearStrings(); // The path is kept, along with the frames.
+
+        m_input.init(source, sourceLen, isFile);
+
+        // Store unique JSON paths in array 'pathList', which requires to parse all values.
+        // The array parsed concurrently must not be skipped either.
+        m_pathList = pathList;
+        m_skipValues = m_subscriptions->m_canSkipValues && !pathList && !m_parallelRead && !m_newIndex;
+        // The paths are found by their hash, as are the entries of an index.
+        m_hashPaths = m_subscriptions->isPathHashNeeded() || pathList || m_newIndex || m_index;
+        m_baseDepth = arrayRange ? arrayRange->depth : 0;
+        m_arrayRange = arrayRange;
+        if (m_subscriptions->hasPatterns() && m_patternCache.patternsId != m_subscriptions->m_patternsId)
+        {
+            // The paths were matched against other patterns.
+            m_patternCache.matches.clear();
+            m_patternCache.arena.reset();
+            m_patternCache.patternsId = m_subscriptions->m_patternsId;
+        }
+#ifdef JSONREADER_STATS
+        m_stats.bytesScanned -= arrayRange ? arrayRange->position : 0; // The range's position is added at the end.
 #endif
+        if (m_frames.capacity() == 0)
+            m_frames.reserve(INITIAL_DEPTH); // Allocated on the first read, so that constructing a reader is cheap.
+
+        if (isResumed)
+            parseValue(0, Publisher::HASH_SEED, false, true);
+        else if (arrayRange)
+            parseArrayItems(*arrayRange);
+        else if (m_input.findFirstChar())
+            parseValue(0, Publisher::HASH_SEED);
+        if (m_cancel)
+        {
+            m_errorCode = ERROR_CANCELLED;
+            succeeded = false;
+        }
+        else
+        {
+            if (m_subscriptions->m_hasBatches)
+                flushPendingBatches(false); // The arrays were left open if the read was stopped.
+            if (m_notifyProgress)
+                m_input.notifyProgressEnd();
+        }
+    }
+    catch (FRAGMENT_END& e)
+    {
+        // The member being parsed is parsed again along with the next fragment, so its text is kept.
+        STREAM& stream = *m_stream;
+        size_t offset = stream.resumePosition - stream.position;
+        if (stream.buffer == stream.data.data())
+            stream.data.erase(stream.data.begin(), stream.data.begin() + offset);
+        else
+            stream.data.assign(stream.buffer + offset, stream.buffer + stream.len);
+        stream.position = stream.resumePosition;
+        stream.isInString = e.isInString;
+        s_currentReader = previousReader;
+        return true;
+    }
+    catch (ERROR_INFO& e)
+    {
+        if (m_errDescription.empty()) // Otherwise it has been built by a thread parsing the input in parallel.
+            setError(e.code, e.arg ? e.arg : (e.ch ? std::string(1, e.ch) : std::string()));
+        else
+            m_errorCode = e.code;
+        succeeded = false;
+    }
+    catch (std::exception& e)
+    {
+        // Thrown by a callback or by the standard library.
+        setError(ERROR_EXCEPTION, e.what());
+        succeeded = false;
+    }
+    if (!succeeded && m_subscriptions->m_hasBatches)
+        flushPendingBatches(true);
+    COUNT_STAT(m_stats.bytesScanned, m_input.getPosition());
+    if (m_stream)
+    {
+        m_stream->isDone = true;
+        m_stream->succeeded = succeeded;
+    }
+    clear();
+    s_currentReader = previousReader;
+    return succeeded;
+}
+
+void JsonReader::setError(ERROR_CODE code, const std::string& arg)
+{
+    // Only the context is stored. The description is built if requested.
+    m_errorCode = code;
+    m_errorArg = (code == ERROR_MAX_DEPTH) ? std::to_string(m_maxDepth) : arg;
+    m_errorPosition = m_input.getPosition();
+    m_errorPath = m_path.str;
+}
+
+std::string JsonReader::getErrorDescription()
+{
+    if (m_errDescription.empty() && m_errorCode != ERROR_NONE)
+    {
+        // Messages indexed by the error code, where '%s' is replaced by the argument of the error.
+        static const char* messages[] = {"",
+                                         "Cannot open file.",
+                                         "Cannot set buffer.",
+                                         "Unexpected end of file.",
+                                         "Unexpected character '%s'.",
+                                         "Invalid escape sequence '\\%s'.",
+                                         "Invalid hex digit '%s'.",
+                                         "Invalid number '%s'.",
+                                         "The value '%s' is not a number.",
+                                         "The number '%s' is not an integer.",
+                                         "The number '%s' is out of range.",
+                                         "The value '%s' is not a boolean.",
+                                         "The nesting depth exceeds the maximum of %s.",
+                                         "The input must be contiguous in memory to be read in parallel.",
+                                         "Invalid compressed data (%s).",
+                                         "The input is compressed with %s, which is not supported by this build.",
+                                         "Cannot write the index file '%s'.",
+                                         "The process has been cancelled.",
+                                         "%s"};
+        char message[2048];
+        snprintf(message, sizeof(message), messages[m_errorCode], m_errorArg.c_str());
+        std::ostringstream description;
+        description << message;
+        if (m_errorCode != ERROR_CANCELLED)
+        {
+            if (m_errorPosition > 0)
+                description << " Byte Position: " << m_errorPosition << ".";
+            if (!m_errorPath.empty())
+                description << " JSON path: '" << m_errorPath << "'.";
+        }
+        m_errDescription = description.str();
+    }
+    return m_errDescription;
+}
+
+std::string JsonReader::getCurrentElementPath() { return std::string(m_path.toNarrow()); }
+
+std::wstring JsonReader::getCurrentElementPathWide() { return std::wstring(m_path.toWide()); }
+
+void JsonReader::getCurrentElementPath(std::string& elementPath) { elementPath = m_path.toNarrow(); }
+
+void JsonReader::getCurrentElementPathWide(std::wstring& elementPath) { elementPath = m_path.toWide(); }
+
+std::string JsonReader::getCurrentElementName()
+{
+    std::string str;
+    getCurrentElementName(str);
+    return str;
+}
+
+std::wstring JsonReader::getCurrentElementNameWide()
+{
+    std::wstring wstr;
+    getCurrentElementNameWide(wstr);
+    return wstr;
+}
+
+void JsonReader::getCurrentElementName(std::string& elementName)
+{
+    if (m_currentName)
+    {
+        m_currentElemName.copy(m_currentName, m_currentNameLen, true, true);
+        elementName.assign(m_currentElemName.toNarrow());
+    }
+    else
+        elementName.clear();
+}
+
+void JsonReader::getCurrentElementNameWide(std::wstring& elementName)
+{
+    if (m_currentName)
+    {
+        m_currentElemName.copy(m_currentName, m_currentNameLen, true, true);
+        elementName.assign(m_currentElemName.toWide());
+    }
+    else
+        elementName.clear();
+}
+
+bool JsonReader::getPathsFromFile(const char* fileFullPath, std::set<std::wstring>& paths)
+{
+    return getPaths(fileFullPath, 0, true, &paths, nullptr);
+}
+
+bool JsonReader::getPathsFromBuffer(const char* buffer, std::set<std::wstring>& paths)
+{
+    return getPaths(buffer, buffer ? strlen(buffer) : 0, false, &paths, nullptr);
+}
+
+bool JsonReader::getPathsFromBuffer(const char* buffer, size_t bufferLen, std::set<std::wstring>& paths)
+{
+    return getPaths(buffer, bufferLen, false, &paths, nullptr);
+}
+
+bool JsonReader::getPathsFromFile(const char* fileFullPath, PATH_INFO_MAP& paths)
+{
+    return getPaths(fileFullPath, 0, true, nullptr, &paths);
+}
+
+bool JsonReader::getPathsFromBuffer(const char* buffer, size_t bufferLen, PATH_INFO_MAP& paths)
+{
+    return getPaths(buffer, bufferLen, false, nullptr, &paths);
+}
+
+bool JsonReader::getPaths(const char* source, size_t sourceLen, bool isFile, std::set<std::wstring>* paths,
+                          PATH_INFO_MAP* pathInfo)
+{
+    PATH_LIST pathList;
+    bool succeeded = read(source, sourceLen, isFile, &pathList);
+
+    // Only the unique paths are converted, once the input has been read. Those found before an error are returned
+    // as well.
+    std::wstring wide;
+    for (const std::pair<const KEY, PATH_INFO>& path : pathList.paths)
+    {
+        if (paths)
+        {
+            wide.resize(path.first.len);
+            wide.resize(utf8ToWide(path.first.str, path.first.len, &wide[0]));
+            paths->insert(wide);
+        }
+        if (pathInfo)
+        {
+            PATH_INFO& info = (*pathInfo)[std::string(path.first.str, path.first.len)];
+            info.count += path.second.count;
+            info.types |= path.second.types;
+        }
+    }
+    return succeeded;
+}
+
+bool JsonReader::readFileLines(const char* fileFullPath, std::function<void(JsonReader&, unsigned)> setup,
+                               std::function<void(unsigned)> commit, unsigned numThreads)
+{
+    JsonInput input;
+    input.setMemoryMapping(true);
+    try
+    {
+        input.init(fileFullPath, 0, true);
+    }
+    catch (ERROR_INFO& e)
+    {
+        setError(e.code, std::string());
+        return false;
+    }
+    catch (std::exception& e)
+    {
+        setError(ERROR_EXCEPTION, e.what());
+        return false;
+    }
+    if (!input.isContiguous()) // A compressed file, which is not mapped.
+    {
+        setError(ERROR_NOT_CONTIGUOUS, std::string());
+        return false;
+    }
+    return readLines(input.getData(), input.getLength(), setup, commit, numThreads);
+}
+
+bool JsonReader::readBufferLines(const char* buffer, size_t bufferLen, std::function<void(JsonReader&, unsigned)> setup,
+                                 std::function<void(unsigned)> commit, unsigned numThreads)
+{
+    if (!buffer)
+    {
+        setError(ERROR_CANNOT_SET_BUFFER, std::string());
+        return false;
+    }
+    return readLines(buffer, bufferLen, setup, commit, numThreads);
+}
+
+bool JsonReader::readLines(const char* buffer, size_t bufferLen, std::function<void(JsonReader&, unsigned)>& setup,
+                           std::function<void(unsigned)>& commit, unsigned numThreads)
+{
+    // Split the buffer into chunks that end at a line break (or at the end of the buffer).
+    std::vector<size_t> chunkEnds;
+    size_t chunkEnd = 0;
+    while (chunkEnd < bufferLen)
+    {
+        chunkEnd = (bufferLen - chunkEnd > PARALLEL_CHUNK_LEN) ? chunkEnd + PARALLEL_CHUNK_LEN : bufferLen;
+        const char* lineEnd = (const char*)memchr(buffer + chunkEnd, '\n', bufferLen - chunkEnd);
+        chunkEnd = lineEnd ? (size_t)(lineEnd - buffer) + 1 : bufferLen;
+        chunkEnds.push_back(chunkEnd);
+    }
+
+    CHUNK_PARSER parseChunk = [buffer](JsonReader& reader, size_t begin, size_t end, size_t& errorPosition,
+                                       std::string& errorDescription)
+    {
+        while (begin < end)
+        {
+            const char* line = buffer + begin;
+            const char* lineEnd = (const char*)memchr(line, '\n', end - begin);
+            size_t lineLen = lineEnd ? (size_t)(lineEnd - line) : end - begin;
+            if (!reader.readBuffer(line, lineLen))
+            {
+                errorPosition = begin;
+                errorDescription = reader.getErrorDescription() + " Line position: " + std::to_string(begin) + ".";
+                return false;
+            }
+            begin += lineLen + 1;
+        }
+        return true;
+    };
+    return parseChunks(0, chunkEnds, parseChunk, setup, commit, numThreads);
+}
+
+bool JsonReader::parseChunks(size_t begin, const std::vector<size_t>& chunkEnds, CHUNK_PARSER& parseChunk,
+                             std::function<void(JsonReader&, unsigned)>& setup, std::function<void(unsigned)>& commit,
+                             unsigned numThreads)
+{
+    if (numThreads == 0)
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    numThreads = (unsigned)std::min((size_t)numThreads, std::max(chunkEnds.size(), (size_t)1));
+
+    std::atomic<size_t> nextChunk(0); // Index of the next chunk to be parsed.
+    std::atomic<bool> failed(false);   // True if a chunk could not be parsed.
+    size_t nextCommit = 0;             // Index of the next chunk to be committed.
+    size_t errorPosition = (size_t)-1; // Position of the first error found.
+    std::mutex mutex;
+    std::condition_variable committed;
+    m_errorCode = ERROR_NONE;
+    m_errDescription.clear();
+
+    auto parseChunksInThread = [&](unsigned thread)
+    {
+        JsonReader reader;
+        Subscriptions subscriptions; // Keeps the callbacks of this thread across reads.
+        reader.useSubscriptions(&subscriptions);
+        setup(reader, thread);
+
+        size_t chunk;
+        while (!failed && (chunk = nextChunk++) < chunkEnds.size())
+        {
+            size_t chunkErrorPosition = 0;
+            std::string chunkErrorDescription;
+            if (!parseChunk(reader, chunk > 0 ? chunkEnds[chunk - 1] : begin, chunkEnds[chunk], chunkErrorPosition,
+                            chunkErrorDescription))
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (chunkErrorPosition < errorPosition)
+                {
+                    errorPosition = chunkErrorPosition;
+                    m_errorCode = reader.getErrorCode();
+                    m_errDescription = chunkErrorDescription;
+                }
+                failed = true;
+                committed.notify_all();
+                return;
+            }
+
+            if (commit)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                committed.wait(lock, [&]() { return nextCommit == chunk || failed; });
+                if (failed)
+                    return;
+                commit(thread);
+                nextCommit++;
+                committed.notify_all();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned thread = 1; thread < numThreads; thread++)
+        threads.push_back(std::thread(parseChunksInThread, thread));
+    parseChunksInThread(0); // The calling thread is used as well.
+    for (std::thread& thread : threads)
+        thread.join();
+    return !failed;
+}
+
+bool JsonReader::feed(const char* data, size_t len)
+{
+    if (!m_stream)
+        m_stream = new STREAM();
+    STREAM& stream = *m_stream;
+    if (stream.isDone)
+        return stream.succeeded; // The fragments are ignored until 'finish' is called.
+    if (!data || len == 0)
+        return true;
+
+    if (stream.data.empty())
+    {
+        // The fragment is parsed in place, and only the text of the member it ends in is kept.
+        stream.buffer = data;
+        stream.len = len;
+    }
+    else
+    {
+        stream.data.insert(stream.data.end(), data, data + len);
+        if (stream.isInString && !memchr(data, '\"', len))
+            return true; // The string being parsed does not end in this fragment either.
+        stream.buffer = stream.data.data();
+        stream.len = stream.data.size();
+    }
+    m_input.setStream(m_stream);
+    return read(nullptr, 0, false);
+}
+
+bool JsonReader::finish()
+{
+    if (!m_stream)
+        m_stream = new STREAM();
+    STREAM& stream = *m_stream;
+    if (!stream.isDone)
+    {
+        // The text kept is parsed up to its end, so the member being parsed is either completed or truncated.
+        stream.isFinished = true;
+        stream.buffer = stream.data.data();
+        stream.len = stream.data.size();
+        m_input.setStream(m_stream);
+        read(nullptr, 0, false);
+    }
+    bool succeeded = stream.succeeded;
+    delete m_stream;
+    m_stream = nullptr;
+    return succeeded;
+}
+
+// Lengths of the header and of each entry of an index file, as they are written.
+static const size_t INDEX_HEADER_LEN = 48;
+static const size_t INDEX_ENTRY_LEN = 32;
+
+// Appends the 'numBytes' lower bytes of 'value' to 'data', from the least significant one.
+static void appendLittleEndian(std::string& data, uint64_t value, size_t numBytes)
+{
+    for (size_t i = 0; i < numBytes; i++)
+        data += (char)(unsigned char)(value >> (i * 8));
+}
+
+// Returns the value of the 'numBytes' bytes at 'data', from the least significant one.
+static uint64_t readLittleEndian(const char* data, size_t numBytes)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < numBytes; i++)
+        value |= (uint64_t)(unsigned char)data[i] << (i * 8);
+    return value;
+}
+
+bool JsonReader::writeIndex(const char* fileFullPath, const char* indexFullPath)
+{
+    std::vector<INDEX_ENTRY> entries;
+    m_newIndex = &entries;
+    bool useMapping = m_input.getMemoryMapping();
+    m_input.setMemoryMapping(true); // The bytes checked at the beginning of each entry are still available at its end.
+    bool succeeded = read(fileFullPath, 0, true);
+    m_input.setMemoryMapping(useMapping);
+    m_newIndex = nullptr;
+    if (!succeeded)
+        return false;
+
+    // The entries were added as the objects and arrays ended, after those nested in them.
+    std::sort(entries.begin(), entries.end(),
+              [](const INDEX_ENTRY& entry1, const INDEX_ENTRY& entry2) { return entry1.begin < entry2.begin; });
+    std::string indexPath = getIndexPath(fileFullPath, indexFullPath);
+    INDEX_HEADER header = {{'J', 'R', 'I', 'X'}, INDEX_VERSION, 0, 0, 0, 0, entries.size()};
+    std::ofstream index(indexPath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (getFileInfo(fileFullPath, header) && index.is_open())
+    {
+        std::string data;
+        data.reserve(INDEX_HEADER_LEN + entries.size() * INDEX_ENTRY_LEN);
+        data.append(header.magic, 4);
+        appendLittleEndian(data, header.version, 4);
+        appendLittleEndian(data, header.fileSize, 8);
+        appendLittleEndian(data, (uint64_t)header.fileTime, 8);
+        appendLittleEndian(data, (uint64_t)header.fileChangeTime, 8);
+        appendLittleEndian(data, header.fileId, 8);
+        appendLittleEndian(data, header.numEntries, 8);
+        for (const INDEX_ENTRY& entry : entries)
+        {
+            appendLittleEndian(data, entry.begin, 8);
+            appendLittleEndian(data, entry.end, 8);
+            appendLittleEndian(data, entry.pathHash, 8);
+            appendLittleEndian(data, entry.check, 8);
+        }
+        index.write(data.data(), data.length());
+        index.close();
+        if (index)
+            return true;
+    }
+    setError(ERROR_CANNOT_WRITE_INDEX, indexPath);
+    return false;
+}
+
+bool JsonReader::readFileIndexed(const char* fileFullPath, const char* indexFullPath)
+{
+    std::vector<INDEX_ENTRY> entries;
+    if (loadIndex(fileFullPath, getIndexPath(fileFullPath, indexFullPath), entries))
+    {
+        m_index = &entries;
+        m_indexPos = 0;
+    }
+    bool useMapping = m_input.getMemoryMapping();
+    m_input.setMemoryMapping(true); // The parts of the file jumped over are then not read from the storage.
+    bool succeeded = read(fileFullPath, 0, true);
+    m_input.setMemoryMapping(useMapping);
+    m_index = nullptr;
+    return succeeded;
+}
+
+std::string JsonReader::getIndexPath(const char* fileFullPath, const char* indexFullPath)
+{
+    return indexFullPath ? std::string(indexFullPath) : std::string(fileFullPath) + ".jri";
+}
+
+bool JsonReader::loadIndex(const char* fileFullPath, const std::string& indexPath, std::vector<INDEX_ENTRY>& entries)
+{
+    char data[INDEX_HEADER_LEN];
+    INDEX_HEADER file;
+    std::ifstream index(indexPath.c_str(), std::ios::in | std::ios::binary);
+    if (!index.read(data, INDEX_HEADER_LEN) || memcmp(data, "JRIX", 4) != 0 ||
+        readLittleEndian(data + 4, 4) != INDEX_VERSION || !getFileInfo(fileFullPath, file) ||
+        readLittleEndian(data + 8, 8) != file.fileSize || (int64_t)readLittleEndian(data + 16, 8) != file.fileTime ||
+        (int64_t)readLittleEndian(data + 24, 8) != file.fileChangeTime || readLittleEndian(data + 32, 8) != file.fileId)
+        return false;
+    uint64_t numEntries = readLittleEndian(data + 40, 8);
+    if (numEntries > file.fileSize)
+        return false;
+    std::vector<char> entryData((size_t)numEntries * INDEX_ENTRY_LEN);
+    if (!index.read(entryData.data(), entryData.size()))
+        return false;
+    entries.resize((size_t)numEntries);
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        const char* entry = entryData.data() + i * INDEX_ENTRY_LEN;
+        entries[i].begin = readLittleEndian(entry, 8);
+        entries[i].end = readLittleEndian(entry + 8, 8);
+        entries[i].pathHash = readLittleEndian(entry + 16, 8);
+        entries[i].check = readLittleEndian(entry + 24, 8);
+    }
+    return true;
+}
+
+bool JsonReader::getFileInfo(const char* fileFullPath, INDEX_HEADER& header)
+{
+#ifdef USE_WINAPI
+    HANDLE file = CreateFileA(fileFullPath, FILE_READ_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    BY_HANDLE_FILE_INFORMATION info;
+    FILE_BASIC_INFO basicInfo;
+    bool succeeded = GetFileInformationByHandle(file, &info) &&
+                     GetFileInformationByHandleEx(file, FileBasicInfo, &basicInfo, sizeof(basicInfo));
+    CloseHandle(file);
+    if (!succeeded)
+        return false;
+    // The times are in units of 100 nanoseconds.
+    header.fileSize = ((uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+    header.fileTime = basicInfo.LastWriteTime.QuadPart * 100;
+    header.fileChangeTime = basicInfo.ChangeTime.QuadPart * 100;
+    header.fileId = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+#else
+    struct stat fileStat;
+    if (stat(fileFullPath, &fileStat) != 0)
+        return false;
+    header.fileSize = (uint64_t)fileStat.st_size;
+#ifdef __APPLE__
+    header.fileTime = (int64_t)fileStat.st_mtimespec.tv_sec * 1000000000 + fileStat.st_mtimespec.tv_nsec;
+    header.fileChangeTime = (int64_t)fileStat.st_ctimespec.tv_sec * 1000000000 + fileStat.st_ctimespec.tv_nsec;
+#else
+    header.fileTime = (int64_t)fileStat.st_mtim.tv_sec * 1000000000 + fileStat.st_mtim.tv_nsec;
+    header.fileChangeTime = (int64_t)fileStat.st_ctim.tv_sec * 1000000000 + fileStat.st_ctim.tv_nsec;
+#endif
+    header.fileId = (uint64_t)fileStat.st_ino;
+#endif
+    return true;
+}
+
+uint64_t JsonReader::getIndexCheck(uint64_t begin, uint64_t end)
+{
+    // The indexed objects and arrays are longer than both sets of bytes, which are read from the mapped file.
+    char bytes[INDEX_CHECK_LEN * 2];
+    for (size_t i = 0; i < INDEX_CHECK_LEN; i++)
+    {
+        bytes[i] = m_input.getCharAt((size_t)(begin + 1 + i));
+        bytes[INDEX_CHECK_LEN + i] = m_input.getCharAt((size_t)(end - 1 - i));
+    }
+    return Publisher::hash(bytes, sizeof(bytes));
+}
+
+bool JsonReader::jumpOverValue(uint64_t pathHash)
+{
+    // The values are skipped in the order of their positions, so the entries already passed are not looked at again.
+    const std::vector<INDEX_ENTRY>& index = *m_index;
+    uint64_t position = m_input.getPosition() - 1;
+    std::vector<INDEX_ENTRY>::const_iterator it =
+        std::lower_bound(index.begin() + m_indexPos, index.end(), position,
+                         [](const INDEX_ENTRY& entry, uint64_t position) { return entry.begin < position; });
+    m_indexPos = it - index.begin();
+    if (it == index.end() || it->begin != position || it->pathHash != pathHash)
+        return false;
+    // The closing bracket and the bytes next to both brackets are checked as well, in case the file was modified
+    // without changing its size and times.
+    char closingBracket = (m_input.getCurrentChar() == '{') ? '}' : ']';
+    if (m_input.getCharAt((size_t)it->end) != closingBracket || getIndexCheck(it->begin, it->end) != it->check)
+        return false;
+#ifdef JSONREADER_STATS
+    m_stats.bytesScanned -= (size_t)(it->end - position); // The bytes jumped over are not scanned.
+#endif
+    m_input.moveTo((size_t)it->end);
+    return true;
+}
+
+bool JsonReader::readFileParallel(const char* fileFullPath, const char* arrayPathUtf8,
+                                  std::function<void(JsonReader&, unsigned)> setup,
+                                  std::function<void(unsigned)> commit, unsigned numThreads)
+{
+    PARALLEL_READ parallelRead = {arrayPathUtf8 ? arrayPathUtf8 : "", &setup, &commit, numThreads};
+    m_parallelRead = &parallelRead;
+    bool useMapping = m_input.getMemoryMapping();
+    m_input.setMemoryMapping(true); // The array is split in place, so the file must be contiguous in memory.
+    bool succeeded = read(fileFullPath, 0, true);
+    m_input.setMemoryMapping(useMapping);
+    m_parallelRead = nullptr;
+    return succeeded;
+}
+
+bool JsonReader::readBufferParallel(const char* buffer, size_t bufferLen, const char* arrayPathUtf8,
+                                    std::function<void(JsonReader&, unsigned)> setup,
+                                    std::function<void(unsigned)> commit, unsigned numThreads)
+{
+    PARALLEL_READ parallelRead = {arrayPathUtf8 ? arrayPathUtf8 : "", &setup, &commit, numThreads};
+    m_parallelRead = &parallelRead;
+    bool succeeded = read(buffer, bufferLen, false);
+    m_parallelRead = nullptr;
+    return succeeded;
+}
+
+void JsonReader::throwError(ERROR_CODE code, const char* arg)
+{
+    ERROR_INFO error = {code, arg, 0};
+    throw error;
+}
+
+void JsonReader::throwError(ERROR_CODE code, char ch)
+{
+    ERROR_INFO error = {code, nullptr, ch};
+    throw error;
+}
+
+void JsonReader::throwException(const char* format, ...)
+{
+    char buffer[2048];
+    va_list argptr;
+    va_start(argptr, format);
+    vsnprintf(buffer, 2048, format, argptr);
+    va_end(argptr);
+    throw std::runtime_error(std::string(buffer));
+}
+
+void JsonReader::useLocale(bool useLocale, const char* locale)
+{
+    setStringsLocale(useLocale);
+    if (locale == NULL)
+        setlocale(LC_ALL, "");
+    else if (setlocale(LC_ALL, locale) == NULL)
+        throwException("Locale '%s' not found.", locale);
+}
+
+void JsonReader::setStringsLocale(bool useLocale)
+{
+    m_useLocale = useLocale;
+    m_elemName.useLocale = useLocale;
+    m_elemValue.useLocale = useLocale;
+    m_path.useLocale = useLocale;
+    m_currentElemName.useLocale = useLocale;
+}
+
+void JsonReader::configure(const CONFIG& config)
+{
+    useSubscriptions(config.subscriptions);
+    setStringsLocale(config.useLocale);
+    setMaxDepth(config.maxDepth);
+    setFileBuffers(config.fileBufferLen, config.numFileBuffers);
+    useMemoryMapping(config.useMapping);
+}
+
+JsonReader* JsonReader::getCurrentReader() { return s_currentReader; }
+
+void JsonReader::notify(Publisher* publisher, size_t namePos, size_t nameLen, size_t pathLen, uint64_t pathHash,
+                        STR* value)
+{
+    m_path.setLength(pathLen);
+    m_currentName = m_path.str + namePos;
+    m_currentNameLen = nameLen;
+    m_currentPathHash = pathHash;
+    if (m_pathList && (publisher == &m_subscriptions->m_onObjectBegin ||
+                       publisher == &m_subscriptions->m_onArrayBegin || publisher == &m_subscriptions->m_onPair))
+        addPath(publisher, pathLen, pathHash, value);
+#ifdef JSONREADER_STATS
+    Subscriptions* subs = m_subscriptions;
+    STATS::EVENT_TYPE type = publisher == &subs->m_onObjectBegin ? STATS::OBJECT_BEGIN
+                             : publisher == &subs->m_onObjectEnd ? STATS::OBJECT_END
+                             : publisher == &subs->m_onArrayBegin ? STATS::ARRAY_BEGIN
+                             : publisher == &subs->m_onArrayEnd   ? STATS::ARRAY_END
+                             : publisher == &subs->m_onArrayItem  ? STATS::ARRAY_ITEM
+                                                                  : STATS::PAIR;
+    m_stats.events[type]++;
+    size_t numCallbacks = m_stats.callbacks;
+    double callbackSeconds = m_stats.callbackSeconds;
+#endif
+    Callback* patterns[Subscriptions::MAX_PATTERNS];
+    size_t numPatterns = publisher->getPatterns() ? findPatterns(publisher, pathLen, pathHash, patterns) : 0;
+#ifdef JSONREADER_STATS
+    publisher->notify(m_path.str, pathLen, pathHash, m_currentName, nameLen, patterns, numPatterns, value, m_stats);
+    if (m_traceHook && m_stats.callbacks > numCallbacks)
+        m_traceHook(type, m_path.str, m_stats.callbackSeconds - callbackSeconds);
+#else
+    publisher->notify(m_path.str, pathLen, pathHash, m_currentName, nameLen, patterns, numPatterns, value);
+#endif
+}
+
+void JsonReader::notifyBatch(Callback* batch, size_t namePos, size_t nameLen, size_t pathLen, uint64_t pathHash,
+                             STR* value)
+{
+    m_path.setLength(pathLen);
+    m_currentName = m_path.str + namePos;
+    m_currentNameLen = nameLen;
+    m_currentPathHash = pathHash;
+    batch->notify(value);
+}
+
+void JsonReader::flushBatches(size_t namePos, size_t nameLen, size_t pathLen, uint64_t pathHash, bool isDiscarded)
+{
+    // The callbacks get the context of the array, as with the items notified one by one.
+    m_path.setLength(pathLen);
+    m_currentName = m_path.str + namePos;
+    m_currentNameLen = nameLen;
+    m_currentPathHash = pathHash;
+    m_subscriptions->m_onArrayItem.flush(m_path.str, pathLen, pathHash, m_currentName, nameLen, isDiscarded);
+    const Publisher& publisher = m_subscriptions->m_onArrayItem;
+    Callback* patterns[Subscriptions::MAX_PATTERNS];
+    size_t numPatterns = publisher.getPatterns() ? findPatterns(&publisher, pathLen, pathHash, patterns) : 0;
+    for (size_t i = 0; i < numPatterns; i++)
+        patterns[i]->flush(isDiscarded);
+}
+
+void JsonReader::flushPendingBatches(bool isDiscarded)
+{
+    // The items of the arrays that are complete have already been passed, so the pending ones belong to the arrays
+    // that are still open. The characters of the path overwritten by the null terminator of each array's path are
+    // restored, as the path of an array being begun extends them.
+    size_t pathLen = m_path.length;
+    for (size_t i = m_frames.size(); i > 0; i--)
+    {
+        const FRAME& frame = m_frames[i - 1];
+        if (frame.isArray)
+        {
+            char nextChar = m_path.str[frame.pathLen];
+            flushBatches(frame.namePos, frame.nameLen, frame.pathLen, frame.pathHash, isDiscarded);
+            m_path.str[frame.pathLen] = nextChar;
+        }
+    }
+    if (m_arrayRange)
+    {
+        char nextChar = m_path.str[m_arrayRange->pathLen];
+        flushBatches(m_arrayRange->namePos, m_arrayRange->nameLen, m_arrayRange->pathLen, m_arrayRange->pathHash,
+                     isDiscarded);
+        m_path.str[m_arrayRange->pathLen] = nextChar;
+    }
+    m_path.setLength(pathLen);
+}
+
+JsonReader::Callback* JsonReader::findBatch(size_t namePos, size_t nameLen, size_t pathLen, uint64_t pathHash,
+                                            bool& hasPending)
+{
+    const Publisher& publisher = m_subscriptions->m_onArrayItem;
+    Callback* batch =
+        publisher.findBatch(m_path.str, pathLen, pathHash, m_path.str + namePos, nameLen, hasPending);
+    Callback* patterns[Subscriptions::MAX_PATTERNS];
+    size_t numPatterns = publisher.getPatterns() ? findPatterns(&publisher, pathLen, pathHash, patterns) : 0;
+    for (size_t i = 0; i < numPatterns; i++)
+    {
+        // The items are passed one by one, as the patterns may have been subscribed along with other callbacks.
+        hasPending = hasPending || patterns[i]->hasPending();
+        batch = nullptr;
+    }
+    return batch;
+}
+
+const JsonReader::PATTERN_MATCH& JsonReader::matchPatterns(size_t pathLen, uint64_t pathHash)
+{
+    KEY key = {m_path.str, pathLen, pathHash};
+    auto it = m_patternCache.matches.find(key);
+    if (it != m_patternCache.matches.end())
+        return it->second;
+    if (m_patternCache.matches.size() >= PATTERN_CACHE_LEN)
+    {
+        // The input has too many unique paths, such as those of objects keyed on ids: start over rather than keep them.
+        m_patternCache.matches.clear();
+        m_patternCache.arena.reset();
+    }
+    PATTERN_MATCH match;
+    m_subscriptions->matchPatterns(m_path.str, pathLen, match.matches, match.prefixes);
+    key.str = m_patternCache.arena.copy(m_path.str, pathLen);
+    return m_patternCache.matches.insert(std::make_pair(key, match)).first->second;
+}
+
+size_t JsonReader::findPatterns(const Publisher* publisher, size_t pathLen, uint64_t pathHash, Callback** callbacks)
+{
+    COUNT_STAT(m_stats.lookups, 1);
+    uint64_t patterns = matchPatterns(pathLen, pathHash).matches & publisher->getPatterns();
+    size_t numPatterns = 0;
+    while (patterns)
+    {
+        // The patterns subscribed first are the lowest bits.
+        callbacks[numPatterns++] = m_subscriptions->m_patterns[COUNT_TRAILING_ZEROS64(patterns)].callback;
+        patterns &= patterns - 1;
+    }
+    COUNT_STAT(m_stats.hits, numPatterns > 0);
+    return numPatterns;
+}
+
+bool JsonReader::isPatternValueNeeded(size_t pathLen, uint64_t pathHash, char ch, bool isArrayItem)
+{
+    if (ch == '{' || ch == '[')
+    {
+        // As with the subscribed paths, the byte that follows the path is overwritten by the bracket.
+        char backupChar = m_path.str[pathLen];
+        m_path.str[pathLen] = ch;
+        bool isNeeded = matchPatterns(pathLen + 1, Publisher::hash(&ch, 1, pathHash)).prefixes != 0;
+        m_path.str[pathLen] = backupChar;
+        return isNeeded;
+    }
+    const Publisher& publisher = isArrayItem ? m_subscriptions->m_onArrayItem : m_subscriptions->m_onPair;
+    return publisher.getPatterns() && (matchPatterns(pathLen, pathHash).matches & publisher.getPatterns()) != 0;
+}
+
+void JsonReader::addPath(Publisher* publisher, size_t pathLen, uint64_t pathHash, STR* value)
+{
+    KEY key = {m_path.str, pathLen, pathHash};
+    auto it = m_pathList->paths.find(key);
+    if (it == m_pathList->paths.end())
+    {
+        key.str = m_pathList->arena.copy(m_path.str, pathLen);
+        it = m_pathList->paths.insert(std::make_pair(key, PATH_INFO())).first;
+    }
+    PATH_INFO& info = it->second;
+    info.count++;
+    if (publisher == &m_subscriptions->m_onObjectBegin)
+        info.types |= TYPE_OBJECT;
+    else if (publisher == &m_subscriptions->m_onArrayBegin)
+        info.types |= TYPE_ARRAY;
+    else if (!value)
+        info.types |= TYPE_NULL;
+    else if (value->isQuoted)
+        info.types |= TYPE_STRING;
+    else
+        info.types |= value->number ? TYPE_NUMBER : TYPE_BOOLEAN;
+}
+
+uint64_t JsonReader::getCurrentElementPathHash()
+{
+    return m_hashPaths ? m_currentPathHash : Publisher::hash(m_path.str, m_path.length);
+}
+
+// Methods for subscribing to events, which are added to the set of subscriptions in use.
+// -> Wide character string versions.
+void JsonReader::onObjectBegin(const wchar_t* element, std::function<void()> callback)
+{
+    m_subscriptions->onObjectBegin(element, callback);
+}
+void JsonReader::onObjectEnd(const wchar_t* element, std::function<void()> callback)
+{
+    m_subscriptions->onObjectEnd(element, callback);
+}
+void JsonReader::onArrayBegin(const wchar_t* element, std::function<void()> callback)
+{
+    m_subscriptions->onArrayBegin(element, callback);
+}
+void JsonReader::onArrayEnd(const wchar_t* element, std::function<void()> callback)
+{
+    m_subscriptions->onArrayEnd(element, callback);
+}
+void JsonReader::onArrayItem(const wchar_t* element, std::function<void(const char*)> callback)
+{
+    m_subscriptions->onArrayItem(element, callback);
+}
+void JsonReader::onArrayItem(const wchar_t* element, std::function<void(const wchar_t*)> callback)
+{
+    m_subscriptions->onArrayItem(element, callback);
+}
+void JsonReader::onPair(const wchar_t* element, std::function<void(const char*)> callback)
+{
+    m_subscriptions->onPair(element, callback);
+}
+void JsonReader::onPair(const wchar_t* element, std::function<void(const wchar_t*)> callback)
+{
+    m_subscriptions->onPair(element, callback);
+}
+// -> UTF-8 string versions.
+void JsonReader::onObjectBegin(const char* elementUtf8, std::function<void()> callback)
+{
+    m_subscriptions->onObjectBegin(elementUtf8, callback);
+}
+void JsonReader::onObjectEnd(const char* elementUtf8, std::function<void()> callback)
+{
+    m_subscriptions->onObjectEnd(elementUtf8, callback);
+}
+void JsonReader::onArrayBegin(const char* elementUtf8, std::function<void()> callback)
+{
+    m_subscriptions->onArrayBegin(elementUtf8, callback);
+}
+void JsonReader::onArrayEnd(const char* elementUtf8, std::function<void()> callback)
+{
+    m_subscriptions->onArrayEnd(elementUtf8, callback);
+}
+void JsonReader::onArrayItem(const char* elementUtf8, std::function<void(const char*)> callback)
+{
+    m_subscriptions->onArrayItem(elementUtf8, callback);
+}
+void JsonReader::onArrayItem(const char* elementUtf8, std::function<void(const wchar_t*)> callback)
+{
+    m_subscriptions->onArrayItem(elementUtf8, callback);
+}
+void JsonReader::onPair(const char* elementUtf8, std::function<void(const char*)> callback)
+{
+    m_subscriptions->onPair(elementUtf8, callback);
+}
+void JsonReader::onPair(const char* elementUtf8, std::function<void(const wchar_t*)> callback)
+{
+    m_subscriptions->onPair(elementUtf8, callback);
+}
+void JsonReader::onArrayItem(const wchar_t* element, std::function<void(const char*, size_t)> callback)
+{
+    m_subscriptions->onArrayItem(element, callback);
+}
+void JsonReader::onPair(const wchar_t* element, std::function<void(const char*, size_t)> callback)
+{
+    m_subscriptions->onPair(element, callback);
+}
+void JsonReader::onArrayItemInt64(const wchar_t* element, std::function<void(int64_t)> callback)
+{
+    m_subscriptions->onArrayItemInt64(element, callback);
+}
+void JsonReader::onArrayItemDouble(const wchar_t* element, std::function<void(double)> callback)
+{
+    m_subscriptions->onArrayItemDouble(element, callback);
+}
+void JsonReader::onPairInt64(const wchar_t* element, std::function<void(int64_t)> callback)
+{
+    m_subscriptions->onPairInt64(element, callback);
+}
+void JsonReader::onPairDouble(const wchar_t* element, std::function<void(double)> callback)
+{
+    m_subscriptions->onPairDouble(element, callback);
+}
+void JsonReader::onArrayItems(const wchar_t* element, std::function<void(const ITEM_VALUE*, size_t)> callback,
+                              size_t batchSize)
+{
+    m_subscriptions->onArrayItems(element, callback, batchSize);
+}
+void JsonReader::onArrayItemsInt64(const wchar_t* element, std::function<void(const int64_t*, size_t)> callback,
+                                   size_t batchSize)
+{
+    m_subscriptions->onArrayItemsInt64(element, callback, batchSize);
+}
+void JsonReader::onArrayItemsDouble(const wchar_t* element, std::function<void(const double*, size_t)> callback,
+                                    size_t batchSize)
+{
+    m_subscriptions->onArrayItemsDouble(element, callback, batchSize);
+}
+void JsonReader::onArrayItem(const char* elementUtf8, std::function<void(const char*, size_t)> callback)
+{
+    m_subscriptions->onArrayItem(elementUtf8, callback);
+}
+void JsonReader::onPair(const char* elementUtf8, std::function<void(const char*, size_t)> callback)
+{
+    m_subscriptions->onPair(elementUtf8, callback);
+}
+void JsonReader::onArrayItemInt64(const char* elementUtf8, std::function<void(int64_t)> callback)
+{
+    m_subscriptions->onArrayItemInt64(elementUtf8, callback);
+}
+void JsonReader::onArrayItemDouble(const char* elementUtf8, std::function<void(double)> callback)
+{
+    m_subscriptions->onArrayItemDouble(elementUtf8, callback);
+}
+void JsonReader::onPairInt64(const char* elementUtf8, std::function<void(int64_t)> callback)
+{
+    m_subscriptions->onPairInt64(elementUtf8, callback);
+}
+void JsonReader::onPairDouble(const char* elementUtf8, std::function<void(double)> callback)
+{
+    m_subscriptions->onPairDouble(elementUtf8, callback);
+}
+void JsonReader::onArrayItems(const char* elementUtf8, std::function<void(const ITEM_VALUE*, size_t)> callback,
+                              size_t batchSize)
+{
+    m_subscriptions->onArrayItems(elementUtf8, callback, batchSize);
+}
+void JsonReader::onArrayItemsInt64(const char* elementUtf8, std::function<void(const int64_t*, size_t)> callback,
+                                   size_t batchSize)
+{
+    m_subscriptions->onArrayItemsInt64(elementUtf8, callback, batchSize);
+}
+void JsonReader::onArrayItemsDouble(const char* elementUtf8, std::function<void(const double*, size_t)> callback,
+                                    size_t batchSize)
+{
+    m_subscriptions->onArrayItemsDouble(elementUtf8, callback, batchSize);
+}
+void JsonReader::useSubscriptions(Subscriptions* subscriptions)
+{
+    m_subscriptions = subscriptions ? subscriptions : &m_ownSubscriptions;
+}
+void JsonReader::onProgress(int step, std::function<void(int progress)> progressCallback)
+{
+    if (progressCallback == nullptr)
+        onProgressInfo(step, nullptr);
+    else
+        onProgressInfo(step, [progressCallback](const PROGRESS_INFO& info) { progressCallback(info.percentage); });
+}
+void JsonReader::onProgressInfo(int step, std::function<void(const PROGRESS_INFO& progress)> progressCallback)
+{
+    m_notifyProgress = ((step > 0 && step < 100) && progressCallback != nullptr);
+    if (m_notifyProgress)
+        m_input.setProgressParams(step, progressCallback);
+}
+
+#ifdef JSONREADER_STATS
+JsonReader::STATS JsonReader::getStats() const
+{
+    STATS stats = m_stats;
+    m_input.addStats(stats);
+    for (const STR* str : {&m_elemName, &m_elemValue, &m_path, &m_currentElemName})
+    {
+        stats.resizes += str->numResizes;
+        stats.copiedBytes += str->copiedBytes;
+        stats.convertedBytes += str->convertedBytes;
+    }
+    return stats;
+}
+
+void JsonReader::resetStats()
+{
+    m_stats = STATS();
+    m_input.resetStats();
+    for (STR* str : {&m_elemName, &m_elemValue, &m_path, &m_currentElemName})
+        str->numResizes = str->copiedBytes = str->convertedBytes = 0;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// class JsonReader::TextConverter
+
+JsonReader::TextConverter::TextConverter()
+{
+    m_lenMaxNarrow = 0;
+    m_bufferNarrow = nullptr;
+    m_lenMaxWide = 0;
+    m_bufferWide = nullptr;
+}
+
+void JsonReader::TextConverter::reserveNarrow(size_t length)
+{
+    if (length > m_lenMaxNarrow || !m_bufferNarrow)
+    {
+        if (m_bufferNarrow)
+            delete[] m_bufferNarrow;
+        m_lenMaxNarrow = length;
+        m_bufferNarrow = new char[m_lenMaxNarrow + 1];
+        m_bufferNarrow[0] = 0;
+    }
+}
+
+void JsonReader::TextConverter::reserveWide(size_t length)
+{
+    if (length > m_lenMaxWide || !m_bufferWide)
+    {
+        if (m_bufferWide)
+            delete[] m_bufferWide;
+        m_lenMaxWide = length;
+        m_bufferWide = new wchar_t[m_lenMaxWide + 1];
+        m_bufferWide[0] = 0;
+    }
+}
+
+JsonReader::TextConverter::~TextConverter()
+{
+    if (m_bufferNarrow)
+        delete[] m_bufferNarrow;
+    if (m_bufferWide)
+        delete[] m_bufferWide;
+}
+
+const char* JsonReader::TextConverter::WideToUtf8(const wchar_t* bufferWide, const size_t lenWide, size_t* lenOut)
+{
+    if (!bufferWide)
+        return nullptr;
+
+    reserveNarrow(lenWide * MAX_UTF8_PER_WIDE);
+    size_t length = wideToUtf8(bufferWide, lenWide, m_bufferNarrow);
+    m_bufferNarrow[length] = 0;
+    if (lenOut)
+        (*lenOut) = length;
+    return m_bufferNarrow;
+}
+
+const wchar_t* JsonReader::TextConverter::Utf8ToWide(const char* bufferUtf8, const size_t lenUtf8, size_t* lenOut)
+{
+    if (!bufferUtf8)
+        return nullptr;
+
+    reserveWide(lenUtf8); // Each byte produces at most one wide character.
+    size_t length = utf8ToWide(bufferUtf8, lenUtf8, m_bufferWide);
+    m_bufferWide[length] = 0;
+    if (lenOut)
+        (*lenOut) = length;
+    return m_bufferWide;
+}
+
+void JsonReader::TextConverter::Utf8ToWide(const std::string stringUtf8, std::wstring& stringWide)
+{
+    stringWide.resize(stringUtf8.length());
+    stringWide.resize(utf8ToWide(stringUtf8.data(), stringUtf8.length(), &stringWide[0]));
+}
+
+const char* JsonReader::TextConverter::MultiByteToUtf8(const char* bufferMB, const size_t lenMB, size_t* lenOut)
+{
+    if (!bufferMB)
+        return nullptr;
+
+    if (lenMB == 0)
+    {
+        reserveNarrow(0);
+        return m_bufferNarrow;
+    }
+
+    size_t length = 0;
+    mbstate_t state = {};
+#ifdef USE_WINAPI
+    mbsrtowcs_s(&length, nullptr, 0, &bufferMB, lenMB, &state);
+#else
+    length = std::mbsrtowcs(nullptr, &bufferMB, lenMB, &state);
+#endif
+
+    if (length == 0 || length == static_cast<size_t>(-1))
+        return nullptr;
+
+    reserveWide(length);
+
+    state = {};
+#ifdef USE_WINAPI
+    mbsrtowcs_s(&length, m_bufferWide, length, &bufferMB, lenMB, &state);
+    length--; // do not include the null terminator.
+#else
+    const char* src = &(bufferMB[0]);
+    std::mbsrtowcs(m_bufferWide, (const char**)&src, lenMB, &state);
+#endif
+    m_bufferWide[length] = 0;
+    return WideToUtf8(m_bufferWide, length, lenOut);
+}
+
+const char* JsonReader::TextConverter::Utf8ToMultiByte(const char* bufferUtf8, const size_t lenUtf8, size_t* lenOut)
+{
+    if (!bufferUtf8)
+        return nullptr;
+
+    if (lenUtf8 == 0)
+    {
+        reserveNarrow(0);
+        return m_bufferNarrow;
+    }
+
+    size_t length = 0;
+    size_t lenWide = 0;
+
+    const wchar_t* bufferWide = Utf8ToWide(bufferUtf8, lenUtf8, &lenWide);
+
+#ifdef USE_WINAPI
+    wcstombs_s(&length, nullptr, 0, bufferWide, 0);
+#else
+    mbstate_t state = {};
+    length = std::wcsrtombs(nullptr, (const wchar_t**)&bufferWide, lenWide, &state);
+#endif
+
+    if (length == 0 || length == static_cast<size_t>(-1))
+        return nullptr;
+
+    reserveNarrow(length);
+
+#ifdef USE_WINAPI
+    wcstombs_s(&length, m_bufferNarrow, m_lenMaxNarrow, bufferWide, length);
+    length--; // do not include the null terminator.
+#else
+    state = {};
+    std::wcsrtombs(m_bufferNarrow, (const wchar_t**)&bufferWide, length, &state);
+#endif
+    m_bufferNarrow[length] = 0;
+    if (lenOut)
+        (*lenOut) = length - 1;
+    return m_bufferNarrow;
+}
+
+void JsonReader::TextConverter::Utf8ToMultiByte(const std::string stringUtf8, std::string& stringMB)
+{
+    const char* bufferMB = Utf8ToMultiByte(stringUtf8.c_str(), (int)stringUtf8.length());
+    if (bufferMB)
+        stringMB = bufferMB;
+    else
+        stringMB.clear();
+}
+
+const char* JsonReader::TextConverter::CodePointToUtf8(const uint32_t codePoint, size_t& lenOut)
+{
+    reserveNarrow(4);
+    lenOut = encodeUtf8((isSurrogate(codePoint) || codePoint > 0x10FFFF) ? REPLACEMENT_CHARACTER : codePoint,
+                        m_bufferNarrow);
+    m_bufferNarrow[lenOut] = 0;
+    return m_bufferNarrow;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// struct JsonReader::STR
+
+JsonReader::STR::STR()
+{
+    capacity = CAPACITY_INLINE;
+    str = inlineStr;
+    view = nullptr;
+    number = nullptr;
+    length = 0;
+    str[0] = 0;
+    isAscii = true;
+    isQuoted = false;
+    useLocale = false;
+    narrow = nullptr;
+    wide = nullptr;
+    invalidate();
+#ifdef JSONREADER_STATS
+    numResizes = copiedBytes = convertedBytes = 0;
+#endif
+}
+
+JsonReader::STR::STR(const wchar_t* source, bool useLocale) : STR()
+{
+    const char* utf8 = converter.WideToUtf8(source, wcslen(source));
+    if (utf8)
+        copy(utf8, (int)strlen(utf8), true);
+    this->useLocale = useLocale;
+}
+
+void JsonReader::STR::copy(const char* source, size_t sourceLen, bool checkCapacity, bool checkEncoding)
+{
+    view = nullptr;
+    number = nullptr;
+    if (checkCapacity)
+        resize(sourceLen + 1);
+    if (sourceLen > 0)
+        memcpy((void*)str, source, sourceLen);
+    COUNT_STAT(copiedBytes, sourceLen);
+    setLength(sourceLen);
+    isAscii = true;
+    if (checkEncoding)
+        for (size_t i = 0; i < sourceLen; i++)
+            if (static_cast<unsigned char>(source[i]) > 0x7F)
+            {
+                isAscii = false;
+            }
+    isQuoted = false;
+}
+
+void JsonReader::STR::clear()
+{
+    view = nullptr;
+    number = nullptr;
+    invalidate();
+    if (length > 0)
+        setLength(0);
+    isAscii = true;
+    isQuoted = false;
+}
+
+void JsonReader::STR::resize(size_t newCapacity)
+{
+    if (newCapacity > capacity)
+    {
+        COUNT_STAT(numResizes, 1);
+        capacity = newCapacity;
+        char* newString = new char[capacity];
+        if (str != nullptr)
+        {
+            memcpy(newString, str, length);
+            newString[length] = 0;
+            if (str != inlineStr)
+                delete[] str;
+        }
+        str = newString;
+    }
+}
+
+void JsonReader::STR::setLength(size_t newLength)
+{
+    invalidate();
+    if (newLength < capacity && str)
+    {
+        length = newLength;
+        str[length] = 0;
+    }
+}
+
+void JsonReader::STR::release()
+{
+    if (str != nullptr && str != inlineStr)
+        delete[] str;
+    str = nullptr;
+}
+
+const char* JsonReader::STR::convertToNarrow()
+{
+    narrow = converter.Utf8ToMultiByte(toUtf8(), length);
+    hasNarrow = true;
+    COUNT_STAT(convertedBytes, length);
+    return narrow;
+}
+
+const wchar_t* JsonReader::STR::convertToWide()
+{
+    // The string is converted from the input data, without detaching it. ASCII characters have the same value in
+    // UTF-8 and in wide strings, so they are just widened.
+    wideStr.resize(length);
+    if (!isAscii || scan.widenAscii(data(), length, &wideStr[0]) < length)
+        wideStr.resize(utf8ToWide(data(), length, &wideStr[0]));
+    wide = wideStr.c_str();
+    hasWide = true;
+    COUNT_STAT(convertedBytes, length);
+    return wide;
+}
+
+void JsonReader::STR::detach()
+{
+    const char* source = view;
+    size_t sourceLen = length;
+    view = nullptr;
+    length = 0; // The previous content is not preserved when resizing.
+    if (sourceLen >= capacity)
+        resize(sourceLen + 1);
+    memcpy(str, source, sourceLen);
+    COUNT_STAT(copiedBytes, sourceLen);
+    length = sourceLen; // The content is the same, so the converted strings are kept.
+    str[length] = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// struct JsonReader::NUMBER
+
+static inline bool isDigit(const char* ptr, const char* end) { return ptr < end && *ptr >= '0' && *ptr <= '9'; }
+
+size_t JsonReader::NUMBER::parse(const char* text, size_t len)
+{
+    // JSON grammar: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+    const char* ptr = text;
+    const char* end = text + len;
+    clear();
+
+    if (ptr < end && *ptr == '-')
+    {
+        isNegative = true;
+        ptr++;
+    }
+    if (ptr < end && *ptr == '0')
+        ptr++;
+    else if (isDigit(ptr, end))
+    {
+        do
+            addDigit(*ptr++, false);
+        while (isDigit(ptr, end));
+    }
+    else
+        isValid = false;
+
+    if (ptr < end && *ptr == '.')
+    {
+        isInteger = false;
+        if (!isDigit(++ptr, end))
+            isValid = false;
+        while (isDigit(ptr, end))
+            addDigit(*ptr++, true);
+    }
+
+    if (ptr < end && (*ptr == 'e' || *ptr == 'E'))
+    {
+        isInteger = false;
+        bool isNegativeExponent = false;
+        if (++ptr < end && (*ptr == '+' || *ptr == '-'))
+            isNegativeExponent = (*ptr++ == '-');
+        if (!isDigit(ptr, end))
+            isValid = false;
+        int value = 0;
+        while (isDigit(ptr, end))
+        {
+            if (value < 100000) // Larger exponents are out of range anyway.
+                value = value * 10 + (*ptr - '0');
+            ptr++;
+        }
+        exponent += isNegativeExponent ? -value : value;
+    }
+
+    // Other characters that may be part of a number are read too, although the number is then invalid.
+    while (ptr < end && ((*ptr >= '0' && *ptr <= '9') || *ptr == '.' || *ptr == '+' || *ptr == '-' || *ptr == 'e' ||
+                         *ptr == 'E'))
+    {
+        isValid = false;
+        ptr++;
+    }
+    return (size_t)(ptr - text);
+}
+
+void JsonReader::NUMBER::addDigit(char digit, bool isFraction)
+{
+    if (numDigits < MAX_DIGITS)
+    {
+        if (mantissa > 0 || digit != '0') // Leading zeros of the fractional part are not significant.
+        {
+            mantissa = mantissa * 10 + (digit - '0');
+            numDigits++;
+        }
+        if (isFraction)
+            exponent--;
+    }
+    else
+    {
+        // The digit is discarded.
+        isTruncated = true;
+        if (!isFraction)
+            exponent++;
+    }
+}
+
+bool JsonReader::NUMBER::toInt64(int64_t& result) const
+{
+    const uint64_t maxValue = 9223372036854775807ull;
+    if (isTruncated || mantissa > maxValue + (isNegative ? 1 : 0))
+        return false;
+    result = isNegative ? (int64_t)(0 - mantissa) : (int64_t)mantissa;
+    return true;
+}
+
+#ifdef USE_STRTOD_L
+// Converts the null terminated 'str' with the C locale, which is created the first time and kept until the end.
+static double strtodClassic(const char* str)
+{
+#ifdef USE_WINAPI
+    static _locale_t locale = _create_locale(LC_NUMERIC, "C");
+    return _strtod_l(str, nullptr, locale);
+#else
+    static locale_t locale = newlocale(LC_NUMERIC_MASK, "C", (locale_t)0);
+    return strtod_l(str, nullptr, locale);
+#endif
+}
+#endif
+
+bool JsonReader::NUMBER::toDouble(const char* text, size_t len, double& result) const
+{
+    if (mantissa == 0 && !isTruncated)
+    {
+        result = isNegative ? -0.0 : 0.0;
+        return true;
+    }
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    // The conversion is exact if both the mantissa and the power of 10 are exactly representable as doubles, as
+    // their product or quotient is then correctly rounded (Clinger's fast path).
+    static const double powersOf10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    if (!isTruncated && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+    {
+        double value = (double)mantissa;
+        value = exponent < 0 ? value / powersOf10[-exponent] : value * powersOf10[exponent];
+        result = isNegative ? -value : value;
+        return true;
+    }
+#endif
+
+#ifdef USE_FROM_CHARS
+    std::from_chars_result conversion = std::from_chars(text, text + len, result);
+    if (conversion.ec == std::errc::result_out_of_range && exponent + numDigits <= 0)
+    {
+        result = isNegative ? -0.0 : 0.0; // Values too small to be represented are rounded to zero.
+        return true;
+    }
+    return conversion.ec == std::errc();
+#elif defined(USE_STRTOD_L)
+    // The number is copied to be null terminated. It has been validated, so strtod only finds the JSON grammar.
+    char buffer[64];
+    std::string copy;
+    const char* str = buffer;
+    if (len < sizeof(buffer))
+    {
+        memcpy(buffer, text, len);
+        buffer[len] = 0;
+    }
+    else
+    {
+        copy.assign(text, len);
+        str = copy.c_str();
+    }
+    errno = 0;
+    result = strtodClassic(str);
+    // Values too small to be represented are rounded to zero or to a subnormal, which is also reported as ERANGE.
+    return errno != ERANGE || std::fabs(result) != HUGE_VAL;
+#else
+    // The classic locale makes the conversion independent of the decimal separator set by the client's locale.
+    std::istringstream stream(std::string(text, len));
+    stream.imbue(std::locale::classic());
+    stream >> result;
+    return !stream.fail();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// class JsonReader::JsonSource
+
+JsonReader::JsonInput::JsonInput()
+{
+    m_isMapped = false;
+    m_fileBufferLen = FILE_BUFFER_LEN;
+    m_numFileBuffers = 1;
+    m_useMapping = false;
+    m_source = nullptr;
+#ifdef JSONREADER_STATS
+    resetStats();
+#endif
+    clear();
+}
+
+#ifdef JSONREADER_STATS
+void JsonReader::JsonInput::addStats(STATS& stats) const
+{
+    stats.separatorBytes += m_separatorBytes;
+    stats.copiedBytes += m_copiedBytes;
+}
+
+void JsonReader::JsonInput::resetStats() { m_separatorBytes = m_copiedBytes = 0; }
+#endif
+
+JsonReader::JsonInput::~JsonInput() { clear(); }
+
+void JsonReader::JsonInput::init(const char* source, size_t sourceLen, bool isFile)
+{
+    if (m_progressCallback)
+        m_progressStart = std::chrono::steady_clock::now();
+    if (m_source)
+    {
+        m_maxLen = m_source->getSize();
+        readFirstBlock();
+        return;
+    }
+    if (m_stream)
+    {
+        // The text received and not parsed yet, which begins after the last member completed.
+        m_buffer = const_cast<char*>(m_stream->buffer);
+        m_bufferLen = m_stream->len;
+        m_bufferPosition = m_stream->position;
+        m_idx = (size_t)-1;
+        m_isEOF = false;
+        return;
+    }
+    if (isFile)
+    {
+        if (!openFile(source))
+        {
+            throwError(ERROR_CANNOT_OPEN_FILE);
+        }
+    }
+    else
+    {
+        if (!setBuffer(source, sourceLen))
+        {
+            throwError(ERROR_CANNOT_SET_BUFFER);
+        }
+    }
+}
+
+void JsonReader::JsonInput::clear()
+{
+    if (isReadingAhead())
+        stopReadAhead(); // The buffers belong to the ring, which is kept.
+    else if ((isFileOpen() || m_source) && m_buffer)
+        delete[] m_buffer;
+    m_ownedSource.reset();
+    m_source = nullptr;
+    m_sourceConsumed = 0;
+    if (isFileOpen())
+        m_file->close();
+    if (m_isMapped)
+        unmapFile();
+
+    m_idx = (size_t)-1;
+    m_bufferLen = 0;
+    m_maxLen = 0;
+    m_buffer = nullptr;
+    m_isEOF = false;
+    m_stream = nullptr;
+    m_bufferPosition = 0;
+    m_progressStep = 0;
+    m_progressNext = 0;
+}
+
+bool JsonReader::JsonInput::openFile(const char* fileFullPath)
+{
+    if (!m_file)
+        m_file.reset(new std::ifstream());
+    m_file->open(fileFullPath, std::ifstream::in | std::ios::binary);
+    if (!m_file->is_open())
+        return false;
+
+    // Get the file size.
+    m_file->seekg(0, std::ifstream::end);
+    m_maxLen = m_file->tellg();
+    m_file->seekg(0, std::ifstream::beg);
+
+    // Compressed files cannot be mapped, since they are decompressed as they are read.
+    if (!openCompressedFile() && m_useMapping)
+    {
+        m_file->close();
+        return mapFile(fileFullPath);
+    }
+    readFirstBlock();
+    return true;
+}
+
+bool JsonReader::JsonInput::openCompressedFile()
+{
+    unsigned char magic[4] = {0, 0, 0, 0};
+    m_file->read(reinterpret_cast<char*>(magic), sizeof(magic));
+    size_t len = (size_t)m_file->gcount();
+    m_file->clear(); // A file shorter than the magic number sets the end-of-file flag.
+    m_file->seekg(0, std::ifstream::beg);
+
+    if (len >= 2 && magic[0] == 0x1F && magic[1] == 0x8B)
+    {
+#ifdef JSONREADER_ZLIB
+        m_ownedSource.reset(new GzipSource(*m_file, m_maxLen));
+#else
+        throwError(ERROR_UNSUPPORTED_COMPRESSION, "gzip");
+#endif
+    }
+    else if (len == 4 && magic[0] == 0x28 && magic[1] == 0xB5 && magic[2] == 0x2F && magic[3] == 0xFD)
+    {
+#ifdef JSONREADER_ZSTD
+        m_ownedSource.reset(new ZstdSource(*m_file, m_maxLen));
+#else
+        throwError(ERROR_UNSUPPORTED_COMPRESSION, "Zstandard");
+#endif
+    }
+    else
+        return false;
+    m_source = m_ownedSource.get();
+    return true;
+}
+
+void JsonReader::JsonInput::readFirstBlock()
+{
+    m_isEOF = false;
+    if (m_numFileBuffers > 1)
+        startReadAhead();
+    else
+        m_buffer = new char[m_fileBufferLen];
+    fillBuffer();
+    m_idx = (size_t)-1;
+}
+
+size_t JsonReader::JsonInput::readBlock(char* buffer, size_t& consumed)
+{
+    if (m_source)
+    {
+        size_t len = m_source->read(buffer, m_fileBufferLen);
+        consumed = m_source->getConsumed();
+        return len;
+    }
+    m_file->read(buffer, m_fileBufferLen);
+    return (size_t)m_file->gcount();
+}
+
+bool JsonReader::JsonInput::mapFile(const char* fileFullPath)
+{
+    // Empty files cannot be mapped, so they are handled as empty buffers.
+    static const char* emptyBuffer = "";
+    size_t fileSize = 0;
+    void* view = nullptr;
+
+#ifdef USE_WINAPI
+    HANDLE file = CreateFileA(fileFullPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+    fileSize = (size_t)size.QuadPart;
+    if (fileSize > 0)
+    {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping)
+            view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view)
+        {
+            if (mapping)
+                CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+        m_fileHandle = file;
+        m_mappingHandle = mapping;
+    }
+    else
+        CloseHandle(file);
+#else
+    int fd = open(fileFullPath, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    fileSize = (size_t)fileStat.st_size;
+    if (fileSize > 0)
+    {
+        view = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED)
+        {
+            close(fd);
+            return false;
+        }
+        // The file is parsed from beginning to end, so aggressive read-ahead pays off.
+        madvise(view, fileSize, MADV_SEQUENTIAL);
+    }
+    close(fd); // The mapping remains valid after closing the descriptor.
+#endif
+
+    if (fileSize > 0)
+    {
+        m_buffer = static_cast<char*>(view);
+        m_isMapped = true;
+    }
+    else
+        m_buffer = const_cast<char*>(emptyBuffer);
+    m_bufferLen = fileSize;
+    m_maxLen = fileSize;
+    m_idx = (size_t)-1;
+    return true;
+}
+
+void JsonReader::JsonInput::unmapFile()
+{
+#ifdef USE_WINAPI
+    UnmapViewOfFile(m_buffer);
+    CloseHandle(m_mappingHandle);
+    CloseHandle(m_fileHandle);
+    m_mappingHandle = m_fileHandle = nullptr;
+#else
+    munmap(m_buffer, m_maxLen);
+#endif
+    m_isMapped = false;
+}
+
+bool JsonReader::JsonInput::setBuffer(const char* buffer, size_t bufferLen)
+{
+    if (!buffer)
+        return false;
+    m_bufferLen = bufferLen; // All bounds checks rely on the length, so no null terminator is needed.
+    m_maxLen = m_bufferLen;
+    // Constness must be removed due to the assignment, but the content will not be modified.
+    m_buffer = const_cast<char*>(buffer);
+    m_idx = (size_t)-1;
+    return true;
+}
+
+void JsonReader::JsonInput::fillBuffer(bool isInString)
+{
+    m_bufferPosition += m_bufferLen; // The previous buffer has been consumed.
+    m_idx = 0;
+    m_bufferLen = 0;
+
+    if (m_isEOF == true)
+        throwError(ERROR_UNEXPECTED_END);
+
+    if (isFileOpen() || m_source) // The buffer is only refilled if the input is a file, a Source or a stream.
+    {
+        if (isReadingAhead())
+        {
+            // The consumed buffer is given back to the reading thread, and the next one is waited for.
+            READ_AHEAD& ring = *m_readAhead;
+            std::unique_lock<std::mutex> lock(ring.mutex);
+            if (ring.isHeld)
+            {
+                ring.first = (ring.first + 1) % ring.buffers.size();
+                ring.numFilled--;
+                ring.changed.notify_all();
+            }
+            ring.changed.wait(lock, [&ring]() { return ring.numFilled > 0 || ring.isFinished; });
+            ring.isHeld = ring.numFilled > 0;
+            if (ring.isHeld)
+            {
+                m_buffer = ring.buffers[ring.first].get();
+                m_bufferLen = ring.lengths[ring.first];
+                m_sourceConsumed = ring.consumed[ring.first];
+            }
+            else if (ring.error)
+                std::rethrow_exception(ring.error);
+        }
+        else
+            m_bufferLen = readBlock(m_buffer, m_sourceConsumed);
+    }
+    else if (m_stream && !m_stream->isFinished)
+    {
+        // The parsing is suspended until the next fragment is received.
+        FRAGMENT_END end = {isInString};
+        throw end;
+    }
+}
+
+bool JsonReader::JsonInput::findFirstChar()
+{
+    bool isValid = false;
+    char ch = 0;
+    while (!isValid)
+    {
+        ch = getNextChar();
+        if (m_isEOF)
+            return false;
+        isValid = (ch == '{' || ch == '[' || ch == '\"' || ch == 't' || ch == 'f' || ch == 'n' || ch == '-' ||
+                   (ch >= '0' && ch <= '9'));
+    }
+    return true;
+}
+
+char JsonReader::JsonInput::getNextChar(bool verbatim)
+{
+    // Buffers and mapped files are contiguous, so this branch is only taken at their end.
+    if (++m_idx >= m_bufferLen)
+    {
+        fillBuffer();
+        if (m_bufferLen == 0)
+        {
+            m_isEOF = true;
+            return 0;
+        }
+    }
+    if (verbatim || !isSeparator(m_buffer[m_idx]))
+        return m_buffer[m_idx];
+    // Single separators, such as the colons and commas of minified data, are skipped directly.
+    if (m_idx + 1 < m_bufferLen && !isSeparator(m_buffer[m_idx + 1]))
+    {
+        COUNT_STAT(m_separatorBytes, 1);
+        return m_buffer[++m_idx];
+    }
+
+    // Skip the whole run of separators (e.g. indentation) in blocks.
+    while (true)
+    {
+        size_t numSeparators = scan.skipSeparators(m_buffer + m_idx, m_bufferLen - m_idx);
+        COUNT_STAT(m_separatorBytes, numSeparators);
+        m_idx += numSeparators;
+        if (m_idx < m_bufferLen)
+            return m_buffer[m_idx];
+        fillBuffer();
+        if (m_bufferLen == 0)
+        {
+            m_isEOF = true;
+            return 0;
+        }
+    }
+}
+
+char JsonReader::JsonInput::charToHex(char input)
+{
+    if (input >= '0' && input <= '9')
+        return (input - '0');
+    else if (input >= 'a' && input <= 'f')
+        return (input - 'a' + 10);
+    else if (input >= 'A' && input <= 'F')
+        return (input - 'A' + 10);
+    throwError(ERROR_INVALID_HEX_DIGIT, input);
+}
+
+void JsonReader::JsonInput::setFileBuffers(size_t bufferLen, unsigned numBuffers)
+{
+    bufferLen = bufferLen > 0 ? bufferLen : FILE_BUFFER_LEN;
+    numBuffers = std::max(numBuffers, 1u);
+    if (bufferLen != m_fileBufferLen || numBuffers != m_numFileBuffers)
+        m_readAhead.reset(); // The ring is created again with the new buffers.
+    m_fileBufferLen = bufferLen;
+    m_numFileBuffers = numBuffers;
+}
+
+void JsonReader::JsonInput::startReadAhead()
+{
+    if (!m_readAhead)
+    {
+        m_readAhead.reset(new READ_AHEAD());
+        for (unsigned i = 0; i < m_numFileBuffers; i++)
+            m_readAhead->buffers.emplace_back(new char[m_fileBufferLen]);
+        m_readAhead->lengths.resize(m_numFileBuffers);
+        m_readAhead->consumed.resize(m_numFileBuffers);
+    }
+    READ_AHEAD* ring = m_readAhead.get();
+    ring->error = nullptr;
+    ring->first = 0;
+    ring->numFilled = 0;
+    ring->isHeld = false;
+    ring->isFinished = false;
+    ring->isStopped = false;
+
+    ring->reader = std::thread(
+        [this, ring]()
+        {
+            size_t numBuffers = ring->buffers.size();
+            size_t next = 0; // Index of the next buffer to fill, which is not in use while there are free buffers.
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(ring->mutex);
+                    ring->changed.wait(lock, [ring, numBuffers]()
+                                       { return ring->numFilled < numBuffers || ring->isStopped; });
+                    if (ring->isStopped)
+                        return;
+                }
+                // The parser goes on meanwhile. Errors are passed to the parser, which gets them after the data read
+                // before.
+                size_t len = 0, consumed = 0;
+                std::exception_ptr error;
+                try
+                {
+                    len = readBlock(ring->buffers[next].get(), consumed);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> lock(ring->mutex);
+                if (len == 0)
+                {
+                    ring->error = error;
+                    ring->isFinished = true;
+                }
+                else
+                {
+                    ring->lengths[next] = len;
+                    ring->consumed[next] = consumed;
+                    ring->numFilled++;
+                    next = (next + 1) % numBuffers;
+                }
+                ring->changed.notify_all();
+                if (ring->isFinished)
+                    return;
+            }
+        });
+}
+
+void JsonReader::JsonInput::stopReadAhead()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_readAhead->mutex);
+        m_readAhead->isStopped = true;
+        m_readAhead->changed.notify_all();
+    }
+    m_readAhead->reader.join();
+}
+
+bool JsonReader::JsonInput::isReadingAhead() { return m_readAhead && m_readAhead->reader.joinable(); }
+
+void JsonReader::JsonInput::goToNextChar(bool isInString)
+{
+    if (++m_idx >= m_bufferLen)
+    {
+        fillBuffer(isInString);
+        if (m_bufferLen == 0)
+        {
+            m_isEOF = true; // The position of the error is the end of the input.
+            throwError(ERROR_UNEXPECTED_END);
+        }
+    }
+}
+
+char JsonReader::JsonInput::readStringChars(STR& text)
+{
+    while (true)
+    {
+        goToNextChar(true);
+        size_t len = scan.findStringDelimiter(m_buffer + m_idx, m_bufferLen - m_idx, text.isAscii);
+        if (len > 0)
+        {
+            if (text.length + len >= text.capacity)
+                text.resize((size_t)((text.length + len + 1) * RESIZE_FACTOR));
+            memcpy(text.str + text.length, m_buffer + m_idx, len);
+            COUNT_STAT(m_copiedBytes, len);
+            text.length += len;
+            m_idx += len;
+        }
+        if (m_idx < m_bufferLen)
+            return m_buffer[m_idx];
+        m_idx--; // The string continues in the next block of data.
+    }
+}
+
+char JsonReader::JsonInput::readStringView(STR& text)
+{
+    size_t start = m_idx + 1;
+    size_t len = 0;
+    if (start < m_bufferLen)
+        len = scan.findStringDelimiter(m_buffer + start, m_bufferLen - start, text.isAscii);
+    if (start + len >= m_bufferLen)
+        return readStringChars(text); // Unterminated string.
+
+    m_idx = start + len;
+    if (m_buffer[m_idx] == '\"')
+    {
+        text.view = m_buffer + start;
+        text.length = len;
+    }
+    else // An escape sequence is found, so the string must be copied.
+    {
+        if (len >= text.capacity)
+            text.resize((size_t)((len + 1) * RESIZE_FACTOR));
+        memcpy(text.str, m_buffer + start, len);
+        COUNT_STAT(m_copiedBytes, len);
+        text.length = len;
+    }
+    return m_buffer[m_idx];
+}
+
+void JsonReader::JsonInput::readEscapeSequence(STR& text)
+{
+    if (text.length + 1 >= text.capacity)
+        text.resize((size_t)((text.length + 1) * RESIZE_FACTOR));
+    switch (getNextChar(true))
+    {
+    case '\"':
+        text.str[text.length++] = '\"';
+        break;
+    case '\\':
+        text.str[text.length++] = '\\';
+        break;
+    case '/':
+        text.str[text.length++] = '/';
+        break;
+    case 'b':
+        text.str[text.length++] = '\b';
+        break;
+    case 'f':
+        text.str[text.length++] = '\f';
+        break;
+    case 'n':
+        text.str[text.length++] = '\n';
+        break;
+    case 'r':
+        text.str[text.length++] = '\r';
+        break;
+    case 't':
+        text.str[text.length++] = '\t';
+        break;
+    case 'u':
+        getEscapedCodePoint(text);
+        break;
+    default:
+        throwError(ERROR_INVALID_ESCAPE_SEQUENCE, m_buffer[m_idx]);
+    }
+}
+
+void JsonReader::JsonInput::getEscapedCodePoint(STR& text)
+{
+    // Code points above U+FFFF are escaped as a high surrogate followed by a low one, e.g. "\uD83D\uDE00".
+    // Unpaired surrogates are replaced by U+FFFD.
+    uint32_t codePoint = readCodeUnit();
+    while (codePoint >= 0xD800 && codePoint <= 0xDBFF)
+    {
+        char ch = getNextChar(true);
+        if (m_isEOF)
+            throwError(ERROR_UNEXPECTED_END);
+        if (ch != '\\')
+        {
+            goToPreviousChar(); // The character is read again as part of the string.
+            break;
+        }
+        if (getNextChar(true) != 'u')
+        {
+            appendCodePoint(text, REPLACEMENT_CHARACTER);
+            goToPreviousChar();
+            readEscapeSequence(text); // The escape sequence that follows is read normally.
+            return;
+        }
+        uint32_t lowSurrogate = readCodeUnit();
+        if (lowSurrogate >= 0xDC00 && lowSurrogate <= 0xDFFF)
+        {
+            appendCodePoint(text, 0x10000 + ((codePoint - 0xD800) << 10) + (lowSurrogate - 0xDC00));
+            return;
+        }
+        appendCodePoint(text, REPLACEMENT_CHARACTER);
+        codePoint = lowSurrogate; // It may be the high surrogate of the next pair.
+    }
+    appendCodePoint(text, isSurrogate(codePoint) ? REPLACEMENT_CHARACTER : codePoint);
+}
+
+uint32_t JsonReader::JsonInput::readCodeUnit()
+{
+    uint32_t codeUnit = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        char ch = getNextChar(true);
+        if (m_isEOF)
+            throwError(ERROR_UNEXPECTED_END);
+        codeUnit = (codeUnit << 4) | charToHex(ch);
+    }
+    return codeUnit;
+}
+
+void JsonReader::JsonInput::appendCodePoint(STR& text, uint32_t codePoint)
+{
+    if (text.length + 4 >= text.capacity)
+        text.resize((size_t)((text.length + 4) * RESIZE_FACTOR) + 1);
+    text.length += encodeUtf8(codePoint, text.str + text.length);
+    if (codePoint > 0x7F)
+        text.isAscii = false;
+}
+
+void JsonReader::JsonInput::goToPreviousChar() { m_idx--; }
+
+void JsonReader::JsonInput::goToNextQuote()
+{
+    while (m_buffer[m_idx] != '\"')
+        goToNextChar(true); // Throws at the end of the input, e.g. on '[{"b":[1]]}'.
+}
+
+void JsonReader::JsonInput::skipValue()
+{
+    char ch = m_buffer[m_idx];
+    if (ch == '\"')
+        skipString();
+    else if (ch == '{' || ch == '[')
+    {
+        size_t depth = 1;
+        while (depth > 0)
+        {
+            goToNextChar();
+            m_idx += scan.findStructural(m_buffer + m_idx, m_bufferLen - m_idx);
+            if (m_idx >= m_bufferLen)
+            {
+                m_idx--; // The value continues in the next block of data.
+                continue;
+            }
+            ch = m_buffer[m_idx];
+            if (ch == '\"')
+                skipString();
+            else if (ch == '{' || ch == '[')
+                depth++;
+            else
+                depth--;
+        }
+    }
+    else // Number, boolean or null.
+    {
+        do
+            ch = getNextChar(true);
+        while (!m_isEOF && !isSeparator(ch) && ch != '}' && ch != ']');
+        if (!m_isEOF)
+            goToPreviousChar();
+    }
+}
+
+void JsonReader::JsonInput::skipString()
+{
+    bool isAscii = true;
+    while (true)
+    {
+        goToNextChar(true);
+        m_idx += scan.findStringDelimiter(m_buffer + m_idx, m_bufferLen - m_idx, isAscii);
+        if (m_idx >= m_bufferLen)
+        {
+            m_idx--; // The string continues in the next block of data.
+            continue;
+        }
+        if (m_buffer[m_idx] == '\"')
+            return;
+        goToNextChar(true); // Skip the escaped character.
+    }
 }
 
-void JsonReader::TextConverter::Utf8ToWide(const std::string stringUtf8, std::wstring& stringWide)
+void JsonReader::JsonInput::setProgressParams(int step, std::function<void(const PROGRESS_INFO&)> progressCallback)
 {
-#ifdef USE_WINAPI
-    const wchar_t* bufferWide = nullptr;
-    bufferWide = Utf8ToWide(stringUtf8.c_str(), stringUtf8.length());
-    if (bufferWide)
-        stringWide = bufferWide;
-    else
-        stringWide.clear();
-#else
-    stringWide = m_codecvt.from_bytes(stringUtf8);
-#endif
+    m_progressStep = step;
+    m_progressNext = 0;
+    m_progressCallback = progressCallback;
 }
 
-const char* JsonReader::TextConverter::MultiByteToUtf8(const char* bufferMB, const size_t lenMB, size_t* lenOut)
+double JsonReader::JsonInput::getProgress()
 {
-    if (!bufferMB)
-        return nullptr;
+    return (m_maxLen > 0) ? ((double)getProgressPosition() / (double)m_maxLen) * 100.0 : 0;
+}
 
-    if (lenMB == 0)
+void JsonReader::JsonInput::notifyProgress()
+{
+    size_t position = getProgressPosition();
+    if ((position >= m_progressNext) && m_maxLen > 0)
     {
-        m_bufferNarrow[0] = 0;
-        return m_bufferNarrow;
+        // The throughput is not known at the first notification, made after the first value.
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_progressStart;
+        PROGRESS_INFO info = {position, m_maxLen, (int)getProgress(), 0, -1};
+        if (m_progressNext > 0 && elapsed.count() > 0)
+        {
+            info.bytesPerSecond = position / elapsed.count();
+            info.secondsLeft = (m_maxLen - std::min(position, m_maxLen)) / info.bytesPerSecond;
+        }
+        m_progressCallback(info);
+        m_progressNext = position + std::max((size_t)((double)m_maxLen * m_progressStep / 100), (size_t)1);
     }
+}
 
-    size_t length = 0;
-    mbstate_t state = {};
-#ifdef USE_WINAPI
-    mbsrtowcs_s(&length, nullptr, 0, &bufferMB, lenMB, &state);
-#else
-    length = std::mbsrtowcs(nullptr, &bufferMB, lenMB, &state);
-#endif
+void JsonReader::JsonInput::notifyProgressEnd()
+{
+    if (m_progressCallback != nullptr)
+    {
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - m_progressStart;
+        PROGRESS_INFO info = {m_maxLen, m_maxLen, 100, elapsed.count() > 0 ? m_maxLen / elapsed.count() : 0, 0};
+        m_progressCallback(info);
+    }
+}
 
-    if (length == 0 || length == static_cast<size_t>(-1))
-        return nullptr;
+#ifdef JSONREADER_ZLIB
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// class JsonReader::GzipSource
 
-    if (length > m_lenMaxWide)
+JsonReader::GzipSource::GzipSource(std::istream& input, size_t size)
+    : m_input(input), m_inBuffer(new char[COMPRESSED_BUFFER_LEN])
+{
+    m_size = size;
+    m_consumed = 0;
+    m_isMemberEnd = false;
+    z_stream* stream = new z_stream();
+    if (inflateInit2(stream, 15 + 32) != Z_OK) // Adding 32 to the window bits detects the gzip or zlib header.
     {
-        if (m_bufferWide)
-            delete[] m_bufferWide;
-        m_lenMaxWide = length;
-        m_bufferWide = new wchar_t[m_lenMaxWide + 1];
-        m_bufferWide[0] = 0;
+        delete stream;
+        throw std::bad_alloc();
     }
-
-    state = {};
-#ifdef USE_WINAPI
-    mbsrtowcs_s(&length, m_bufferWide, length, &bufferMB, lenMB, &state);
-    length--; // do not include the null terminator.
-#else
-    const char* src = &(bufferMB[0]);
-    std::mbsrtowcs(m_bufferWide, (const char**)&src, lenMB, &state);
-#endif
-    m_bufferWide[length] = 0;
-    return WideToUtf8(m_bufferWide, length, lenOut);
+    m_stream = stream;
 }
 
-const char* JsonReader::TextConverter::Utf8ToMultiByte(const char* bufferUtf8, const size_t lenUtf8, size_t* lenOut)
+JsonReader::GzipSource::~GzipSource()
 {
-    if (!bufferUtf8)
-        return nullptr;
+    z_stream* stream = static_cast<z_stream*>(m_stream);
+    inflateEnd(stream);
+    delete stream;
+}
 
-    if (lenUtf8 == 0)
+size_t JsonReader::GzipSource::read(char* buffer, size_t len)
+{
+    z_stream* stream = static_cast<z_stream*>(m_stream);
+    len = std::min(len, (size_t)UINT_MAX);
+    stream->next_out = reinterpret_cast<Bytef*>(buffer);
+    stream->avail_out = (uInt)len;
+    while (stream->avail_out > 0)
     {
-        m_bufferNarrow[0] = 0;
-        return m_bufferNarrow;
+        if (stream->avail_in == 0)
+        {
+            m_input.read(m_inBuffer.get(), COMPRESSED_BUFFER_LEN);
+            size_t inLen = (size_t)m_input.gcount();
+            if (inLen == 0)
+            {
+                // The data decompressed before a truncation is returned first, so the error is found after it.
+                if (!m_isMemberEnd && stream->avail_out == len)
+                    throwError(ERROR_INVALID_COMPRESSED_DATA, "truncated data");
+                break;
+            }
+            m_consumed += inLen;
+            stream->next_in = reinterpret_cast<Bytef*>(m_inBuffer.get());
+            stream->avail_in = (uInt)inLen;
+        }
+        if (m_isMemberEnd) // More data follows the end of a member, so it is the beginning of the next one.
+        {
+            inflateReset(stream);
+            m_isMemberEnd = false;
+        }
+        int result = inflate(stream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END)
+            m_isMemberEnd = true;
+        else if (result != Z_OK && result != Z_BUF_ERROR)
+            throwError(ERROR_INVALID_COMPRESSED_DATA, stream->msg ? stream->msg : "zlib error"); // Static messages.
     }
+    return len - stream->avail_out;
+}
+#endif
 
-    size_t length = 0;
-    size_t lenWide = 0;
-
-    const wchar_t* bufferWide = Utf8ToWide(bufferUtf8, lenUtf8, &lenWide);
+#ifdef JSONREADER_ZSTD
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// class JsonReader::ZstdSource
 
-#ifdef USE_WINAPI
-    wcstombs_s(&length, nullptr, 0, bufferWide, 0);
-#else
-    mbstate_t state = {};
-    length = std::wcsrtombs(nullptr, (const wchar_t**)&bufferWide, lenWide, &state);
-#endif
+JsonReader::ZstdSource::ZstdSource(std::istream& input, size_t size)
+    : m_input(input), m_inBuffer(new char[COMPRESSED_BUFFER_LEN])
+{
+    m_inLen = 0;
+    m_inPos = 0;
+    m_size = size;
+    m_consumed = 0;
+    m_isFrameEnd = false;
+    m_context = ZSTD_createDCtx();
+    if (!m_context)
+        throw std::bad_alloc();
+}
 
-    if (length == 0 || length == static_cast<size_t>(-1))
-        return nullptr;
+JsonReader::ZstdSource::~ZstdSource() { ZSTD_freeDCtx(static_cast<ZSTD_DCtx*>(m_context)); }
 
-    if (length > m_lenMaxNarrow)
+size_t JsonReader::ZstdSource::read(char* buffer, size_t len)
+{
+    ZSTD_outBuffer out = {buffer, len, 0};
+    while (out.pos < out.size)
     {
-        if (m_bufferNarrow)
-            delete[] m_bufferNarrow;
-        m_lenMaxNarrow = length;
-        m_bufferNarrow = new char[m_lenMaxNarrow + 1];
-        m_bufferNarrow[0] = 0;
+        if (m_inPos == m_inLen)
+        {
+            m_input.read(m_inBuffer.get(), COMPRESSED_BUFFER_LEN);
+            m_inLen = (size_t)m_input.gcount();
+            m_inPos = 0;
+            if (m_inLen == 0)
+            {
+                // The data decompressed before a truncation is returned first, so the error is found after it.
+                if (!m_isFrameEnd && out.pos == 0)
+                    throwError(ERROR_INVALID_COMPRESSED_DATA, "truncated data");
+                break;
+            }
+            m_consumed += m_inLen;
+        }
+        // Once a frame ends, the next call begins decompressing the following one, if any.
+        ZSTD_inBuffer in = {m_inBuffer.get(), m_inLen, m_inPos};
+        size_t result = ZSTD_decompressStream(static_cast<ZSTD_DCtx*>(m_context), &out, &in);
+        m_inPos = in.pos;
+        if (ZSTD_isError(result))
+            throwError(ERROR_INVALID_COMPRESSED_DATA, ZSTD_getErrorName(result)); // Static messages.
+        m_isFrameEnd = (result == 0); // The frame has been decoded and flushed completely.
     }
-
-#ifdef USE_WINAPI
-    wcstombs_s(&length, m_bufferNarrow, m_lenMaxNarrow, bufferWide, length);
-    length--; // do not include the null terminator.
-#else
-    state = {};
-    std::wcsrtombs(m_bufferNarrow, (const wchar_t**)&bufferWide, length, &state);
-#endif
-    m_bufferNarrow[length] = 0;
-    if (lenOut)
-        (*lenOut) = length - 1;
-    return m_bufferNarrow;
+    return out.pos;
 }
+#endif
 
-void JsonReader::TextConverter::Utf8ToMultiByte(const std::string stringUtf8, std::string& stringMB)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// class JsonReader::Callback
+
+bool JsonReader::toInt64(STR* value, int64_t& result)
 {
-    const char* bufferMB = Utf8ToMultiByte(stringUtf8.c_str(), (int)stringUtf8.length());
-    if (bufferMB)
-        stringMB = bufferMB;
-    else
-        stringMB.clear();
+    if (!value)
+        return false; // Null values, objects and arrays are not notified.
+    if (!value->number)
+        throwError(ERROR_NOT_A_NUMBER, value->toUtf8());
+    if (!value->number->isValid)
+        throwError(ERROR_INVALID_NUMBER, value->toUtf8());
+    if (!value->number->isInteger)
+        throwError(ERROR_NOT_AN_INTEGER, value->toUtf8());
+    if (!value->number->toInt64(result))
+        throwError(ERROR_OUT_OF_RANGE, value->toUtf8());
+    return true;
 }
 
-const char* JsonReader::TextConverter::CodePointToUtf8(const uint32_t codePoint, size_t& lenOut)
+bool JsonReader::toDouble(STR* value, double& result)
 {
-#ifdef USE_WINAPI
-    lenOut = WideCharToMultiByte(CP_UTF8, 0, (const wchar_t*)&codePoint, 2, NULL, 0, NULL, NULL);
+    if (!value)
+        return false; // Null values, objects and arrays are not notified.
+    if (!value->number)
+        throwError(ERROR_NOT_A_NUMBER, value->toUtf8());
+    if (!value->number->isValid)
+        throwError(ERROR_INVALID_NUMBER, value->toUtf8());
+    if (!value->number->toDouble(value->data(), value->length, result))
+        throwError(ERROR_OUT_OF_RANGE, value->toUtf8());
+    return true;
+}
 
-    if (lenOut == 0)
-        return nullptr;
+void JsonReader::assign(std::string& member, STR* value) { member.assign(value->data(), value->length); }
 
-    if (lenOut > m_lenMaxNarrow)
-    {
-        if (m_bufferNarrow)
-            delete[] m_bufferNarrow;
-        m_lenMaxNarrow = lenOut;
-        m_bufferNarrow = new char[m_lenMaxNarrow + 1];
-        m_bufferNarrow[0] = 0;
-    }
+void JsonReader::assign(std::wstring& member, STR* value) { member = value->toWide(); }
 
-    WideCharToMultiByte(CP_UTF8, 0, (const wchar_t*)&codePoint, 2, m_bufferNarrow, (int)lenOut, NULL, NULL);
-    lenOut--; // do not include the null terminator.
-    return m_bufferNarrow;
-#else
-    m_str = m_codecvt.to_bytes(codePoint);
-    lenOut = m_str.length();
-    return m_str.c_str();
-#endif
+void JsonReader::assign(bool& member, STR* value)
+{
+    if (!value->isQuoted && value->length == 4 && memcmp(value->data(), "true", 4) == 0)
+        member = true;
+    else if (!value->isQuoted && value->length == 5 && memcmp(value->data(), "false", 5) == 0)
+        member = false;
+    else
+        throwError(ERROR_NOT_A_BOOLEAN, value->toUtf8());
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// struct JsonReader::STR
+void JsonReader::assign(double& member, STR* value) { toDouble(value, member); }
 
-JsonReader::STR::STR()
+void JsonReader::assign(float& member, STR* value)
 {
-    capacity = CAPACITY_DEFAULT;
-    str = new char[capacity];
-    setLength(0);
-    isAscii = true;
-    isQuoted = false;
-    useLocale = false;
+    double result;
+    if (toDouble(value, result))
+        member = (float)result;
 }
 
-JsonReader::STR::STR(const wchar_t* source, bool useLocale) : STR()
+JsonReader::CallbackItems::CallbackItems(std::function<void(const ITEM_VALUE*, size_t)>&& callback, size_t batchSize)
+    : m_func(std::move(callback)), m_batchSize(batchSize)
 {
-    const char* utf8 = converter.WideToUtf8(source, wcslen(source));
-    if (utf8)
-        copy(utf8, (int)strlen(utf8), true);
-    this->useLocale = useLocale;
+    m_items.reserve(batchSize);
+    m_data.reserve(BATCH_DATA_LEN);
 }
 
-void JsonReader::STR::copy(const char* source, size_t sourceLen, bool checkCapacity, bool checkEncoding)
+void JsonReader::CallbackItems::notify(STR* value)
 {
-    if (checkCapacity)
-        resize(sourceLen);
-    if (sourceLen > 0)
-        memcpy((void*)str, source, sourceLen);
-    setLength(sourceLen);
-    isAscii = true;
-    if (checkEncoding)
-        for (size_t i = 0; i < sourceLen; i++)
-            if (static_cast<unsigned char>(source[i]) > 0x7F)
-            {
-                isAscii = false;
-            }
-    isQuoted = false;
+    ITEM_VALUE item = {nullptr, 0, false};
+    if (value)
+    {
+        item.length = value->length;
+        item.isQuoted = value->isQuoted;
+        if (value->view)
+            item.value = value->view; // It refers to the input, which is contiguous and remains valid.
+        else
+        {
+            // The buffer only grows when it is empty, which may happen if a single value does not fit.
+            if (m_data.size() + value->length > m_data.capacity())
+                flush(false);
+            size_t offset = m_data.size();
+            m_data.insert(m_data.end(), value->data(), value->data() + value->length);
+            item.value = m_data.data() + offset;
+        }
+    }
+    m_items.push_back(item);
+    if (m_items.size() >= m_batchSize)
+        flush(false);
 }
 
-void JsonReader::STR::clear()
+void JsonReader::CallbackItems::flush(bool isDiscarded)
 {
-    if (length > 0)
-        setLength(0);
-    isAscii = true;
-    isQuoted = false;
+    if (!m_items.empty() && !isDiscarded)
+        m_func(m_items.data(), m_items.size());
+    m_items.clear();
+    m_data.clear();
 }
 
-void JsonReader::STR::resize(size_t newCapacity)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// class JsonReader::BindingBase
+
+JsonReader::BindingBase::BindingBase()
 {
-    if (newCapacity > capacity)
+    m_seed = Publisher::HASH_SEED;
+    m_mask = 0;
+}
+
+int JsonReader::BindingBase::find(const char* name, size_t nameLen) const
+{
+    if (m_table.empty())
+        return -1;
+    int index = m_table[Publisher::hash(name, nameLen, m_seed) & m_mask];
+    if (index < 0 || m_names[index].length() != nameLen || memcmp(m_names[index].data(), name, nameLen) != 0)
+        return -1;
+    return index;
+}
+
+size_t JsonReader::BindingBase::addName(const char* nameUtf8)
+{
+    int existing = find(nameUtf8, strlen(nameUtf8));
+    if (existing >= 0)
+        return existing;
+    m_names.push_back(nameUtf8);
+
+    // Look for a table size and a seed with which the names do not collide, starting with a table twice as large as
+    // the number of names. Doubling the size after a number of attempts ensures that a seed is found soon.
+    size_t size = 1;
+    while (size < m_names.size() * 2)
+        size *= 2;
+    for (uint64_t attempt = 1;; attempt++)
     {
-        capacity = newCapacity;
-        char* newString = new char[capacity];
-        if (str != nullptr)
+        uint64_t seed = Publisher::HASH_SEED ^ (attempt * 0x9E3779B97F4A7C15ull);
+        m_table.assign(size, -1);
+        size_t i = 0;
+        for (; i < m_names.size(); i++)
         {
-            memcpy(newString, str, length);
-            newString[length] = 0;
-            delete[] str;
+            int& entry = m_table[Publisher::hash(m_names[i].data(), m_names[i].length(), seed) & (size - 1)];
+            if (entry >= 0)
+                break; // Collision.
+            entry = (int)i;
         }
-        str = newString;
+        if (i == m_names.size())
+        {
+            m_seed = seed;
+            m_mask = size - 1;
+            break;
+        }
+        if (attempt % 64 == 0)
+            size *= 2;
     }
+    return m_names.size() - 1;
 }
 
-void JsonReader::STR::setLength(size_t newLength)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// class JsonReader::Subscriptions
+
+// Last identifier given to the patterns of a set of subscriptions (see 'm_patternsId'), which is unique across sets.
+static std::atomic<uint64_t> s_lastPatternsId(0);
+
+JsonReader::Subscriptions::Subscriptions()
 {
-    if (newLength < capacity && str)
-    {
-        length = newLength;
-        str[length] = 0;
-    }
+    m_canSkipValues = true;
+    m_hasBatches = false;
+    m_patternsId = 0;
 }
 
-void JsonReader::STR::release()
+void JsonReader::Subscriptions::clear()
 {
-    if (str != nullptr)
-        delete[] str;
-    str = nullptr;
+    if (isEmpty())
+        return;
+    m_onObjectBegin.unsubscribe();
+    m_onObjectEnd.unsubscribe();
+    m_onArrayBegin.unsubscribe();
+    m_onArrayEnd.unsubscribe();
+    m_onArrayItem.unsubscribe();
+    m_onPair.unsubscribe();
+    for (const std::pair<KEY, Binder*>& binder : m_binders)
+        binder.second->~Binder();
+    m_binders.clear();
+    for (const PATTERN& pattern : m_patterns)
+        pattern.callback->~Callback();
+    m_patterns.clear();
+    m_pathPrefixes.clear();
+    m_canSkipValues = true;
+    m_hasBatches = false;
+    m_arena.reset(); // The keys of 'm_pathPrefixes', 'm_binders' and 'm_patterns' referred to the arena as well.
 }
 
-const char* JsonReader::STR::toNarrow()
+void JsonReader::Subscriptions::subscribe(Publisher& publisher, const wchar_t* element, Callback* callback)
 {
-    if (length == 0 || isAscii || !useLocale)
-        return str;
-    return converter.Utf8ToMultiByte(str, length);
+    if (element)
+    {
+        // Convert input string to UTF-8.
+        STR elementStr(element);
+        subscribe(publisher, elementStr.toUtf8(), callback);
+    }
+    else
+        subscribe(publisher, (const char*)nullptr, callback);
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// class JsonReader::JsonSource
+void JsonReader::Subscriptions::subscribe(Publisher& publisher, const char* elementUtf8, Callback* callback)
+{
+    if (elementUtf8 && (elementUtf8[0] == '/' || strchr(elementUtf8, '*')))
+    {
+        subscribePattern(publisher, elementUtf8, callback);
+        return;
+    }
+    const KEY* path = publisher.subscribe(elementUtf8, callback, m_arena);
+    if (!path)
+    {
+        // Elements subscribed by name or all elements may be notified anywhere.
+        m_canSkipValues = false;
+        return;
+    }
+    addPathPrefixes(*path); // The prefixes refer to the key stored by the publisher.
+}
 
-JsonReader::JsonInput::JsonInput() { clear(); }
+void JsonReader::Subscriptions::subscribePattern(Publisher& publisher, const char* patternUtf8, Callback* callback)
+{
+    size_t length = strlen(patternUtf8);
+    for (PATTERN& pattern : m_patterns)
+    {
+        if (pattern.publisher == &publisher && pattern.len == length && memcmp(pattern.str, patternUtf8, length) == 0)
+        {
+            // Replace the previous callback. The paths still match the same patterns.
+            pattern.callback->~Callback();
+            pattern.callback = callback;
+            return;
+        }
+    }
+    if (m_patterns.size() == MAX_PATTERNS)
+    {
+        callback->~Callback();
+        throwException("Cannot subscribe more than %u patterns", (unsigned)MAX_PATTERNS);
+    }
+    if (patternUtf8[0] == '/')
+    {
+        // The items of the arrays are not counted, so a token that may be an array index (a zero or digits not
+        // beginning with zero) would never match one. It is rejected rather than taken as the name of a member.
+        for (const char* token = patternUtf8; token; token = strchr(token + 1, '/'))
+        {
+            size_t tokenLen = strcspn(token + 1, "/");
+            if (tokenLen > 0 && strspn(token + 1, "0123456789") == tokenLen && (token[1] != '0' || tokenLen == 1))
+            {
+                callback->~Callback();
+                throwException("Array indices are not supported in JSON Pointers: %s", patternUtf8);
+            }
+        }
+    }
 
-JsonReader::JsonInput::~JsonInput() { clear(); }
+    PATTERN pattern = {m_arena.copy(patternUtf8, length), length, PATTERN_POINTER, &publisher, callback};
+    if (patternUtf8[0] != '/')
+        pattern.type = strpbrk(patternUtf8, "{[") ? PATTERN_PATH : PATTERN_NAME;
+    if (pattern.type == PATTERN_NAME)
+        m_canSkipValues = false; // As with the elements subscribed by name, they may be found anywhere.
+    publisher.addPattern(m_patterns.size());
+    m_patterns.push_back(pattern);
+    m_patternsId = ++s_lastPatternsId;
+}
 
-void JsonReader::JsonInput::init(const char* source, bool isFile)
+// Returns true if 'text' of 'len' bytes matches 'pattern' of 'patternLen' bytes, where '*' matches any characters
+// but 'separators' and '**' any characters. In a JSON Pointer (whose separator is '/'), '/**/' matches '/' as well.
+// If 'isPrefix' is true, returns true if 'text' is the beginning of a matching text instead.
+// The pattern works as an NFA whose states are its positions, so the text is scanned once.
+static bool matchPattern(const char* pattern, size_t patternLen, const char* text, size_t len, const char* separators,
+                         bool isPrefix)
 {
-    if (isFile)
+    bool isPointer = (separators[0] == '/');
+    std::vector<char> states(patternLen + 1, 0);
+    std::vector<char> nextStates(patternLen + 1, 0);
+    // Adds to 'states' those reached without consuming any character, in one pass as they are further on.
+    auto addSkipped = [&](std::vector<char>& states)
     {
-        if (!openFile(source))
+        for (size_t i = 0; i < patternLen; i++)
+        {
+            if (!states[i])
+                continue;
+            if (pattern[i] == '*')
+                states[i + ((i + 1 < patternLen && pattern[i + 1] == '*') ? 2 : 1)] = 1;
+            else if (isPointer && pattern[i] == '/' && i + 3 < patternLen && pattern[i + 1] == '*' &&
+                     pattern[i + 2] == '*' && pattern[i + 3] == '/')
+                states[i + 3] = 1;
+        }
+    };
+    states[0] = 1;
+    addSkipped(states);
+    for (size_t pos = 0; pos < len; pos++)
+    {
+        char ch = text[pos];
+        bool isSeparator = ch && strchr(separators, ch);
+        bool isAlive = false;
+        std::fill(nextStates.begin(), nextStates.end(), 0);
+        for (size_t i = 0; i < patternLen; i++)
         {
-            throwException("Cannot open file.");
+            if (!states[i])
+                continue;
+            if (pattern[i] == '*')
+            {
+                if ((i + 1 < patternLen && pattern[i + 1] == '*') || !isSeparator)
+                {
+                    nextStates[i] = 1;
+                    isAlive = true;
+                }
+            }
+            else if (pattern[i] == ch)
+            {
+                nextStates[i + 1] = 1;
+                isAlive = true;
+            }
         }
+        if (!isAlive)
+            return false;
+        addSkipped(nextStates);
+        states.swap(nextStates);
     }
-    else
+    return isPrefix || states[patternLen];
+}
+
+// Appends to 'pointer' the JSON Pointer of the element with path 'path' of 'len' bytes, escaping the names. The items
+// of an array have the path of the array, so the pointer refers to them if 'isItem' is true, and to the array
+// otherwise. Since their indices are not known, an item is written as a byte that does not appear in UTF-8 text,
+// which only '*' matches.
+static void getPointer(const char* path, size_t len, bool isItem, std::string& pointer)
+{
+    size_t pos = 0;
+    while (pos < len)
     {
-        if (!setBuffer(source))
+        char bracket = path[pos++];
+        if (bracket == '[')
+        {
+            if (pos < len || isItem)
+                pointer += "/\xff";
+            continue;
+        }
+        size_t namePos = pos;
+        while (pos < len && path[pos] != '{' && path[pos] != '[')
+            pos++;
+        if (pos == len && pos == namePos)
+            break; // The path of an object ends with its bracket.
+        pointer += '/';
+        for (size_t i = namePos; i < pos; i++)
         {
-            throwException("Cannot set buffer.");
+            if (path[i] == '~')
+                pointer += "~0";
+            else if (path[i] == '/')
+                pointer += "~1";
+            else
+                pointer += path[i];
         }
     }
 }
 
-void JsonReader::JsonInput::clear()
+void JsonReader::Subscriptions::matchPatterns(const char* path, size_t pathLen, uint64_t& matches,
+                                              uint64_t& prefixes) const
 {
-    if (m_file.is_open())
+    matches = 0;
+    prefixes = 0;
+    // The name of an element follows the last bracket of its path, unless it is an object or array (in which case
+    // its path ends with a bracket), or an array item (which gets the name of its array).
+    size_t nameEnd = (pathLen > 0 && (path[pathLen - 1] == '{' || path[pathLen - 1] == '[')) ? pathLen - 1 : pathLen;
+    size_t namePos = nameEnd;
+    while (namePos > 0 && path[namePos - 1] != '{' && path[namePos - 1] != '[')
+        namePos--;
+    std::string pointer, itemPointer; // Built when first needed.
+    for (size_t i = 0; i < m_patterns.size(); i++)
     {
-        m_file.close();
-        if (m_buffer)
-            delete[] m_buffer;
+        const PATTERN& pattern = m_patterns[i];
+        uint64_t bit = 1ull << i;
+        if (pattern.type == PATTERN_NAME)
+        {
+            if (matchPattern(pattern.str, pattern.len, path + namePos, nameEnd - namePos, "", false))
+                matches |= bit;
+            prefixes |= bit; // Any element nested in this one may match.
+        }
+        else if (pattern.type == PATTERN_PATH)
+        {
+            if (matchPattern(pattern.str, pattern.len, path, pathLen, "{[", true))
+            {
+                prefixes |= bit;
+                if (matchPattern(pattern.str, pattern.len, path, pathLen, "{[", false))
+                    matches |= bit;
+            }
+        }
+        else
+        {
+            if (pointer.empty() && itemPointer.empty())
+            {
+                getPointer(path, pathLen, false, pointer);
+                getPointer(path, pathLen, true, itemPointer);
+            }
+            const std::string& text = (pattern.publisher == &m_onArrayItem) ? itemPointer : pointer;
+            if (matchPattern(pattern.str, pattern.len, text.data(), text.length(), "/", false))
+                matches |= bit;
+            if (matchPattern(pattern.str, pattern.len, pointer.data(), pointer.length(), "/", true))
+                prefixes |= bit;
+        }
     }
-
-    m_idx = (size_t)-1;
-    m_bufferLen = 0;
-    m_maxLen = 0;
-    m_buffer = nullptr;
-    m_isEOF = false;
-    m_position = 0;
-    m_progressStep = 0;
-    m_progressNext = 0;
 }
 
-bool JsonReader::JsonInput::openFile(const char* fileFullPath)
+size_t JsonReader::Subscriptions::getBatchSize(size_t batchSize) { return batchSize > 0 ? batchSize : BATCH_SIZE; }
+
+void JsonReader::Subscriptions::addPathPrefixes(const KEY& path)
 {
-    m_file.open(fileFullPath, std::ifstream::in | std::ios::binary);
-    if (m_file.is_open())
+    // The hashes of the prefixes are computed in one pass, so that the paths of deeply nested elements are added in
+    // linear time.
+    std::vector<uint64_t> hashes(path.len + 1);
+    hashes[0] = Publisher::HASH_SEED;
+    for (size_t len = 1; len <= path.len; len++)
+        hashes[len] = Publisher::hash(path.str + len - 1, 1, hashes[len - 1]);
+    for (size_t len = path.len; len > 0; len--)
     {
-        // Get the file size.
-        m_file.seekg(0, m_file.end);
-        m_maxLen = m_file.tellg();
-        m_file.seekg(0, m_file.beg);
-
-        m_buffer = new char[FILE_BUFFER_LEN];
-        m_isEOF = false;
-        fillBuffer();
-        m_idx = (size_t)-1;
-        return true;
+        KEY prefix = {path.str, len, hashes[len]};
+        if (!m_pathPrefixes.insert(prefix).second)
+            break; // The shorter prefixes have already been added.
     }
-    return false;
 }
 
-bool JsonReader::JsonInput::setBuffer(const char* buffer)
+void JsonReader::Subscriptions::bind(const wchar_t* objectPath, Binder* binder)
 {
-    m_bufferLen = strlen(buffer); // The input buffer must be null terminated.
-    m_maxLen = m_bufferLen;
-    // Constness must be removed due to the assignment, but the content will not be modified.
-    m_buffer = const_cast<char*>(buffer);
-    m_idx = (size_t)-1;
-    return true;
+    STR objectPathStr(objectPath);
+    bind(objectPathStr.toUtf8(), binder);
 }
 
-void JsonReader::JsonInput::fillBuffer()
+void JsonReader::Subscriptions::bind(const char* objectPathUtf8, Binder* binder)
 {
-    m_idx = 0;
-    m_bufferLen = 0;
-
-    if (m_isEOF == true)
-        throwException("Unexpected end of file.");
-
-    if (m_file.is_open()) // The buffer is only refilled if the source is a file.
+    size_t length = strlen(objectPathUtf8);
+    for (std::pair<KEY, Binder*>& bound : m_binders)
     {
-        m_file.read(m_buffer, FILE_BUFFER_LEN);
-        m_bufferLen = (size_t)m_file.gcount();
+        if (bound.first.len == length && memcmp(bound.first.str, objectPathUtf8, length) == 0)
+        {
+            // Replace the previous binder.
+            bound.second->~Binder();
+            bound.second = binder;
+            return;
+        }
     }
+    KEY path = {m_arena.copy(objectPathUtf8, length), length, Publisher::hash(objectPathUtf8, length)};
+    m_binders.push_back(std::make_pair(path, binder));
+    addPathPrefixes(path); // The members of the objects must not be skipped either (see 'parseValue').
 }
 
-bool JsonReader::JsonInput::findFirstChar()
+bool JsonReader::Subscriptions::isValueNeeded(char* path, size_t pathLen, uint64_t pathHash, char ch,
+                                              bool isArrayItem) const
 {
-    bool isValid = false;
-    char ch = 0;
-    while (!isValid)
+    if (ch == '{' || ch == '[')
     {
-        ch = getNextChar();
-        if (m_isEOF)
-            return false;
-        isValid = (ch == '{' || ch == '[' || ch == '\"' || ch == 't' || ch == 'f' || ch == 'n' || ch == '-' ||
-                   (ch >= '0' && ch <= '9'));
+        // The paths of an object or array, and of its elements, begin with the path of the object or array.
+        char backupChar = path[pathLen];
+        path[pathLen] = ch;
+        KEY prefix = {path, pathLen + 1, Publisher::hash(&ch, 1, pathHash)};
+        bool isNeeded = m_pathPrefixes.find(prefix) != m_pathPrefixes.end();
+        path[pathLen] = backupChar;
+        return isNeeded;
     }
-    return true;
+    // Other values are only needed if they are notified.
+    if (isArrayItem)
+        return m_onArrayItem.isSubscribed(path, pathLen, pathHash);
+    return m_onPair.isSubscribed(path, pathLen, pathHash);
 }
 
-char JsonReader::JsonInput::getNextChar(bool verbatim)
+// -> Wide character string versions.
+void JsonReader::Subscriptions::onObjectBegin(const wchar_t* element, std::function<void()> callback)
 {
-    do
-    {
-        if (++m_idx >= m_bufferLen)
-            fillBuffer();
-        if (m_bufferLen == 0)
-        {
-            m_isEOF = true;
-            return 0;
-        }
-        m_position++;
-    } while (!verbatim &&
-             (m_buffer[m_idx] == ' ' || m_buffer[m_idx] == '\r' || m_buffer[m_idx] == '\n' || m_buffer[m_idx] == '\t' ||
-              m_buffer[m_idx] == ':' || m_buffer[m_idx] == ',' || m_buffer[m_idx] == '\0'));
-    return m_buffer[m_idx];
+    onObjectBegin<wchar_t>(element, std::move(callback));
 }
-
-char JsonReader::JsonInput::charToHex(char input)
+void JsonReader::Subscriptions::onObjectEnd(const wchar_t* element, std::function<void()> callback)
 {
-    if (input >= '0' && input <= '9')
-        return (input - '0');
-    else if (input >= 'a' && input <= 'f')
-        return (input - 'a' + 10);
-    else if (input >= 'A' && input <= 'F')
-        return (input - 'A' + 10);
-    throwException("Invalid hex digit '%c'.", input);
+    onObjectEnd<wchar_t>(element, std::move(callback));
 }
-
-void JsonReader::JsonInput::readEscapeSequence(STR& text)
+void JsonReader::Subscriptions::onArrayBegin(const wchar_t* element, std::function<void()> callback)
 {
-    switch (getNextChar(true))
-    {
-    case '\"':
-        text.str[text.length++] = '\"';
-        break;
-    case '\\':
-        text.str[text.length++] = '\\';
-        break;
-    case '/':
-        text.str[text.length++] = '/';
-        break;
-    case 'b':
-        text.str[text.length++] = '\b';
-        break;
-    case 'f':
-        text.str[text.length++] = '\f';
-        break;
-    case 'n':
-        text.str[text.length++] = '\n';
-        break;
-    case 'r':
-        text.str[text.length++] = '\r';
-        break;
-    case 't':
-        text.str[text.length++] = '\t';
-        break;
-    case 'u':
-        getEscapedCodePoint(text);
-        break;
-    default:
-        throwException("Invalid escape sequence '\\%c'.", m_buffer[m_idx]);
-    }
+    onArrayBegin<wchar_t>(element, std::move(callback));
 }
-
-void JsonReader::JsonInput::getEscapedCodePoint(STR& text)
+void JsonReader::Subscriptions::onArrayEnd(const wchar_t* element, std::function<void()> callback)
 {
-    uint16_t escapeSequence = 0; // 4 hex digits expected.
-    for (int i = 0; i < 4; i++)
-    {
-        escapeSequence <<= 4;
-        escapeSequence |= charToHex(getNextChar(true));
-    }
-    size_t utf8Len = 0;
-    const char* utf8 = m_converter.CodePointToUtf8(escapeSequence, utf8Len);
-    if ((text.length + utf8Len) >= text.capacity)
-        text.resize((size_t)(text.length * RESIZE_FACTOR));
-    memcpy(text.str + text.length, utf8, utf8Len);
-    text.length += utf8Len;
-    text.isAscii = false;
+    onArrayEnd<wchar_t>(element, std::move(callback));
 }
-
-void JsonReader::JsonInput::goToPreviousChar()
+void JsonReader::Subscriptions::onArrayItem(const wchar_t* element, std::function<void(const char*)> callback)
+{
+    onArrayItem<wchar_t>(element, std::move(callback));
+}
+void JsonReader::Subscriptions::onArrayItem(const wchar_t* element, std::function<void(const wchar_t*)> callback)
+{
+    onArrayItem<wchar_t>(element, std::move(callback));
+}
+void JsonReader::Subscriptions::onPair(const wchar_t* element, std::function<void(const char*)> callback)
+{
+    onPair<wchar_t>(element, std::move(callback));
+}
+void JsonReader::Subscriptions::onPair(const wchar_t* element, std::function<void(const wchar_t*)> callback)
+{
+    onPair<wchar_t>(element, std::move(callback));
+}
+// -> UTF-8 string versions.
+void JsonReader::Subscriptions::onObjectBegin(const char* elementUtf8, std::function<void()> callback)
+{
+    onObjectBegin<char>(elementUtf8, std::move(callback));
+}
+void JsonReader::Subscriptions::onObjectEnd(const char* elementUtf8, std::function<void()> callback)
+{
+    onObjectEnd<char>(elementUtf8, std::move(callback));
+}
+void JsonReader::Subscriptions::onArrayBegin(const char* elementUtf8, std::function<void()> callback)
+{
+    onArrayBegin<char>(elementUtf8, std::move(callback));
+}
+void JsonReader::Subscriptions::onArrayEnd(const char* elementUtf8, std::function<void()> callback)
+{
+    onArrayEnd<char>(elementUtf8, std::move(callback));
+}
+void JsonReader::Subscriptions::onArrayItem(const char* elementUtf8, std::function<void(const char*)> callback)
+{
+    onArrayItem<char>(elementUtf8, std::move(callback));
+}
+void JsonReader::Subscriptions::onArrayItem(const char* elementUtf8, std::function<void(const wchar_t*)> callback)
+{
+    onArrayItem<char>(elementUtf8, std::move(callback));
+}
+void JsonReader::Subscriptions::onPair(const char* elementUtf8, std::function<void(const char*)> callback)
 {
-    m_idx--;
-    m_position--;
+    onPair<char>(elementUtf8, std::move(callback));
+}
+void JsonReader::Subscriptions::onPair(const char* elementUtf8, std::function<void(const wchar_t*)> callback)
+{
+    onPair<char>(elementUtf8, std::move(callback));
+}
+void JsonReader::Subscriptions::onArrayItem(const wchar_t* element, std::function<void(const char*, size_t)> callback)
+{
+    onArrayItem<wchar_t>(element, std::move(callback));
+}
+void JsonReader::Subscriptions::onPair(const wchar_t* element, std::function<void(const char*, size_t)> callback)
+{
+    onPair<wchar_t>(element, std::move(callback));
+}
+void JsonReader::Subscriptions::onArrayItemInt64(const wchar_t* element, std::function<void(int64_t)> callback)
+{
+    onArrayItemInt64<wchar_t>(element, std::move(callback));
+}
+void JsonReader::Subscriptions::onArrayItemDouble(const wchar_t* element, std::function<void(double)> callback)
+{
+    onArrayItemDouble<wchar_t>(element, std::move(callback));
+}
+void JsonReader::Subscriptions::onPairInt64(const wchar_t* element, std::function<void(int64_t)> callback)
+{
+    onPairInt64<wchar_t>(element, std::move(callback));
+}
+void JsonReader::Subscriptions::onPairDouble(const wchar_t* element, std::function<void(double)> callback)
+{
+    onPairDouble<wchar_t>(element, std::move(callback));
+}
+void JsonReader::Subscriptions::onArrayItems(const wchar_t* element,
+                                             std::function<void(const ITEM_VALUE*, size_t)> callback,
+                                             size_t batchSize)
+{
+    Callback* batch = m_arena.create<CallbackItems>(std::move(callback), getBatchSize(batchSize));
+    subscribe(m_onArrayItem, element, batch);
+    m_hasBatches = true;
+}
+void JsonReader::Subscriptions::onArrayItemsInt64(const wchar_t* element,
+                                                  std::function<void(const int64_t*, size_t)> callback,
+                                                  size_t batchSize)
+{
+    Callback* batch = m_arena.create<CallbackNumbers<int64_t>>(std::move(callback), getBatchSize(batchSize));
+    subscribe(m_onArrayItem, element, batch);
+    m_hasBatches = true;
+}
+void JsonReader::Subscriptions::onArrayItemsDouble(const wchar_t* element,
+                                                   std::function<void(const double*, size_t)> callback,
+                                                   size_t batchSize)
+{
+    Callback* batch = m_arena.create<CallbackNumbers<double>>(std::move(callback), getBatchSize(batchSize));
+    subscribe(m_onArrayItem, element, batch);
+    m_hasBatches = true;
+}
+void JsonReader::Subscriptions::onArrayItem(const char* elementUtf8, std::function<void(const char*, size_t)> callback)
+{
+    onArrayItem<char>(elementUtf8, std::move(callback));
+}
+void JsonReader::Subscriptions::onPair(const char* elementUtf8, std::function<void(const char*, size_t)> callback)
+{
+    onPair<char>(elementUtf8, std::move(callback));
+}
+void JsonReader::Subscriptions::onArrayItemInt64(const char* elementUtf8, std::function<void(int64_t)> callback)
+{
+    onArrayItemInt64<char>(elementUtf8, std::move(callback));
+}
+void JsonReader::Subscriptions::onArrayItemDouble(const char* elementUtf8, std::function<void(double)> callback)
+{
+    onArrayItemDouble<char>(elementUtf8, std::move(callback));
+}
+void JsonReader::Subscriptions::onPairInt64(const char* elementUtf8, std::function<void(int64_t)> callback)
+{
+    onPairInt64<char>(elementUtf8, std::move(callback));
+}
+void JsonReader::Subscriptions::onPairDouble(const char* elementUtf8, std::function<void(double)> callback)
+{
+    onPairDouble<char>(elementUtf8, std::move(callback));
+}
+void JsonReader::Subscriptions::onArrayItems(const char* elementUtf8,
+                                             std::function<void(const ITEM_VALUE*, size_t)> callback,
+                                             size_t batchSize)
+{
+    Callback* batch = m_arena.create<CallbackItems>(std::move(callback), getBatchSize(batchSize));
+    subscribe(m_onArrayItem, elementUtf8, batch);
+    m_hasBatches = true;
+}
+void JsonReader::Subscriptions::onArrayItemsInt64(const char* elementUtf8,
+                                                  std::function<void(const int64_t*, size_t)> callback,
+                                                  size_t batchSize)
+{
+    Callback* batch = m_arena.create<CallbackNumbers<int64_t>>(std::move(callback), getBatchSize(batchSize));
+    subscribe(m_onArrayItem, elementUtf8, batch);
+    m_hasBatches = true;
+}
+void JsonReader::Subscriptions::onArrayItemsDouble(const char* elementUtf8,
+                                                   std::function<void(const double*, size_t)> callback,
+                                                   size_t batchSize)
+{
+    Callback* batch = m_arena.create<CallbackNumbers<double>>(std::move(callback), getBatchSize(batchSize));
+    subscribe(m_onArrayItem, elementUtf8, batch);
+    m_hasBatches = true;
 }
 
-void JsonReader::JsonInput::goToNextQuote()
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// class JsonReader::Pool
+
+JsonReader::Pool::Pool(const CONFIG& config, size_t capacity) : m_config(config)
 {
-    while (m_buffer[m_idx] != '\"')
-    {
-        if (++m_idx == m_bufferLen)
-            fillBuffer();
-        m_position++;
-    }
+    if (config.subscriptions && !config.subscriptions->isShareable())
+        throwException("The subscriptions of a pool cannot contain bindings or batches.");
+    m_numSlots = capacity > 0 ? capacity : POOL_CAPACITY;
+    m_slots.reset(new std::atomic<JsonReader*>[m_numSlots]);
+    for (size_t i = 0; i < m_numSlots; i++)
+        m_slots[i].store(nullptr, std::memory_order_relaxed);
 }
 
-void JsonReader::JsonInput::setProgressParams(int step, std::function<void(int)> progressCallback)
+JsonReader::Pool::~Pool()
 {
-    m_progressStep = step;
-    m_progressNext = 0;
-    m_progressCallback = progressCallback;
+    for (size_t i = 0; i < m_numSlots; i++)
+        delete m_slots[i].load(std::memory_order_acquire);
 }
 
-double JsonReader::JsonInput::getProgress()
+// Each thread begins looking for a reader, or for a free slot, at a different slot, so that threads borrowing and
+// returning readers at the same time seldom contend for the same slots.
+static size_t getFirstSlot(size_t numSlots)
 {
-    return (m_maxLen > 0) ? ((double)m_position / (double)m_maxLen) * 100.0 : 0;
+    static thread_local size_t threadHash = std::hash<std::thread::id>()(std::this_thread::get_id());
+    return threadHash % numSlots;
 }
 
-void JsonReader::JsonInput::notifyProgress()
+JsonReader::Pool::Handle JsonReader::Pool::acquire()
 {
-    if ((m_position >= m_progressNext) && m_maxLen > 0)
+    JsonReader* reader = nullptr;
+    size_t first = getFirstSlot(m_numSlots);
+    for (size_t i = 0; i < m_numSlots && !reader; i++)
     {
-        m_progressCallback((int)getProgress());
-        m_progressNext = m_position + m_maxLen / m_progressStep;
+        std::atomic<JsonReader*>& slot = m_slots[(first + i) % m_numSlots];
+        if (slot.load(std::memory_order_relaxed))
+            reader = slot.exchange(nullptr, std::memory_order_acquire); // NULL if another thread took it first.
     }
+    if (!reader)
+        reader = new JsonReader();
+    reader->configure(m_config);
+    reader->setUserData(nullptr);
+    return Handle(this, reader);
 }
 
-void JsonReader::JsonInput::notifyProgressEnd()
+void JsonReader::Pool::release(JsonReader* reader)
 {
-    if (m_progressCallback != nullptr)
-        m_progressCallback(100);
+    // Nothing the borrower left must reach the next one: neither the text being fed nor its own callbacks.
+    reader->discardStream();
+    reader->clear();
+    size_t first = getFirstSlot(m_numSlots);
+    for (size_t i = 0; i < m_numSlots; i++)
+    {
+        std::atomic<JsonReader*>& slot = m_slots[(first + i) % m_numSlots];
+        JsonReader* expected = nullptr;
+        if (!slot.load(std::memory_order_relaxed) &&
+            slot.compare_exchange_strong(expected, reader, std::memory_order_release, std::memory_order_relaxed))
+            return;
+    }
+    delete reader;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// class JsonReader::Callback1
+// class JsonReader::Arena
 
-JsonReader::Callback1::Callback1(std::function<void(const char*)>& callback)
+JsonReader::Arena::Arena()
 {
-    m_funcNarrow = callback;
-    m_narrow = true;
+    m_first = nullptr;
+    m_current = nullptr;
+    m_offset = 0;
 }
 
-JsonReader::Callback1::Callback1(std::function<void(const wchar_t*)>& callback)
+JsonReader::Arena::~Arena()
 {
-    m_funcWide = callback;
-    m_narrow = false;
+    while (m_first)
+    {
+        BLOCK* next = m_first->next;
+        ::operator delete(m_first);
+        m_first = next;
+    }
 }
 
-void JsonReader::Callback1::notify(STR* value)
+void* JsonReader::Arena::allocate(size_t size, size_t alignment)
 {
-    if (m_narrow)
-    {
-        const char* str = nullptr;
-        if (value)
-            str = value->toNarrow();
-        m_funcNarrow(str);
-    }
-    else
+    size_t offset = (m_offset + alignment - 1) & ~(alignment - 1);
+    if (!m_current || offset + size > m_current->size)
     {
-        const wchar_t* wstr = nullptr;
-        if (value)
-            wstr = value->toWide();
-        m_funcWide(wstr);
+        // Go on with the next block if it is large enough. Otherwise, allocate a new one before it.
+        const size_t headerLen = (sizeof(BLOCK) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+        BLOCK* next = m_current ? m_current->next : m_first;
+        if (!next || headerLen + size > next->size)
+        {
+            size_t blockSize = std::max((size_t)BLOCK_SIZE, headerLen + size);
+            BLOCK* block = static_cast<BLOCK*>(::operator new(blockSize));
+            block->next = next;
+            block->size = blockSize;
+            if (m_current)
+                m_current->next = block;
+            else
+                m_first = block;
+            next = block;
+        }
+        m_current = next;
+        offset = headerLen;
     }
+    m_offset = offset + size;
+    return reinterpret_cast<char*>(m_current) + offset;
+}
+
+char* JsonReader::Arena::copy(const char* str, size_t len)
+{
+    char* copy = static_cast<char*>(allocate(len + 1, 1));
+    if (len > 0)
+        memcpy(copy, str, len);
+    copy[len] = 0;
+    return copy;
+}
+
+void JsonReader::Arena::reset()
+{
+    m_current = nullptr;
+    m_offset = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1017,28 +4474,30 @@ JsonReader::Publisher::Publisher()
     m_callbackAll = nullptr;
     m_numSubscribersByName = 0;
     m_numSubscribersByPath = 0;
-    m_name = nullptr;
-    m_nameLen = 0;
+    m_lengthsName = 0;
+    m_lengthsPath = 0;
+    m_patterns = 0;
 }
 
-void JsonReader::Publisher::subscribe(const wchar_t* element, Callback* callback)
+const JsonReader::KEY* JsonReader::Publisher::subscribe(const wchar_t* element, Callback* callback, Arena& arena)
 {
     if (element)
     {
         // Convert input string to UTF-8.
         STR elementStr(element);
-        subscribe(elementStr.toUtf8(), callback);
+        return subscribe(elementStr.toUtf8(), callback, arena);
     }
-    else
-        subscribe((const char*)nullptr, callback);
+    return subscribe((const char*)nullptr, callback, arena);
 }
 
-void JsonReader::Publisher::subscribe(const char* elementUtf8, Callback* callback)
+const JsonReader::KEY* JsonReader::Publisher::subscribe(const char* elementUtf8, Callback* callback, Arena& arena)
 {
     if (!elementUtf8)
     {
+        if (m_callbackAll)
+            m_callbackAll->~Callback();
         m_callbackAll = callback;
-        return;
+        return nullptr;
     }
 
     // Detect whether it's an element's name or path.
@@ -1053,74 +4512,200 @@ void JsonReader::Publisher::subscribe(const char* elementUtf8, Callback* callbac
         }
     }
 
+    CALLBACK_MAP& map = isPath ? m_callbacksPath : m_callbacksName;
+    KEY key = {elementUtf8, length, hash(elementUtf8, length)};
+    CALLBACK_MAP::iterator it = map.find(key);
+    if (it != map.end())
+    {
+        // Replace the previous callback.
+        it->second->~Callback();
+        it->second = callback;
+        return isPath ? &it->first : nullptr;
+    }
+
     // Set the map key as a copy of the element.
-    char* key = new char[length + 1];
-    if (length > 0)
-        memcpy(key, elementUtf8, length);
-    key[length] = 0;
+    key.str = arena.copy(elementUtf8, length);
+    it = map.insert(std::make_pair(key, callback)).first;
+    if (isPath && m_callbacksPath.size() <= MAX_FEW_PATHS)
+        m_fewPaths[m_callbacksPath.size() - 1] = &*it; // The elements of the map are not moved by a rehash.
 
     if (isPath)
-        m_callbacksPath[key] = callback;
+        m_lengthsPath |= 1ull << (length & 63);
     else
-        m_callbacksName[key] = callback;
-
+        m_lengthsName |= 1ull << (length & 63);
     m_numSubscribersByName = m_callbacksName.size();
     m_numSubscribersByPath = m_callbacksPath.size();
+    return isPath ? &it->first : nullptr;
 }
 
 void JsonReader::Publisher::unsubscribe()
 {
+    if (isEmpty())
+        return;
     for (auto item : m_callbacksName)
-    {
-        delete[] item.first;
-        delete item.second;
-    }
+        item.second->~Callback();
     m_callbacksName.clear();
     for (auto item : m_callbacksPath)
-    {
-        delete[] item.first;
-        delete item.second;
-    }
+        item.second->~Callback();
     m_callbacksPath.clear();
     m_numSubscribersByName = m_numSubscribersByPath = 0;
+    m_lengthsName = m_lengthsPath = 0;
+    m_patterns = 0; // Their callbacks are released by the Subscriptions.
     if (m_callbackAll)
     {
-        delete m_callbackAll;
+        m_callbackAll->~Callback();
         m_callbackAll = nullptr;
     }
 }
 
-void JsonReader::Publisher::notify(char* path, size_t namePos, size_t nameLen, size_t pathLen, STR* value)
+#ifdef JSONREADER_STATS
+// The callbacks are executed by 'call', which counts them along with the time they take.
+#define NOTIFY_CALLBACK(callback, value) call(callback, value, stats)
+
+void JsonReader::Publisher::call(Callback* callback, STR* value, STATS& stats)
 {
-    m_name = path + namePos;
-    m_nameLen = nameLen;
+    stats.callbacks++;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    callback->notify(value);
+    stats.callbackSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void JsonReader::Publisher::notify(const char* path, size_t pathLen, uint64_t pathHash, const char* name,
+                                   size_t nameLen, Callback* const* patterns, size_t numPatterns, STR* value,
+                                   STATS& stats) const
+#else
+#define NOTIFY_CALLBACK(callback, value) (callback)->notify(value)
 
+void JsonReader::Publisher::notify(const char* path, size_t pathLen, uint64_t pathHash, const char* name,
+                                   size_t nameLen, Callback* const* patterns, size_t numPatterns, STR* value) const
+#endif
+{
     if (m_numSubscribersByName) // notify by name.
     {
-        // Extract the element's name from the path without copying memory.
-        // This requires the temporary manipulation of the next character after the name.
-        char backupChar = m_name[m_nameLen];
-        m_name[m_nameLen] = 0;
-        notify(&m_callbacksName, m_name, value);
-        m_name[m_nameLen] = backupChar;
+#ifdef JSONREADER_STATS
+        notify(&m_callbacksName, m_lengthsName, name, nameLen, value, stats);
+#else
+        notify(&m_callbacksName, m_lengthsName, name, nameLen, value);
+#endif
     }
 
     if (pathLen > 0 && m_numSubscribersByPath) // notify by path.
-        notify(&m_callbacksPath, path, value);
+    {
+        COUNT_STAT(stats.lookups, (m_lengthsPath >> (pathLen & 63)) & 1); // Unless discarded by the length.
+        const CALLBACK_MAP::value_type* entry = findPath(path, pathLen, pathHash);
+        if (entry && entry->second)
+        {
+            COUNT_STAT(stats.hits, 1);
+            NOTIFY_CALLBACK(entry->second, value);
+        }
+    }
+
+    for (size_t i = 0; i < numPatterns; i++) // notify by pattern.
+        NOTIFY_CALLBACK(patterns[i], value);
 
     if (m_callbackAll) // notify on all elements.
-        m_callbackAll->notify(value);
+        NOTIFY_CALLBACK(m_callbackAll, value);
 }
 
-void JsonReader::Publisher::notify(CALLBACK_MAP* map, char* nameOrPath, STR* value)
+#ifdef JSONREADER_STATS
+void JsonReader::Publisher::notify(const CALLBACK_MAP* map, uint64_t lengths, const char* nameOrPath, size_t len,
+                                   STR* value, STATS& stats) const
+#else
+void JsonReader::Publisher::notify(const CALLBACK_MAP* map, uint64_t lengths, const char* nameOrPath, size_t len,
+                                   STR* value) const
+#endif
 {
-    m_iterator = map->find(nameOrPath);
-    if (m_iterator != map->end())
+    if (!(lengths & (1ull << (len & 63))))
+        return;
+
+    COUNT_STAT(stats.lookups, 1);
+    KEY key = {nameOrPath, len, hash(nameOrPath, len)};
+    CALLBACK_MAP::const_iterator it = map->find(key);
+    if (it != map->end())
     {
-        Callback* callback = m_iterator->second;
+        Callback* callback = it->second;
         if (callback)
-            callback->notify(value);
+        {
+            COUNT_STAT(stats.hits, 1);
+            NOTIFY_CALLBACK(callback, value);
+        }
+    }
+}
+
+void JsonReader::Publisher::flush(const char* path, size_t pathLen, uint64_t pathHash, const char* name,
+                                  size_t nameLen, bool isDiscarded) const
+{
+    Callback* callbacks[3];
+    size_t numCallbacks = find(path, pathLen, pathHash, name, nameLen, callbacks);
+    for (size_t i = 0; i < numCallbacks; i++)
+        callbacks[i]->flush(isDiscarded);
+}
+
+JsonReader::Callback* JsonReader::Publisher::findBatch(const char* path, size_t pathLen, uint64_t pathHash,
+                                                      const char* name, size_t nameLen, bool& hasPending) const
+{
+    Callback* callbacks[3];
+    size_t numCallbacks = find(path, pathLen, pathHash, name, nameLen, callbacks);
+    hasPending = false;
+    for (size_t i = 0; i < numCallbacks; i++)
+        hasPending |= callbacks[i]->hasPending();
+    return (numCallbacks == 1 && callbacks[0]->isBatch()) ? callbacks[0] : nullptr;
+}
+
+size_t JsonReader::Publisher::find(const char* path, size_t pathLen, uint64_t pathHash, const char* name,
+                                   size_t nameLen, Callback* callbacks[3]) const
+{
+    size_t numCallbacks = 0;
+    if (m_numSubscribersByName && (m_lengthsName & (1ull << (nameLen & 63))))
+    {
+        KEY key = {name, nameLen, hash(name, nameLen)};
+        CALLBACK_MAP::const_iterator it = m_callbacksName.find(key);
+        if (it != m_callbacksName.end() && it->second)
+            callbacks[numCallbacks++] = it->second;
+    }
+    if (pathLen > 0 && m_numSubscribersByPath)
+    {
+        const CALLBACK_MAP::value_type* entry = findPath(path, pathLen, pathHash);
+        if (entry && entry->second)
+            callbacks[numCallbacks++] = entry->second;
+    }
+    if (m_callbackAll)
+        callbacks[numCallbacks++] = m_callbackAll;
+    return numCallbacks;
+}
+
+bool JsonReader::Publisher::isSubscribed(const char* path, size_t pathLen, uint64_t pathHash) const
+{
+    return m_numSubscribersByPath && findPath(path, pathLen, pathHash);
+}
+
+const JsonReader::Publisher::CALLBACK_MAP::value_type* JsonReader::Publisher::findPath(const char* path,
+                                                                                      size_t pathLen,
+                                                                                      uint64_t pathHash) const
+{
+    if (!(m_lengthsPath & (1ull << (pathLen & 63))))
+        return nullptr;
+    KEY key = {path, pathLen, pathHash};
+    if (m_numSubscribersByPath <= MAX_FEW_PATHS)
+    {
+        for (size_t i = 0; i < m_numSubscribersByPath; i++)
+        {
+            if (m_fewPaths[i]->first.hash == pathHash && KEY_EQUAL()(m_fewPaths[i]->first, key))
+                return m_fewPaths[i];
+        }
+        return nullptr;
     }
+    CALLBACK_MAP::const_iterator it = m_callbacksPath.find(key);
+    return it != m_callbacksPath.end() ? &*it : nullptr;
 }
 
-void JsonReader::Publisher::getCurrentElementName(STR& elemName) { elemName.copy(m_name, m_nameLen, true, true); }
+uint64_t JsonReader::Publisher::hash(const char* str, size_t len, uint64_t hash)
+{
+    // FNV-1a hash function, the same as 'hashPath' (which is evaluated at compile time instead).
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= static_cast<unsigned char>(str[i]);
+        hash *= HASH_PRIME;
+    }
+    return hash;
+}
@@ -1,20 +1,33 @@
 ﻿#pragma once
 
-#include <codecvt>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <fstream>
 #include <functional>
 #include <locale>
 #include <map>
+#include <memory>
+#include <new>
 #include <queue>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <type_traits>
+#include <unordered_set>
 #include <vector>
 
 #ifdef _MSC_VER
 #define USE_WINAPI
 #endif
 
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#define USE_STRING_VIEW
+#include <string_view>
+#endif
+
 // Reads JSON data and notifies its elements and their values to the client.
 class JsonReader
 {
@@ -39,56 +52,259 @@ class JsonReader
         void Utf8ToMultiByte(const std::string stringUtf8, std::string& stringMB);
         // Encodes a 4-byte Unicode code point into UTF-8.
         const char* CodePointToUtf8(const uint32_t codePoint, size_t& lenOut);
+        // The conversions between UTF-8 and wide strings are made without the deprecated <codecvt> header.
+        // Wide strings are encoded as UTF-16 if 'wchar_t' has 2 bytes (e.g. in Windows) or as UTF-32 otherwise.
+        // Invalid UTF-8 sequences and unpaired surrogates are replaced by the character U+FFFD.
 
       protected:
+        // Allocate the buffers if they cannot hold a string of 'length' characters (plus the null terminator).
+        // Buffers are only allocated when first needed, so that constructing a converter does not allocate memory.
+        void reserveNarrow(size_t length);
+        void reserveWide(size_t length);
+
         char* m_bufferNarrow;  // Holds the last decoded narrow string.
         size_t m_lenMaxNarrow; // Maximum length of the narrow string.
         wchar_t* m_bufferWide; // Holds the last decoded wide string.
         size_t m_lenMaxWide;   // Maximum length of the wide string.
+    };
+
+    // Progress of a read, passed to the callback registered with 'onProgressInfo'.
+    struct PROGRESS_INFO
+    {
+        size_t bytesRead;      // Number of bytes read so far.
+        size_t totalBytes;     // Size of the input.
+        int percentage;        // Percentage of the input read so far.
+        double bytesPerSecond; // Average throughput since the read began.
+        double secondsLeft;    // Estimated time to complete the read, or a negative value if not known yet.
+    };
+
+    // Types of the elements found with a path, combined into the bit mask 'PATH_INFO::types'.
+    enum VALUE_TYPE
+    {
+        TYPE_OBJECT = 1,
+        TYPE_ARRAY = 2,
+        TYPE_STRING = 4,
+        TYPE_NUMBER = 8,
+        TYPE_BOOLEAN = 16,
+        TYPE_NULL = 32
+    };
+    // Occurrences of a path, returned by the versions of 'getPathsFromFile' and 'getPathsFromBuffer' that take a
+    // PATH_INFO_MAP.
+    struct PATH_INFO
+    {
+        size_t count;   // Number of elements found with the path.
+        unsigned types; // Types of those elements (see VALUE_TYPE).
+    };
+    typedef std::map<std::string, PATH_INFO> PATH_INFO_MAP; // The paths are encoded in UTF-8.
+
+    // Value of an array item passed in a batch by 'onArrayItems'.
+    struct ITEM_VALUE
+    {
+        const char* value; // UTF-8 data of a string, number or boolean, not null terminated. NULL for other types.
+        size_t length;     // Length of the data.
+        bool isQuoted;     // True if the item is a string.
+    };
+
+    // Provides the JSON text read by 'readSource' in chunks, e.g. decompressing it on the fly.
+    class Source
+    {
+      public:
+        virtual ~Source(){};
+        // Copies up to 'len' bytes of the text into 'buffer' and returns the number of bytes copied, which is 0 only
+        // once the text ends. Errors are reported by throwing an exception.
+        virtual size_t read(char* buffer, size_t len) = 0;
+        // Return the size of the underlying data (e.g. the compressed data) and the number of its bytes consumed so
+        // far, which the progress is based on. The size is 0 if unknown, and then the progress is not notified.
+        virtual size_t getSize() { return 0; }
+        virtual size_t getConsumed() { return 0; }
+    };
+
+#ifdef JSONREADER_ZLIB
+    // Source that decompresses data in the gzip or zlib format (detected from its header) read from 'input', e.g. an
+    // open std::ifstream. Concatenated gzip members are decompressed one after another. If 'size' is not 0, it is
+    // the number of bytes of compressed data, returned by 'getSize'.
+    class GzipSource : public Source
+    {
+      public:
+        explicit GzipSource(std::istream& input, size_t size = 0);
+        ~GzipSource();
+        GzipSource(const GzipSource&) = delete;
+        GzipSource& operator=(const GzipSource&) = delete;
+        size_t read(char* buffer, size_t len);
+        size_t getSize() { return m_size; }
+        size_t getConsumed() { return m_consumed; }
 
-#ifndef USE_WINAPI
-        // NOTE: The <codecvt> header has been deprecated in C++17.
-        // Used here until a standard replacement is available.
-        std::wstring_convert<std::codecvt_utf8<wchar_t>> m_codecvt;
-        // Auxiliary variables, made member by convenience.
-        std::string m_str;
-        std::wstring m_wstr;
+      protected:
+        std::istream& m_input;
+        void* m_stream;                     // The zlib stream (z_stream), which is only declared by JsonReader.cpp.
+        std::unique_ptr<char[]> m_inBuffer; // Compressed data read from the input and not decompressed yet.
+        size_t m_size;
+        size_t m_consumed;
+        bool m_isMemberEnd; // True if the end of a gzip member has been reached, which may be the end of the data.
+    };
 #endif
+
+#ifdef JSONREADER_ZSTD
+    // Source that decompresses data in the Zstandard format read from 'input'. Concatenated frames are decompressed
+    // one after another. If 'size' is not 0, it is the number of bytes of compressed data, returned by 'getSize'.
+    class ZstdSource : public Source
+    {
+      public:
+        explicit ZstdSource(std::istream& input, size_t size = 0);
+        ~ZstdSource();
+        ZstdSource(const ZstdSource&) = delete;
+        ZstdSource& operator=(const ZstdSource&) = delete;
+        size_t read(char* buffer, size_t len);
+        size_t getSize() { return m_size; }
+        size_t getConsumed() { return m_consumed; }
+
+      protected:
+        std::istream& m_input;
+        void* m_context;                    // The decompression context (ZSTD_DCtx).
+        std::unique_ptr<char[]> m_inBuffer; // Compressed data read from the input.
+        size_t m_inLen;                     // Number of bytes in 'm_inBuffer'.
+        size_t m_inPos;                     // Number of bytes of 'm_inBuffer' already decompressed.
+        size_t m_size;
+        size_t m_consumed;
+        bool m_isFrameEnd; // True if the end of a frame has been reached, which may be the end of the data.
     };
+#endif
+
+#ifdef JSONREADER_STATS
+    // Counters of the work done by a reader, returned by 'getStats' if compiled with JSONREADER_STATS.
+    struct STATS
+    {
+        // Types of event, in the order of the counters in 'events'.
+        enum EVENT_TYPE
+        {
+            OBJECT_BEGIN,
+            OBJECT_END,
+            ARRAY_BEGIN,
+            ARRAY_END,
+            ARRAY_ITEM,
+            PAIR,
+            NUM_EVENT_TYPES
+        };
+        size_t bytesScanned;            // Bytes of input parsed or skipped.
+        size_t separatorBytes;          // Bytes of whitespace, colons and commas skipped between elements.
+        size_t copiedBytes;             // Bytes of names and values copied from the input into internal strings.
+        size_t resizes;                 // Number of times an internal string allocated more memory.
+        size_t events[NUM_EVENT_TYPES]; // Events raised, by type, whether or not a callback was subscribed to them.
+        size_t lookups;                 // Lookups of names and paths in the subscriptions.
+        size_t hits;                    // Lookups that found a subscribed callback.
+        size_t callbacks;               // Callbacks executed (including those subscribed to all elements).
+        size_t convertedBytes;          // Bytes of values converted into wide or multibyte strings.
+        double callbackSeconds;         // Time spent in the callbacks.
+    };
+#endif
 
   protected:
+    // Stores the number being parsed, whose significant digits are accumulated while it is read.
+    // Its value is mantissa * 10^exponent (with the sign 'isNegative').
+    struct NUMBER
+    {
+        void clear()
+        {
+            mantissa = 0;
+            exponent = 0;
+            numDigits = 0;
+            isNegative = false;
+            isInteger = true;
+            isTruncated = false;
+            isValid = true;
+        }
+        // Reads the number at the beginning of 'text', of up to 'len' bytes, and returns the number of bytes read.
+        // These are all the characters that may be part of a number, which is validated according to the JSON
+        // grammar. Its significant digits are accumulated at the same time.
+        size_t parse(const char* text, size_t len);
+        void addDigit(char digit, bool isFraction); // Adds a digit of the integer or fractional part.
+        // Convert the number, returning false if it is out of range. The integer conversion assumes 'isInteger'.
+        // The string 'text' of 'len' bytes is the number as written in the JSON data, used if no exact
+        // conversion is possible from the mantissa and exponent.
+        bool toInt64(int64_t& result) const;
+        bool toDouble(const char* text, size_t len, double& result) const;
+
+        static const int MAX_DIGITS = 19; // Maximum number of significant digits that fit in the mantissa.
+
+        uint64_t mantissa; // Significant digits, without leading zeros.
+        int exponent;      // Decimal exponent.
+        int numDigits;     // Number of digits stored in the mantissa.
+        bool isNegative;   // True if the number has a minus sign.
+        bool isInteger;    // True if the number has neither a fractional part nor an exponent.
+        bool isTruncated;  // True if the number has more significant digits than the mantissa can hold.
+        bool isValid;      // True if the number follows the JSON grammar.
+    };
+
     // Represents a string.
+    // Its content may either be stored internally or refer to the input data, in order to avoid copying strings
+    // without escape sequences when the input is contiguous in memory (a buffer or a mapped file).
     struct STR
     {
         STR();
         STR(const wchar_t* source, bool useLocale = false);
         ~STR() { release(); }
+        STR(const STR&) = delete;
+        STR& operator=(const STR&) = delete;
 
         // Methods
         void resize(size_t newCapacity);     // Allocs more memory for the string.
         void setLength(size_t newLength);    // Sets the current length of the string. It does not allocate memory.
         void clear();                        // Clears the string.
         void release();                      // Frees the memory allocated for the string.
-        const char* toNarrow();              // It may return the string encoded as multibyte or UTF-8.
-        const char* toUtf8() { return str; } // Returns the internal string as UTF-8.
-        const wchar_t* toWide()              // Returns the internal string as a wide character string.
+        const char* toNarrow() // It may return the string encoded as multibyte or UTF-8.
+        {
+            if (length == 0 || isAscii || !useLocale)
+                return toUtf8();
+            return hasNarrow ? narrow : convertToNarrow();
+        }
+        const char* toUtf8() // Returns the internal string as UTF-8.
+        {
+            if (view)
+                detach();
+            return str;
+        }
+        const wchar_t* toWide() { return hasWide ? wide : convertToWide(); } // Returns it as a wide string.
+        // Discards the converted strings, which are kept until the content changes so that a value notified to
+        // several callbacks is converted once.
+        void invalidate()
         {
-            return converter.Utf8ToWide(str, length);
+            hasNarrow = false;
+            hasWide = false;
         }
+        const char* data() { return view ? view : str; } // Returns the content, which is not null terminated.
+        void detach(); // Copies the referenced input data into the internal string.
         void copy(const char* source, size_t sourceLen, // Sets the content of the internal string.
                   bool checkCapacity = false, bool checkEncoding = false);
 
         // Variables
-        char* str;       // The string is internally stored as UTF-8.
-        size_t length;   // Current length of the string.
+        char* str;        // The string is internally stored as UTF-8.
+        const char* view; // Points to the content in the input data if it has not been copied into 'str'.
+        const NUMBER* number; // If the string is a number, points to its value converted while parsing.
+        size_t length;    // Current length of the string.
         size_t capacity; // Number of allocated bytes to store the string.
         bool isAscii;    // True if the string contains ASCII characters exclusively.
         bool isQuoted;   // True if the string was enclosed between quotation marks in the JSON structure.
         bool useLocale;  // If true, the method 'toNarrow()' returns the string as multibyte according to the locale.
 
       private:
-        static const int CAPACITY_DEFAULT = 1024; // Default number of bytes available.
-        TextConverter converter;                  // Used to convert character encodings.
+        static const int CAPACITY_INLINE = 64; // Number of bytes available before allocating memory.
+        char inlineStr[CAPACITY_INLINE];       // Stores short strings, so that most strings never allocate memory.
+        TextConverter converter;               // Used to convert character encodings.
+
+        const char* convertToNarrow();
+        const wchar_t* convertToWide();
+        std::wstring wideStr;  // Holds the last wide conversion, reusing its memory.
+        const char* narrow;    // Last multibyte conversion, valid if 'hasNarrow'.
+        const wchar_t* wide;   // Last wide conversion, valid if 'hasWide'.
+        bool hasNarrow;        // True if 'narrow' holds the current content.
+        bool hasWide;          // True if 'wide' holds the current content.
+
+#ifdef JSONREADER_STATS
+      public:
+        size_t numResizes;     // Number of times more memory has been allocated.
+        size_t copiedBytes;    // Bytes copied by 'copy' and 'detach'.
+        size_t convertedBytes; // Bytes converted to wide or multibyte strings.
+#endif
     };
 
     // Stores the value of the current array item when an array is being parsed.
@@ -109,7 +325,12 @@ class JsonReader
         bool isValue; // True if the value is of type string, number, boolean or null.
     } m_arrayItem;
 
-    // Encapsulates the JSON input source, which can be a file or a buffer.
+    // State kept by the methods 'feed' and 'finish' between the fragments they receive.
+    struct STREAM;
+    // Ring of buffers filled by a thread that reads an input file or source ahead of the parser.
+    struct READ_AHEAD;
+
+    // Encapsulates the JSON input source, which can be a file, a buffer, a stream of fragments or a Source.
     class JsonInput
     {
       public:
@@ -117,8 +338,20 @@ class JsonReader
         virtual ~JsonInput();
 
         // If 'isFile' is true, 'source' is assumed to be the full path of a JSON file.
-        // Otherwise, it's assumed to be a buffer and makes an internal copy.
-        void init(const char* source, bool isFile);
+        // Otherwise, it's assumed to be a buffer of 'sourceLen' bytes, which is accessed directly.
+        void init(const char* source, size_t sourceLen, bool isFile);
+        // If 'useMapping' is true, input files are mapped into memory instead of being read in chunks.
+        void setMemoryMapping(bool useMapping) { m_useMapping = useMapping; }
+        bool getMemoryMapping() const { return m_useMapping; }
+        // Sets the size of the blocks in which input files are read and the number of buffers that hold them. If there
+        // are several buffers, the blocks are read ahead by a background thread.
+        void setFileBuffers(size_t bufferLen, unsigned numBuffers);
+        // If 'stream' is not null, the input is the text received by 'feed' and not parsed yet. If it is consumed
+        // before 'finish' is called, a FRAGMENT_END is thrown. The source passed to 'init' is then ignored.
+        void setStream(STREAM* stream) { m_stream = stream; }
+        // If 'source' is not null, the input is read from it in blocks, as a file. The source passed to 'init' is
+        // then ignored.
+        void setSource(Source* source) { m_source = source; }
         // Releases the internal buffer and closes the file if open.
         void clear();
 
@@ -130,21 +363,62 @@ class JsonReader
         char getNextChar(bool verbatim = false);
         // Returns the current character read.
         char getCurrentChar() { return m_buffer[m_idx]; };
+        // Appends the characters of the current string to 'text' up to the next quotation mark or backslash,
+        // which is returned. The characters are scanned and copied in blocks.
+        char readStringChars(STR& text);
+        // Same as 'readStringChars', but if the quotation mark is found first, 'text' refers to the input data
+        // instead of copying it. Requires a contiguous input.
+        char readStringView(STR& text);
+        // Returns a pointer to the current character.
+        const char* getCurrentPtr() { return m_buffer + m_idx; }
+        // Returns the number of bytes available in the buffer from the current character.
+        size_t getRemainingLength() { return m_bufferLen - m_idx; }
+        // Moves the buffer's index 'numChars' positions forward, which must be available in the buffer.
+        void moveForward(size_t numChars) { m_idx += numChars; }
+        // Moves the buffer's index to the absolute 'position', which must be available in the buffer.
+        void moveTo(size_t position) { m_idx = position - m_bufferPosition; }
+        // Returns the character at the absolute 'position', or 0 if it is not available in the buffer.
+        char getCharAt(size_t position)
+        {
+            return (position >= m_bufferPosition && position - m_bufferPosition < m_bufferLen)
+                       ? m_buffer[position - m_bufferPosition]
+                       : 0;
+        }
+        // Return the whole input and its length, if it is contiguous in memory.
+        const char* getData() { return m_buffer; }
+        size_t getLength() { return m_maxLen; }
+        // Returns true if the whole input is contiguous in memory (a buffer or a mapped file), so pointers to
+        // its data remain valid until the input is cleared.
+        bool isContiguous() { return !isFileOpen() && !m_stream && !m_source; }
         // Called when an escape sequence is found.
         void readEscapeSequence(STR& text);
         // Moves the buffer's index one position back.
         void goToPreviousChar();
         // Moves the buffer's index forward until a quotation mark is found.
         void goToNextQuote();
+        // Moves the buffer's index to the last character of the current value (string, number, object...), which
+        // is skipped without being parsed. Only quotation marks and brackets are taken into account.
+        void skipValue();
         // Returns true if no more data can be read from the source.
         bool isEOF() { return m_isEOF; }
-        // Returns the current absolute position in the input source.
-        size_t getPosition() { return m_position; }
+        // Returns the current absolute position in the input source, which is the number of bytes read so far.
+        // It is derived from the index, so that reading a character does not have to update it.
+        size_t getPosition() { return m_bufferPosition + m_idx + (m_isEOF ? 0 : 1); }
+        // Sets the absolute position of the beginning of the input, if it is part of a larger one.
+        void setPosition(size_t position) { m_bufferPosition = position; }
+#ifdef JSONREADER_STATS
+        // Adds the counters of the input to 'stats', or resets them.
+        void addStats(STATS& stats) const;
+        void resetStats();
+#endif
 
         // Methods related to progress notification.
 
         // Sets the progress increment and the callback to be notified.
-        void setProgressParams(int step, std::function<void(int)> progressCallback);
+        void setProgressParams(int step, std::function<void(const PROGRESS_INFO&)> progressCallback);
+        // Returns the position from which the progress is notified again. If the input is read from a Source, it is
+        // not known, since the progress is based on the data consumed by the source.
+        size_t getNextProgress() { return m_source ? SIZE_MAX : m_progressNext; }
         // Returns the progress as the percentage of the number of bytes read so far.
         double getProgress();
         // Notifies the progress when it goes beyond the increment.
@@ -154,9 +428,30 @@ class JsonReader
 
       protected:
         bool openFile(const char* fileFullPath);
-        bool setBuffer(const char* buffer);
-        void fillBuffer();
+        bool mapFile(const char* fileFullPath);
+        void unmapFile();
+        bool setBuffer(const char* buffer, size_t bufferLen);
+        // Reads the next block of data. 'isInString' is true if a string is being read (see FRAGMENT_END).
+        void fillBuffer(bool isInString = false);
+        void readFirstBlock(); // Allocates the buffers of a file or source, and reads its first block into them.
+        // Reads the next block of a file or source into 'buffer', and stores in 'consumed' the number of bytes of the
+        // source consumed so far. Returns the number of bytes read, which is 0 at the end.
+        size_t readBlock(char* buffer, size_t& consumed);
+        // Opens a file compressed in a format whose magic number is found at its beginning, returning false if it
+        // is not compressed. The file is then decompressed by a Source.
+        bool openCompressedFile();
+        // Returns the position the progress is based on: the number of bytes read so far, or the number of bytes
+        // consumed by a Source.
+        size_t getProgressPosition() { return m_source ? m_sourceConsumed : getPosition(); }
+        void startReadAhead(); // Starts the thread that reads the open file ahead of the parser.
+        void stopReadAhead();  // Stops the thread, once the parser does not need any more data.
+        bool isReadingAhead();
+        void goToNextChar(bool isInString = false);
+        void skipString();
+        // Reads the code point of a '\u' escape sequence, combining the two escaped halves of a surrogate pair.
         void getEscapedCodePoint(STR& text);
+        uint32_t readCodeUnit(); // Reads the 4 hexadecimal digits of a '\u' escape sequence.
+        void appendCodePoint(STR& text, uint32_t codePoint); // Appends the code point encoded as UTF-8.
         char charToHex(char input);
 
       protected:
@@ -164,19 +459,60 @@ class JsonReader
         size_t m_bufferLen;        // Number of bytes available in the buffer.
         size_t m_maxLen;           // Total number of bytes to read from the input source.
         size_t m_idx;              // Index of the current character in the buffer.
-        size_t m_position;         // Absolute character position of the input data.
-        std::ifstream m_file;      // The input file, in case we are reading from a file.
+        size_t m_bufferPosition;   // Absolute position of the beginning of the buffer in the input data.
+        // The input file, in case we are reading from a file. It's created by the first file read and kept.
+        std::unique_ptr<std::ifstream> m_file;
+        bool isFileOpen() { return m_file && m_file->is_open(); }
         bool m_isEOF;              // True when the end has been reached.
-        TextConverter m_converter; // Used to decode Unicode code points.
+        bool m_useMapping;         // If true, input files are mapped into memory.
+        bool m_isMapped;           // True if 'm_buffer' points to a file mapped into memory.
+        STREAM* m_stream;          // If not null, the input is received in fragments.
+        size_t m_fileBufferLen;    // Size of the blocks in which files are read.
+        unsigned m_numFileBuffers; // Number of buffers to read files into. If more than one, they are read ahead.
+        std::unique_ptr<READ_AHEAD> m_readAhead; // Created by the first file read ahead and kept.
+        Source* m_source;                        // If not null, the input is read from it.
+        std::unique_ptr<Source> m_ownedSource;   // Source that decompresses the file being read, if compressed.
+        size_t m_sourceConsumed; // Bytes consumed by the source when the current block was read.
+#ifdef USE_WINAPI
+        void* m_fileHandle;    // Handle of the mapped file.
+        void* m_mappingHandle; // Handle of the file mapping object.
+#endif
 
         // Used to notify the progress.
-        int m_progressStep;                          // Increment of the percentage.
-        size_t m_progressNext;                       // Next progress threshold to be notified.
-        std::function<void(int)> m_progressCallback; // Callback to notify the progress.
+        int m_progressStep;                                           // Increment of the percentage.
+        size_t m_progressNext;                                        // Next progress threshold to be notified.
+        std::function<void(const PROGRESS_INFO&)> m_progressCallback; // Callback to notify the progress.
+        std::chrono::steady_clock::time_point m_progressStart;        // Time when the read began.
+
+#ifdef JSONREADER_STATS
+        size_t m_separatorBytes; // Bytes skipped between elements.
+        size_t m_copiedBytes;    // Bytes of strings copied into a STR.
+#endif
     };
 
+    // Convert a value into the number passed to the typed callbacks and the bound members, returning false if it is
+    // not notified. An error is raised if the value is not a number or if it cannot be converted.
+    static bool toInt64(STR* value, int64_t& result);
+    static bool toDouble(STR* value, double& result);
+    // Convert a value into a member of a bound struct, raising an error if it is not of the member's type.
+    static void assign(std::string& member, STR* value); // UTF-8 string.
+    static void assign(std::wstring& member, STR* value);
+    static void assign(bool& member, STR* value);
+    static void assign(double& member, STR* value);
+    static void assign(float& member, STR* value);
+    template <class M> static typename std::enable_if<std::is_integral<M>::value>::type assign(M& member, STR* value)
+    {
+        int64_t result;
+        if (!toInt64(value, result))
+            return;
+        if ((int64_t)(M)result != result || (result < 0 && (M)result > 0))
+            throwError(ERROR_OUT_OF_RANGE, value->toUtf8());
+        member = (M)result;
+    }
+
     // Wrappers of the client's callback target (function, lambda expression, etc.) that will receive the events.
-    // A specialized class is used depending on the number of arguments sent.
+    // A specialized class is used depending on the arguments sent. The target of type FUNC is stored as is, which
+    // avoids wrapping a lambda expression into a 'std::function'. The events still reach it through a virtual call.
     // -> Callback's base class.
     class Callback
     {
@@ -184,59 +520,307 @@ class JsonReader
         Callback(){};
         virtual ~Callback(){};
         virtual void notify(STR* value) = 0; // Executes a client's callback, optionally passing one string.
+        // Called when an array ends, passes the pending items of a batch to the client's callback, or drops them if
+        // 'isDiscarded' is true (the read failed). Only the callbacks that receive batches do something.
+        virtual void flush(bool) {}
+        virtual bool isBatch() const { return false; }    // Returns true if the callback receives batches.
+        virtual bool hasPending() const { return false; } // Returns true if a batch holds items not passed yet.
     };
     // -> Callback without arguments.
-    class Callback0 : public Callback
+    template <class FUNC> class Callback0 : public Callback
     {
       public:
-        Callback0(std::function<void()>& callback) { m_func = callback; }
+        Callback0(FUNC&& callback) : m_func(std::move(callback)) {}
         void notify(STR*) { m_func(); }
 
       protected:
-        std::function<void()> m_func;
+        FUNC m_func;
+    };
+    // -> Callback receiving one string, as a narrow string (multibyte or UTF-8) if CHAR is char or as a wide string if
+    // it is wchar_t.
+    template <class FUNC, class CHAR> class Callback1 : public Callback
+    {
+      public:
+        Callback1(FUNC&& callback) : m_func(std::move(callback)) {}
+        void notify(STR* value) { m_func(value ? toString(value, (CHAR*)nullptr) : nullptr); }
+
+      protected:
+        static const char* toString(STR* value, char*) { return value->toNarrow(); }
+        static const wchar_t* toString(STR* value, wchar_t*) { return value->toWide(); }
+        FUNC m_func;
+    };
+    // -> Callback receiving one UTF-8 string as a pointer and a length.
+    template <class FUNC> class Callback2 : public Callback
+    {
+      public:
+        Callback2(FUNC&& callback) : m_func(std::move(callback)) {}
+        void notify(STR* value)
+        {
+            if (value)
+                m_func(value->data(), value->length);
+            else
+                m_func(nullptr, 0);
+        }
+
+      protected:
+        FUNC m_func;
+    };
+    // -> Callbacks receiving a number, which are not notified about null values, objects and arrays.
+    // Other values than numbers raise an error, as well as numbers that cannot be converted.
+    template <class FUNC> class CallbackInt64 : public Callback
+    {
+      public:
+        CallbackInt64(FUNC&& callback) : m_func(std::move(callback)) {}
+        void notify(STR* value)
+        {
+            int64_t result;
+            if (toInt64(value, result))
+                m_func(result);
+        }
+
+      protected:
+        FUNC m_func;
+    };
+    template <class FUNC> class CallbackDouble : public Callback
+    {
+      public:
+        CallbackDouble(FUNC&& callback) : m_func(std::move(callback)) {}
+        void notify(STR* value)
+        {
+            double result;
+            if (toDouble(value, result))
+                m_func(result);
+        }
+
+      protected:
+        FUNC m_func;
     };
-    // -> Callback receiving one string.
-    class Callback1 : public Callback
+    // -> Callback receiving the items of an array in batches of up to 'batchSize' values (see 'onArrayItems').
+    // The values that do not refer to the input are copied into a buffer, which is passed before it must grow, so
+    // that the pointers to the values it holds remain valid.
+    class CallbackItems : public Callback
     {
       public:
-        Callback1(std::function<void(const char*)>& callback);
-        Callback1(std::function<void(const wchar_t*)>& callback);
+        CallbackItems(std::function<void(const ITEM_VALUE*, size_t)>&& callback, size_t batchSize);
         void notify(STR* value);
+        void flush(bool isDiscarded);
+        bool isBatch() const { return true; }
+        bool hasPending() const { return !m_items.empty(); }
 
       protected:
-        bool m_narrow; // True if the string is to be sent as a narrow string (multibyte or UTF-8).
-        std::function<void(const char*)> m_funcNarrow;  // The argument is passed as a narrow string.
-        std::function<void(const wchar_t*)> m_funcWide; // The argument is passed as a wide string.
+        std::function<void(const ITEM_VALUE*, size_t)> m_func;
+        std::vector<ITEM_VALUE> m_items; // Items pending.
+        std::vector<char> m_data;        // Copies of the values of the items pending.
+        size_t m_batchSize;
     };
+    // -> Callbacks receiving the items of an array as numbers in batches of up to 'batchSize' values, which are
+    // converted as they are parsed. Null values are skipped, and other values than numbers raise an error.
+    template <class T> class CallbackNumbers : public Callback
+    {
+      public:
+        CallbackNumbers(std::function<void(const T*, size_t)>&& callback, size_t batchSize)
+            : m_func(std::move(callback)), m_batchSize(batchSize)
+        {
+            m_values.reserve(batchSize);
+        }
+        void notify(STR* value)
+        {
+            T result;
+            if (toNumber(value, result))
+            {
+                m_values.push_back(result);
+                if (m_values.size() >= m_batchSize)
+                    flush(false);
+            }
+        }
+        void flush(bool isDiscarded)
+        {
+            if (!m_values.empty() && !isDiscarded)
+                m_func(m_values.data(), m_values.size());
+            m_values.clear();
+        }
+        bool isBatch() const { return true; }
+        bool hasPending() const { return !m_values.empty(); }
 
-    // Notifies the client about one type of event (new object found, new array found, etc.).
-    class Publisher
+      protected:
+        static bool toNumber(STR* value, int64_t& result) { return toInt64(value, result); }
+        static bool toNumber(STR* value, double& result) { return toDouble(value, result); }
+        std::function<void(const T*, size_t)> m_func;
+        std::vector<T> m_values; // Values pending.
+        size_t m_batchSize;
+    };
+
+    // Traits to choose the wrapper of a callback target receiving the value of an array item or a pair, depending on
+    // the arguments of the target. The signature is only deduced for functions and for objects with a single
+    // (non-template) call operator, such as lambda expressions.
+    template <class FUNC, class = void> struct CALLBACK_TRAITS
+    {
+    };
+    template <class RESULT, class... ARGS> struct CALLBACK_TRAITS<RESULT (*)(ARGS...), void>
+    {
+        typedef void SIGNATURE(ARGS...);
+    };
+    template <class OPERATOR> struct CALL_OPERATOR_TRAITS
+    {
+    };
+    template <class CLASS, class RESULT, class... ARGS> struct CALL_OPERATOR_TRAITS<RESULT (CLASS::*)(ARGS...)>
+    {
+        typedef void SIGNATURE(ARGS...);
+    };
+    template <class CLASS, class RESULT, class... ARGS> struct CALL_OPERATOR_TRAITS<RESULT (CLASS::*)(ARGS...) const>
+    {
+        typedef void SIGNATURE(ARGS...);
+    };
+    template <class FUNC>
+    struct CALLBACK_TRAITS<FUNC, decltype((void)&FUNC::operator())> : CALL_OPERATOR_TRAITS<decltype(&FUNC::operator())>
+    {
+    };
+    template <class SIGNATURE, class FUNC> struct VALUE_CALLBACK
+    {
+    };
+    template <class FUNC> struct VALUE_CALLBACK<void(const char*), FUNC>
+    {
+        typedef Callback1<FUNC, char> TYPE;
+    };
+    template <class FUNC> struct VALUE_CALLBACK<void(const wchar_t*), FUNC>
+    {
+        typedef Callback1<FUNC, wchar_t> TYPE;
+    };
+    template <class FUNC> struct VALUE_CALLBACK<void(const char*, size_t), FUNC>
+    {
+        typedef Callback2<FUNC> TYPE;
+    };
+
+    // Key of the hash tables of elements: the name or path of an element, which does not need to be null terminated.
+    struct KEY
+    {
+        const char* str;
+        size_t len;
+        uint64_t hash;
+    };
+    struct KEY_HASH
+    {
+        size_t operator()(const KEY& key) const { return (size_t)key.hash; }
+    };
+    struct KEY_EQUAL
     {
-        struct comparer
+        bool operator()(const KEY& key1, const KEY& key2) const
         {
-            bool operator()(char const* str1, char const* str2) const { return std::strcmp(str1, str2) < 0; }
+            return key1.len == key2.len && memcmp(key1.str, key2.str, key1.len) == 0;
+        }
+    };
+    typedef std::unordered_set<KEY, KEY_HASH, KEY_EQUAL> KEY_SET;
+
+    // Allocates memory for objects that live as long as a set of subscriptions (callbacks and keys), which are
+    // stored one after another in blocks. The memory is only released as a whole, and the blocks are kept when the
+    // arena is reset, so that subscribing again after clearing a set does not allocate memory.
+    class Arena
+    {
+      public:
+        Arena();
+        ~Arena();
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        // Returns 'size' bytes of memory aligned to 'alignment', which must not exceed that of 'std::max_align_t'.
+        void* allocate(size_t size, size_t alignment);
+        // Constructs an object in the arena. It must be destroyed by calling its destructor explicitly.
+        template <class T, class... ARGS> T* create(ARGS&&... args)
+        {
+            return new (allocate(sizeof(T), alignof(T))) T(std::forward<ARGS>(args)...);
+        }
+        // Returns a null terminated copy of the string 'str' of 'len' bytes.
+        char* copy(const char* str, size_t len);
+        // Makes all the memory available again, keeping the blocks.
+        void reset();
+
+      protected:
+        struct BLOCK
+        {
+            BLOCK* next;
+            size_t size; // Size of the block, including this header.
         };
+        static const size_t BLOCK_SIZE = 4096; // Default size of the blocks.
 
-        // Map used to retrieve the callback to notify when a specified element is found.
+        BLOCK* m_first;   // First block of the list.
+        BLOCK* m_current; // Block where the memory is being allocated.
+        size_t m_offset;  // Offset of the first free byte in the current block.
+    };
+
+    // Notifies the client about one type of event (new object found, new array found, etc.).
+    class Publisher
+    {
+        // Hash table used to retrieve the callback to notify when a specified element is found.
         // The key is the name or path of the element.
-        typedef std::map<const char*, Callback*, comparer> CALLBACK_MAP;
+        typedef std::unordered_map<KEY, Callback*, KEY_HASH, KEY_EQUAL> CALLBACK_MAP;
 
       public:
         Publisher();
 
         // Subscribes a callback to one type of event related to a specific element.
-        void subscribe(const wchar_t* element, Callback* callback);
-        void subscribe(const char* elementUtf8, Callback* callback);
-        // Unsubscribes all callbacks related to one event type.
+        // The callback must have been created in 'arena', where the key is copied as well.
+        // If the element is a path, returns the key that stores it. Otherwise returns NULL.
+        const KEY* subscribe(const wchar_t* element, Callback* callback, Arena& arena);
+        const KEY* subscribe(const char* elementUtf8, Callback* callback, Arena& arena);
+        // Unsubscribes all callbacks related to one event type. Their memory is released along with their arena.
         void unsubscribe();
+        // Returns true if no callback is subscribed.
+        bool isEmpty() const
+        {
+            return m_callbacksName.empty() && m_callbacksPath.empty() && !m_callbackAll && !m_patterns;
+        }
         // Looks for any callbacks associated to the name or path of the current element.
-        void notify(char* path, size_t namePos, size_t nameLen, size_t pathLen, STR* value = nullptr);
-        // Returns the name of the current element.
-        void getCurrentElementName(STR& elemName);
+        // The argument 'pathHash' is the hash value of the path, which is computed as the path is built.
+        // The arguments 'patterns' and 'numPatterns' are the callbacks of the patterns matching the element, in the
+        // order they were subscribed, which the reader finds.
+#ifdef JSONREADER_STATS
+        // The lookups and the callbacks executed are counted in 'stats'.
+        void notify(const char* path, size_t pathLen, uint64_t pathHash, const char* name, size_t nameLen,
+                    Callback* const* patterns, size_t numPatterns, STR* value, STATS& stats) const;
+#else
+        void notify(const char* path, size_t pathLen, uint64_t pathHash, const char* name, size_t nameLen,
+                    Callback* const* patterns, size_t numPatterns, STR* value) const;
+#endif
+        // Flushes the callbacks associated to the element, with the same arguments as 'notify' (see Callback::flush).
+        void flush(const char* path, size_t pathLen, uint64_t pathHash, const char* name, size_t nameLen,
+                   bool isDiscarded) const;
+        // Returns the callback associated to the element if it is the only one and it receives batches, or NULL.
+        // The argument 'hasPending' returns true if any callback associated to the element holds items not passed yet.
+        Callback* findBatch(const char* path, size_t pathLen, uint64_t pathHash, const char* name, size_t nameLen,
+                            bool& hasPending) const;
+        // Returns true if a callback is subscribed to the element with path 'path' of 'pathLen' bytes.
+        bool isSubscribed(const char* path, size_t pathLen, uint64_t pathHash) const;
+        // Returns true if any callback is subscribed by path.
+        bool hasPaths() const { return m_numSubscribersByPath > 0; }
+        // Returns the bit mask of the patterns subscribed to the event type, by their index in the Subscriptions.
+        uint64_t getPatterns() const { return m_patterns; }
+        // Adds the pattern of index 'index', whose callback is kept by the Subscriptions.
+        void addPattern(size_t index) { m_patterns |= 1ull << index; }
+        // Returns the hash value of a string. The hash of a string appended to another one is obtained passing the
+        // hash of the latter as 'hash'.
+        static uint64_t hash(const char* str, size_t len, uint64_t hash = HASH_SEED);
+
+        // Parameters of the hash function (FNV-1a).
+        static const uint64_t HASH_SEED = 14695981039346656037ull;
+        static const uint64_t HASH_PRIME = 1099511628211ull;
 
       protected:
         // Finds a callback associated to the element described by 'nameOrPath' and, if found, calls it passing 'value'.
-        void notify(CALLBACK_MAP* map, char* nameOrPath, STR* value);
+        // The argument 'lengths' is the bit mask of the key lengths stored in 'map'.
+#ifdef JSONREADER_STATS
+        void notify(const CALLBACK_MAP* map, uint64_t lengths, const char* nameOrPath, size_t len, STR* value,
+                    STATS& stats) const;
+        // Executes 'callback', counting it and the time it takes.
+        static void call(Callback* callback, STR* value, STATS& stats);
+#else
+        void notify(const CALLBACK_MAP* map, uint64_t lengths, const char* nameOrPath, size_t len, STR* value) const;
+#endif
+        // Stores in 'callbacks' those associated to the element (by name, by path and to all elements), with the same
+        // arguments as 'notify', and returns their number.
+        size_t find(const char* path, size_t pathLen, uint64_t pathHash, const char* name, size_t nameLen,
+                    Callback* callbacks[3]) const;
+        // Returns the entry of 'm_callbacksPath' whose key is 'path' of 'pathLen' bytes, or NULL if not found.
+        const CALLBACK_MAP::value_type* findPath(const char* path, size_t pathLen, uint64_t pathHash) const;
 
       protected:
         CALLBACK_MAP m_callbacksName; // Callbacks associated to element names.
@@ -246,13 +830,403 @@ class JsonReader
         size_t m_numSubscribersByName; // Number of callbacks subscribed using the element's name.
         size_t m_numSubscribersByPath; // Number of callbacks subscribed using the element's path.
 
-        char* m_name;     // Name of the current element being notified.
-        size_t m_nameLen; // Length of the name of the current element being notified.
+        // Bit masks where bit N is set if a key has a length of N (modulo 64).
+        // They allow to discard most lookups of elements without subscribers before hashing.
+        uint64_t m_lengthsName;
+        uint64_t m_lengthsPath;
+
+        uint64_t m_patterns; // Bit mask of the patterns subscribed to the event type (see 'getPatterns').
+
+        // Entries of 'm_callbacksPath' while there are few of them, as with a fixed set of paths to extract. They are
+        // looked up by comparing their hash values one after another, which is faster than using the hash table.
+        static const size_t MAX_FEW_PATHS = 8;
+        const CALLBACK_MAP::value_type* m_fewPaths[MAX_FEW_PATHS];
+    };
+
+    // Receives the events of the objects bound to a struct (see 'bind').
+    class Binder
+    {
+      public:
+        virtual ~Binder(){};
+        virtual void begin() = 0;                                           // A bound object begins.
+        virtual void set(const char* name, size_t nameLen, STR* value) = 0; // A pair of the bound object is found.
+        virtual void end() = 0;                                             // The bound object ends.
+    };
+
+  public:
+    // Members of a struct that JSON objects are bound to, each one associated to the name of a pair.
+    // -> Base class, which finds the members by name through a perfect hash table: the table is rebuilt whenever a
+    // name is added, looking for a seed of the hash function with which no names collide. Each lookup then hashes
+    // the name once and compares it with at most one member.
+    class BindingBase
+    {
+      public:
+        // Returns the index of the member associated to 'name' of 'nameLen' bytes (UTF-8), or -1 if there is none.
+        int find(const char* name, size_t nameLen) const;
+
+      protected:
+        BindingBase();
+        // Adds a name unless it exists, and returns its index.
+        size_t addName(const char* nameUtf8);
+
+        std::vector<std::string> m_names; // Names by index.
+        std::vector<int> m_table;         // Index of the name found at each position of the table (-1 if none).
+        uint64_t m_seed;                  // Seed of the hash function.
+        size_t m_mask;                    // Size of the table (a power of 2) minus 1.
+    };
+    // -> Members of the struct T, e.g.: binding.field("name", &USER::name).field("id", &USER::id);
+    // A binding can be used by several readers at the same time, as long as it is not modified.
+    template <class T> class Binding : public BindingBase
+    {
+      public:
+        // Associates 'member' to the pairs named 'nameUtf8', replacing the previous member if any. The values are
+        // converted to the type of the member: std::string (UTF-8), std::wstring, bool, an integer or a floating
+        // point type. Null values are ignored, and values of other types raise an error, as do numbers out of range.
+        template <class M> Binding& field(const char* nameUtf8, M T::*member)
+        {
+            size_t index = addName(nameUtf8);
+            if (index == m_fields.size())
+                m_fields.push_back(std::unique_ptr<FIELD>());
+            m_fields[index].reset(new MEMBER<M>(member));
+            return *this;
+        }
+        // Sets the member associated to 'name' of 'nameLen' bytes, if any.
+        void set(T& object, const char* name, size_t nameLen, STR* value) const
+        {
+            int index = find(name, nameLen);
+            if (index >= 0 && value)
+                m_fields[index]->set(object, value);
+        }
+
+      protected:
+        struct FIELD
+        {
+            virtual ~FIELD(){};
+            virtual void set(T& object, STR* value) const = 0;
+        };
+        template <class M> struct MEMBER : public FIELD
+        {
+            MEMBER(M T::*member) : member(member) {}
+            void set(T& object, STR* value) const { assign(object.*member, value); }
+            M T::*member;
+        };
+        std::vector<std::unique_ptr<FIELD>> m_fields; // Members by the index of their names.
+    };
+
+  protected:
+    // -> Binder that appends the objects to a vector, where they are filled in place.
+    template <class T> class BoundItems : public Binder
+    {
+      public:
+        BoundItems(const Binding<T>& binding, std::vector<T>& items) : m_binding(binding), m_items(items) {}
+        void begin() { m_items.emplace_back(); }
+        void set(const char* name, size_t nameLen, STR* value) { m_binding.set(m_items.back(), name, nameLen, value); }
+        void end() {}
 
-        CALLBACK_MAP::iterator m_iterator; // Auxiliary variable made member for convenience.
+      protected:
+        const Binding<T>& m_binding;
+        std::vector<T>& m_items;
+    };
+    // -> Binder that passes each object to a callback once it is complete.
+    template <class T, class FUNC> class BoundObject : public Binder
+    {
+      public:
+        BoundObject(const Binding<T>& binding, FUNC&& callback) : m_binding(binding), m_func(std::move(callback)) {}
+        void begin() { m_object = T(); }
+        void set(const char* name, size_t nameLen, STR* value) { m_binding.set(m_object, name, nameLen, value); }
+        void end() { m_func(m_object); }
+
+      protected:
+        const Binding<T>& m_binding;
+        FUNC m_func;
+        T m_object;
     };
 
   public:
+    // Set of callbacks subscribed to the events of the JSON elements.
+    // Each reader owns a set, which is filled by its 'on...' methods and cleared when a read finishes.
+    // Instead, a Subscriptions object can be filled once and bound to a reader by calling 'useSubscriptions', so its
+    // callbacks are reused by every read without subscribing them again (and without allocating memory).
+    // The same object can be bound to several readers, as long as it is not modified while they are reading.
+    class Subscriptions
+    {
+      public:
+        Subscriptions();
+        ~Subscriptions() { clear(); }
+        Subscriptions(const Subscriptions&) = delete;
+        Subscriptions& operator=(const Subscriptions&) = delete;
+
+        // Methods to subscribe to event types, identical to the JsonReader's 'on...' methods (see below).
+        void onObjectBegin(const wchar_t* element, std::function<void()> callback);
+        void onObjectEnd(const wchar_t* element, std::function<void()> callback);
+        void onArrayBegin(const wchar_t* element, std::function<void()> callback);
+        void onArrayEnd(const wchar_t* element, std::function<void()> callback);
+        void onArrayItem(const wchar_t* element, std::function<void(const char*)> callback);
+        void onArrayItem(const wchar_t* element, std::function<void(const wchar_t*)> callback);
+        void onPair(const wchar_t* element, std::function<void(const char*)> callback);
+        void onPair(const wchar_t* element, std::function<void(const wchar_t*)> callback);
+        void onArrayItem(const wchar_t* element, std::function<void(const char*, size_t)> callback);
+        void onPair(const wchar_t* element, std::function<void(const char*, size_t)> callback);
+        void onArrayItemInt64(const wchar_t* element, std::function<void(int64_t)> callback);
+        void onArrayItemDouble(const wchar_t* element, std::function<void(double)> callback);
+        void onPairInt64(const wchar_t* element, std::function<void(int64_t)> callback);
+        void onPairDouble(const wchar_t* element, std::function<void(double)> callback);
+        void onArrayItems(const wchar_t* element, std::function<void(const ITEM_VALUE*, size_t)> callback,
+                          size_t batchSize = 0);
+        void onArrayItemsInt64(const wchar_t* element, std::function<void(const int64_t*, size_t)> callback,
+                               size_t batchSize = 0);
+        void onArrayItemsDouble(const wchar_t* element, std::function<void(const double*, size_t)> callback,
+                                size_t batchSize = 0);
+        void onObjectBegin(const char* elementUtf8, std::function<void()> callback);
+        void onObjectEnd(const char* elementUtf8, std::function<void()> callback);
+        void onArrayBegin(const char* elementUtf8, std::function<void()> callback);
+        void onArrayEnd(const char* elementUtf8, std::function<void()> callback);
+        void onArrayItem(const char* elementUtf8, std::function<void(const char*)> callback);
+        void onArrayItem(const char* elementUtf8, std::function<void(const wchar_t*)> callback);
+        void onPair(const char* elementUtf8, std::function<void(const char*)> callback);
+        void onPair(const char* elementUtf8, std::function<void(const wchar_t*)> callback);
+        void onArrayItem(const char* elementUtf8, std::function<void(const char*, size_t)> callback);
+        void onPair(const char* elementUtf8, std::function<void(const char*, size_t)> callback);
+        void onArrayItemInt64(const char* elementUtf8, std::function<void(int64_t)> callback);
+        void onArrayItemDouble(const char* elementUtf8, std::function<void(double)> callback);
+        void onPairInt64(const char* elementUtf8, std::function<void(int64_t)> callback);
+        void onPairDouble(const char* elementUtf8, std::function<void(double)> callback);
+        void onArrayItems(const char* elementUtf8, std::function<void(const ITEM_VALUE*, size_t)> callback,
+                          size_t batchSize = 0);
+        void onArrayItemsInt64(const char* elementUtf8, std::function<void(const int64_t*, size_t)> callback,
+                               size_t batchSize = 0);
+        void onArrayItemsDouble(const char* elementUtf8, std::function<void(const double*, size_t)> callback,
+                                size_t batchSize = 0);
+        // Template versions, which store the callback target as is (see the JsonReader's 'on...' methods).
+        template <class CHAR, class FUNC> void onObjectBegin(const CHAR* element, FUNC callback)
+        {
+            subscribe(m_onObjectBegin, element, m_arena.create<Callback0<FUNC>>(std::move(callback)));
+        }
+        template <class CHAR, class FUNC> void onObjectEnd(const CHAR* element, FUNC callback)
+        {
+            subscribe(m_onObjectEnd, element, m_arena.create<Callback0<FUNC>>(std::move(callback)));
+        }
+        template <class CHAR, class FUNC> void onArrayBegin(const CHAR* element, FUNC callback)
+        {
+            subscribe(m_onArrayBegin, element, m_arena.create<Callback0<FUNC>>(std::move(callback)));
+        }
+        template <class CHAR, class FUNC> void onArrayEnd(const CHAR* element, FUNC callback)
+        {
+            subscribe(m_onArrayEnd, element, m_arena.create<Callback0<FUNC>>(std::move(callback)));
+        }
+        template <class CHAR, class FUNC,
+                  class TYPE = typename VALUE_CALLBACK<typename CALLBACK_TRAITS<FUNC>::SIGNATURE, FUNC>::TYPE>
+        void onArrayItem(const CHAR* element, FUNC callback)
+        {
+            subscribe(m_onArrayItem, element, m_arena.create<TYPE>(std::move(callback)));
+        }
+        template <class CHAR, class FUNC,
+                  class TYPE = typename VALUE_CALLBACK<typename CALLBACK_TRAITS<FUNC>::SIGNATURE, FUNC>::TYPE>
+        void onPair(const CHAR* element, FUNC callback)
+        {
+            subscribe(m_onPair, element, m_arena.create<TYPE>(std::move(callback)));
+        }
+        template <class CHAR, class FUNC> void onArrayItemInt64(const CHAR* element, FUNC callback)
+        {
+            subscribe(m_onArrayItem, element, m_arena.create<CallbackInt64<FUNC>>(std::move(callback)));
+        }
+        template <class CHAR, class FUNC> void onArrayItemDouble(const CHAR* element, FUNC callback)
+        {
+            subscribe(m_onArrayItem, element, m_arena.create<CallbackDouble<FUNC>>(std::move(callback)));
+        }
+        template <class CHAR, class FUNC> void onPairInt64(const CHAR* element, FUNC callback)
+        {
+            subscribe(m_onPair, element, m_arena.create<CallbackInt64<FUNC>>(std::move(callback)));
+        }
+        template <class CHAR, class FUNC> void onPairDouble(const CHAR* element, FUNC callback)
+        {
+            subscribe(m_onPair, element, m_arena.create<CallbackDouble<FUNC>>(std::move(callback)));
+        }
+
+        // Binds objects to a struct, identical to the JsonReader's 'bind' methods.
+        template <class CHAR, class T>
+        void bind(const CHAR* objectPath, const Binding<T>& binding, std::vector<T>& items)
+        {
+            bind(objectPath, m_arena.create<BoundItems<T>>(binding, items));
+        }
+        template <class CHAR, class T, class FUNC>
+        void bind(const CHAR* objectPath, const Binding<T>& binding, FUNC callback)
+        {
+            bind(objectPath, m_arena.create<BoundObject<T, FUNC>>(binding, std::move(callback)));
+        }
+
+        // Removes all callbacks, bindings and patterns.
+        void clear();
+        // Returns true if the set can be used by several readers at the same time, which is not the case if it
+        // contains bindings or batches (see 'bind' and 'onArrayItems'), since they keep the state of a read.
+        bool isShareable() const { return m_binders.empty() && !m_hasBatches; }
+
+      protected:
+        friend class JsonReader;
+
+        // Types of patterns, according to what they are matched against.
+        enum PATTERN_TYPE
+        {
+            PATTERN_NAME,   // The name of the element, as it does not contain brackets.
+            PATTERN_PATH,   // The path of the element.
+            PATTERN_POINTER // The JSON Pointer of the element, as it begins with '/'.
+        };
+        // Callback subscribed to the elements that match a pattern (see 'subscribePattern').
+        struct PATTERN
+        {
+            const char* str; // Copied into the arena.
+            size_t len;
+            PATTERN_TYPE type;
+            Publisher* publisher;
+            Callback* callback;
+        };
+
+        // Subscribes a callback to the event type of 'publisher' and updates the prefixes of the subscribed paths.
+        void subscribe(Publisher& publisher, const wchar_t* element, Callback* callback);
+        void subscribe(Publisher& publisher, const char* elementUtf8, Callback* callback);
+        // Subscribes a callback to the elements matching 'patternUtf8', which begins with '/' or contains '*'. A
+        // '*' matches any characters but brackets, or slashes in a JSON Pointer, and '**' matches any characters.
+        // A JSON Pointer cannot contain array indices, which raise an exception.
+        // The patterns are not looked up: each reader matches the paths it finds against all of them (see
+        // 'matchPatterns') and keeps the result, so MAX_PATTERNS can be subscribed at most.
+        void subscribePattern(Publisher& publisher, const char* patternUtf8, Callback* callback);
+        // Returns in 'matches' the bit mask of the patterns that match the element with path 'path' of 'pathLen'
+        // bytes, and in 'prefixes' those that may match the element or any element nested in it.
+        void matchPatterns(const char* path, size_t pathLen, uint64_t& matches, uint64_t& prefixes) const;
+        // Returns true if any callback is subscribed by a pattern.
+        bool hasPatterns() const { return !m_patterns.empty(); }
+        // Adds the prefixes of 'path', whose string is kept by the caller.
+        void addPathPrefixes(const KEY& path);
+        // Associates a binder, which must have been created in the arena, to the objects with path 'objectPath'.
+        void bind(const wchar_t* objectPath, Binder* binder);
+        void bind(const char* objectPathUtf8, Binder* binder);
+        // Returns the binder of the objects with path 'path' of 'pathLen' bytes, or NULL if there is none.
+        Binder* findBinder(const char* path, size_t pathLen, uint64_t pathHash) const
+        {
+            for (const std::pair<KEY, Binder*>& binder : m_binders)
+            {
+                if (binder.first.hash == pathHash && binder.first.len == pathLen &&
+                    memcmp(binder.first.str, path, pathLen) == 0)
+                    return binder.second;
+            }
+            return nullptr;
+        }
+        // Returns true if any objects are bound to a struct.
+        bool hasBinders() const { return !m_binders.empty(); }
+        // Returns the batch size to use for 'batchSize' (0 for the default).
+        static size_t getBatchSize(size_t batchSize);
+        // Returns true if no callback is subscribed to any event type and no objects are bound.
+        bool isEmpty() const
+        {
+            return m_onObjectBegin.isEmpty() && m_onObjectEnd.isEmpty() && m_onArrayBegin.isEmpty() &&
+                   m_onArrayEnd.isEmpty() && m_onArrayItem.isEmpty() && m_onPair.isEmpty() && m_binders.empty();
+        }
+        // Returns true if the value of the element with path 'path' of 'pathLen' bytes, which begins with 'ch', may
+        // raise events. If 'isArrayItem' is true, the value is an array item. Otherwise it is the value of a pair.
+        // The byte that follows the path must be writable, as it is temporarily overwritten.
+        bool isValueNeeded(char* path, size_t pathLen, uint64_t pathHash, char ch, bool isArrayItem) const;
+        // Returns true if the hash value of the current path is needed, because any callback is subscribed by path or
+        // to all elements (which may request it).
+        bool isPathHashNeeded() const
+        {
+            return m_onObjectBegin.hasPaths() || m_onObjectEnd.hasPaths() || m_onArrayBegin.hasPaths() ||
+                   m_onArrayEnd.hasPaths() || m_onArrayItem.hasPaths() || m_onPair.hasPaths() || hasBinders() ||
+                   hasPatterns() || !m_canSkipValues;
+        }
+
+        // Publishers used to notify one type of event (new object, new array, etc.) to their subscribed callbacks.
+        Publisher m_onObjectBegin;
+        Publisher m_onObjectEnd;
+        Publisher m_onArrayBegin;
+        Publisher m_onArrayEnd;
+        Publisher m_onArrayItem;
+        Publisher m_onPair;
+
+        // Prefixes of the subscribed paths, used to skip the values that cannot raise any event.
+        // Skipping is only possible if all callbacks are subscribed by path.
+        KEY_SET m_pathPrefixes;
+        bool m_canSkipValues; // False if any callback is subscribed by name or to all elements.
+        bool m_hasBatches;    // True if any callback receives array items in batches, which are flushed.
+
+        // Paths of the objects bound to a struct, along with their binders. They are expected to be few.
+        std::vector<std::pair<KEY, Binder*>> m_binders;
+
+        // Patterns by order of subscription, which is their index in the masks of the publishers.
+        static const size_t MAX_PATTERNS = 64;
+        std::vector<PATTERN> m_patterns;
+        uint64_t m_patternsId; // Changes whenever a pattern is added, so that the readers match the paths again.
+
+        Arena m_arena; // Stores the callbacks, the binders and the keys of the publishers.
+    };
+
+    // Settings of a reader that outlive its reads (see 'configure'). A CONFIG is only read, so it can be shared by
+    // readers running in different threads, such as those of a Pool.
+    struct CONFIG
+    {
+        CONFIG()
+            : subscriptions(nullptr), useLocale(false), maxDepth(0), fileBufferLen(0), numFileBuffers(1),
+              useMapping(false)
+        {
+        }
+        // Set of callbacks bound to the readers (see 'useSubscriptions'), or NULL to use their own sets. If it is
+        // shared, it must not be modified meanwhile, and its callbacks must be safe to call from several threads.
+        Subscriptions* subscriptions;
+        bool useLocale;          // If true, narrow strings are notified in the multibyte encoding of the locale.
+        size_t maxDepth;         // See 'setMaxDepth'.
+        size_t fileBufferLen;    // See 'setFileBuffers'.
+        unsigned numFileBuffers; // See 'setFileBuffers'.
+        bool useMapping;         // See 'useMemoryMapping'.
+    };
+
+    // Idle readers that threads borrow to parse a text each, so that a reader, along with the memory of its strings
+    // and buffers, is reused by many reads instead of being constructed and configured for each one. The readers are
+    // kept in an array of slots that threads take and fill with atomic operations, without any lock.
+    class Pool
+    {
+      public:
+        // Reader borrowed from a pool, which is returned when the handle is destroyed.
+        class Handle
+        {
+          public:
+            Handle(Handle&& other) : m_pool(other.m_pool), m_reader(other.m_reader) { other.m_reader = nullptr; }
+            ~Handle()
+            {
+                if (m_reader)
+                    m_pool->release(m_reader);
+            }
+            Handle(const Handle&) = delete;
+            Handle& operator=(const Handle&) = delete;
+            JsonReader* operator->() const { return m_reader; }
+            JsonReader& operator*() const { return *m_reader; }
+
+          protected:
+            friend class Pool;
+            Handle(Pool* pool, JsonReader* reader) : m_pool(pool), m_reader(reader) {}
+            Pool* m_pool;
+            JsonReader* m_reader;
+        };
+
+        // Keeps up to 'capacity' idle readers (64 if 0). Another reader is constructed if all of them are borrowed,
+        // and a reader returned to a full pool is destroyed. The readers use 'config', whose set of subscriptions
+        // must be shareable (see Subscriptions::isShareable). The pool must outlive the handles.
+        Pool(const CONFIG& config, size_t capacity = 0);
+        ~Pool();
+        Pool(const Pool&) = delete;
+        Pool& operator=(const Pool&) = delete;
+
+        // Borrows a reader from any thread. The configuration is applied again, undoing the changes made by the
+        // previous borrower, and the reader has no user data. A text the previous borrower passed to 'feed' and did
+        // not finish is discarded when the reader is returned, as are the callbacks it subscribed to the reader.
+        Handle acquire();
+
+      protected:
+        void release(JsonReader* reader); // Returns a reader to a free slot, or destroys it if there is none.
+
+        CONFIG m_config;
+        std::unique_ptr<std::atomic<JsonReader*>[]> m_slots; // Idle readers, or NULL in the free slots.
+        size_t m_numSlots;
+    };
+
     // Main class declarations.
 
     JsonReader();
@@ -262,6 +1236,29 @@ class JsonReader
 
     bool readFile(const char* fileFullPath); // File contents must be encoded in UTF-8.
     bool readBuffer(const char* buffer);     // The buffer must be null terminated and encoded in UTF-8.
+    // The buffer contains 'bufferLen' bytes encoded in UTF-8. It does not need to be null terminated.
+    bool readBuffer(const char* buffer, size_t bufferLen);
+#ifdef USE_STRING_VIEW
+    bool readBuffer(std::string_view buffer) { return readBuffer(buffer.data(), buffer.size()); }
+#endif
+    // Reads the JSON text provided by 'source' in blocks, as a file (see 'setFileBuffers'), so that it can be
+    // decompressed or received on the fly. The progress is based on the data consumed by the source.
+    // Files compressed with gzip or Zstandard are also decompressed by 'readFile' if the library is compiled with
+    // JSONREADER_ZLIB or JSONREADER_ZSTD respectively, which is detected by the magic number at their beginning.
+    bool readSource(Source& source);
+
+    // Methods to read a large file several times with different subscriptions, without scanning the parts that each
+    // read does not need.
+    // 'writeIndex' reads the file as 'readFile' does, but without skipping any value, and then writes an index to
+    // 'indexFullPath' (or to the file's path plus ".jri" if NULL): the positions where the objects and arrays of at
+    // least 4 KB begin and end, along with the hash values of their paths.
+    bool writeIndex(const char* fileFullPath, const char* indexFullPath = nullptr);
+    // Reads the file as 'readFile' does, mapped into memory, but the objects and arrays that are skipped because they
+    // cannot raise any event (see 'Using the element's path' in the README) are jumped over through the index instead
+    // of being scanned. If the index cannot be read, or the file has changed since it was written (its size, its
+    // modification or status change time, or its identifier differ), the file is read without it. A jump is not
+    // taken either if the bytes next to the brackets of the object or array differ from those indexed.
+    bool readFileIndexed(const char* fileFullPath, const char* indexFullPath = nullptr);
 
     // Methods to subscribe to event types related to specific JSON elements (object found, array found, etc.).
 
@@ -291,6 +1288,32 @@ class JsonReader
     // This argument is a pointer to a string if the value is of type string, number or boolean. Otherwise it is NULL.
     void onPair(const wchar_t* element, std::function<void(const char* value)> callback);    // Value as narrow.
     void onPair(const wchar_t* element, std::function<void(const wchar_t* value)> callback); // Value as wide.
+    // Same functions passing the value as a pointer to UTF-8 data and its length, which is not null terminated.
+    // If the input is a buffer or a mapped file, strings without escape sequences and numbers are not copied, so the
+    // pointer refers to the input data. In any case, the pointer is only valid during the execution of the callback.
+    void onArrayItem(const wchar_t* element, std::function<void(const char* value, size_t length)> callback);
+    void onPair(const wchar_t* element, std::function<void(const char* value, size_t length)> callback);
+    // Same functions passing the value as a number, which is converted while it is parsed. The callback is not
+    // notified about null values, objects or arrays. An error is raised if the value is not a valid JSON number, if
+    // it is out of range or if an integer is expected but the number has a fractional part or an exponent.
+    void onArrayItemInt64(const wchar_t* element, std::function<void(int64_t value)> callback);
+    void onArrayItemDouble(const wchar_t* element, std::function<void(double value)> callback);
+    void onPairInt64(const wchar_t* element, std::function<void(int64_t value)> callback);
+    void onPairDouble(const wchar_t* element, std::function<void(double value)> callback);
+    // Notifies the items of an array in batches of up to 'batchSize' items (1024 if 0), which amortizes the cost of
+    // calling the callback over many items, e.g. for large arrays of numbers. The items of a batch are consecutive
+    // items of the same array: a batch is passed once it is full, when the array ends (before 'onArrayEnd') and when
+    // the read is stopped; the items pending when a read fails are dropped. The arrays are found as in 'onArrayItem',
+    // and a batch subscription replaces an 'onArrayItem' one on the same element, and vice versa.
+    // The values are passed as UTF-8 data, which is only valid during the execution of the callback.
+    void onArrayItems(const wchar_t* element, std::function<void(const ITEM_VALUE* items, size_t count)> callback,
+                      size_t batchSize = 0);
+    // Same functions passing the values as numbers, which are converted as in 'onArrayItemInt64' and
+    // 'onArrayItemDouble'. Null values, objects and arrays are not passed.
+    void onArrayItemsInt64(const wchar_t* element, std::function<void(const int64_t* values, size_t count)> callback,
+                           size_t batchSize = 0);
+    void onArrayItemsDouble(const wchar_t* element, std::function<void(const double* values, size_t count)> callback,
+                            size_t batchSize = 0);
     // Same functions passing the 'element' argument encoded in UTF-8.
     void onObjectBegin(const char* elementUtf8, std::function<void()> callback);
     void onObjectEnd(const char* elementUtf8, std::function<void()> callback);
@@ -300,6 +1323,163 @@ class JsonReader
     void onArrayItem(const char* elementUtf8, std::function<void(const wchar_t*)> callback);
     void onPair(const char* elementUtf8, std::function<void(const char*)> callback);
     void onPair(const char* elementUtf8, std::function<void(const wchar_t*)> callback);
+    void onArrayItem(const char* elementUtf8, std::function<void(const char*, size_t)> callback);
+    void onPair(const char* elementUtf8, std::function<void(const char*, size_t)> callback);
+    void onArrayItemInt64(const char* elementUtf8, std::function<void(int64_t)> callback);
+    void onArrayItemDouble(const char* elementUtf8, std::function<void(double)> callback);
+    void onPairInt64(const char* elementUtf8, std::function<void(int64_t)> callback);
+    void onPairDouble(const char* elementUtf8, std::function<void(double)> callback);
+    void onArrayItems(const char* elementUtf8, std::function<void(const ITEM_VALUE*, size_t)> callback,
+                      size_t batchSize = 0);
+    void onArrayItemsInt64(const char* elementUtf8, std::function<void(const int64_t*, size_t)> callback,
+                           size_t batchSize = 0);
+    void onArrayItemsDouble(const char* elementUtf8, std::function<void(const double*, size_t)> callback,
+                            size_t batchSize = 0);
+    // Template versions of the functions above, taking 'element' either as a wide or a UTF-8 string. They are chosen
+    // for lambda expressions, function objects and function pointers, whose type is kept instead of being converted
+    // to a 'std::function', so the callback is called directly and it can be inlined into the code that notifies the
+    // event. The signature of the callbacks receiving an array item or a pair is deduced from their call operator,
+    // so the 'std::function' versions are still used for function objects with several or template call operators.
+    template <class CHAR, class FUNC> void onObjectBegin(const CHAR* element, FUNC callback)
+    {
+        m_subscriptions->onObjectBegin(element, std::move(callback));
+    }
+    template <class CHAR, class FUNC> void onObjectEnd(const CHAR* element, FUNC callback)
+    {
+        m_subscriptions->onObjectEnd(element, std::move(callback));
+    }
+    template <class CHAR, class FUNC> void onArrayBegin(const CHAR* element, FUNC callback)
+    {
+        m_subscriptions->onArrayBegin(element, std::move(callback));
+    }
+    template <class CHAR, class FUNC> void onArrayEnd(const CHAR* element, FUNC callback)
+    {
+        m_subscriptions->onArrayEnd(element, std::move(callback));
+    }
+    template <class CHAR, class FUNC,
+              class TYPE = typename VALUE_CALLBACK<typename CALLBACK_TRAITS<FUNC>::SIGNATURE, FUNC>::TYPE>
+    void onArrayItem(const CHAR* element, FUNC callback)
+    {
+        m_subscriptions->onArrayItem(element, std::move(callback));
+    }
+    template <class CHAR, class FUNC,
+              class TYPE = typename VALUE_CALLBACK<typename CALLBACK_TRAITS<FUNC>::SIGNATURE, FUNC>::TYPE>
+    void onPair(const CHAR* element, FUNC callback)
+    {
+        m_subscriptions->onPair(element, std::move(callback));
+    }
+    template <class CHAR, class FUNC> void onArrayItemInt64(const CHAR* element, FUNC callback)
+    {
+        m_subscriptions->onArrayItemInt64(element, std::move(callback));
+    }
+    template <class CHAR, class FUNC> void onArrayItemDouble(const CHAR* element, FUNC callback)
+    {
+        m_subscriptions->onArrayItemDouble(element, std::move(callback));
+    }
+    template <class CHAR, class FUNC> void onPairInt64(const CHAR* element, FUNC callback)
+    {
+        m_subscriptions->onPairInt64(element, std::move(callback));
+    }
+    template <class CHAR, class FUNC> void onPairDouble(const CHAR* element, FUNC callback)
+    {
+        m_subscriptions->onPairDouble(element, std::move(callback));
+    }
+
+    // Methods to bind the objects with path 'objectPath' (which ends with an opening curly bracket) to a struct T.
+    // Each object is filled with the values of its pairs according to 'binding', which must remain valid as long as
+    // it is in use (like 'items'). The pairs are matched by name, so objects and arrays in the bound object are not
+    // taken into account. Binding is compatible with skipping values, and callbacks may be subscribed as well.
+    // -> The objects are appended to 'items' when they begin and they are filled in place. If the read fails or it
+    // is stopped, the last item may be incomplete.
+    template <class CHAR, class T> void bind(const CHAR* objectPath, const Binding<T>& binding, std::vector<T>& items)
+    {
+        m_subscriptions->bind(objectPath, binding, items);
+    }
+    // -> Each object is passed to 'callback' as a non-constant reference to a T, once it has been filled. The object
+    // is reset (value-initialized) when the next one begins.
+    template <class CHAR, class T, class FUNC>
+    void bind(const CHAR* objectPath, const Binding<T>& binding, FUNC callback)
+    {
+        m_subscriptions->bind(objectPath, binding, std::move(callback));
+    }
+
+    // Methods to process newline-delimited JSON (NDJSON or JSON Lines) from a file or a buffer, where each line holds
+    // a JSON value.
+    // The input is split into chunks of whole lines, which are parsed concurrently by 'numThreads' threads (one per
+    // core if 0). Each thread reads its lines with its own JsonReader, whose callbacks must be subscribed by 'setup'.
+    // This function is called once by each thread when it starts, receiving the thread's reader and its index.
+    // The callbacks of a thread are only executed by that thread, so they can gather results in per-thread data
+    // without synchronization. The order in which lines are notified across threads is undefined.
+    // If not null, 'commit' is called by each thread after it finishes a chunk, with the thread's index. The calls take
+    // place one at a time in the order of the chunks in the input, so the results gathered from each chunk can be
+    // merged in order. Threads wait for their turn before parsing their next chunk.
+    // Empty lines are ignored. If a line cannot be parsed, the reading stops (no more chunks are committed) and the
+    // error description includes the byte position of the line.
+    // Files are mapped into memory. Buffers are accessed directly and do not need to be null terminated.
+    bool readFileLines(const char* fileFullPath, std::function<void(JsonReader& reader, unsigned thread)> setup,
+                       std::function<void(unsigned thread)> commit = nullptr, unsigned numThreads = 0);
+    bool readBufferLines(const char* buffer, size_t bufferLen,
+                         std::function<void(JsonReader& reader, unsigned thread)> setup,
+                         std::function<void(unsigned thread)> commit = nullptr, unsigned numThreads = 0);
+
+    // Methods to process a JSON file or buffer where the items of one large array are parsed concurrently.
+    // The array is located by its path 'arrayPathUtf8' (e.g. '{data{users['). Once it is found, a structural index of
+    // its content is built in order to split it into chunks of whole items, which are parsed by 'numThreads' threads
+    // (one per core if 0). Each thread parses its items with its own JsonReader, which reports the same paths as a
+    // sequential read (e.g. '{data{users[{id'). Its callbacks are subscribed by 'setup', as in 'readFileLines', and
+    // 'commit' is optionally called after each chunk, in the order of the chunks in the array.
+    // The elements outside the array, as well as the array's begin and end, are notified to the callbacks of this
+    // reader, which waits for the items to be parsed before going on. The items are only notified to the threads.
+    // Files are mapped into memory.
+    bool readFileParallel(const char* fileFullPath, const char* arrayPathUtf8,
+                          std::function<void(JsonReader& reader, unsigned thread)> setup,
+                          std::function<void(unsigned thread)> commit = nullptr, unsigned numThreads = 0);
+    bool readBufferParallel(const char* buffer, size_t bufferLen, const char* arrayPathUtf8,
+                            std::function<void(JsonReader& reader, unsigned thread)> setup,
+                            std::function<void(unsigned thread)> commit = nullptr, unsigned numThreads = 0);
+
+    // Methods to process a JSON text that is received in fragments of arbitrary length (e.g. from a socket).
+    // 'feed' passes the next fragment of the text, encoded in UTF-8, and returns once it has been parsed. The events
+    // of the values completed by the fragment are notified before it returns, so the fragment does not need to
+    // remain valid afterwards. The parser state is kept between calls, so values may be split anywhere, even in the
+    // middle of a string or an escape sequence.
+    // 'finish' signals the end of the text, so that the value being parsed is completed or reported as truncated.
+    // The reader is then ready to parse a new text from the next call to 'feed'.
+    // Both methods return false if the text is invalid. In that case, the fragments passed to 'feed' are ignored until
+    // 'finish' is called. Any data after the root value is ignored as well.
+    // The callbacks are executed by the calling thread, before 'feed' or 'finish' returns. If a fragment ends in the
+    // middle of a member, the text of that member is kept and parsed again along with the next fragment.
+    // A text that is not finished when the reader is destroyed is discarded, without notifying its last values.
+    bool feed(const char* data, size_t len);
+    bool finish();
+
+    // Sets the maximum number of nested objects and arrays. A read fails if it is exceeded, which limits the memory
+    // used by deeply nested documents. The parser is not recursive, so its stack usage does not depend on the depth.
+    // Values skipped without being parsed, because they cannot raise any event, are not checked. It's 0 by default
+    // (unlimited), and the setting is kept across reads.
+    void setMaxDepth(size_t maxDepth) { m_maxDepth = maxDepth; }
+
+    // Methods to reuse a set of subscriptions across reads.
+
+    // Binds the set 'subscriptions' to the reader, which notifies the events to its callbacks from then on.
+    // The 'on...' methods of the reader subscribe their callbacks to this set, which is not cleared after each read.
+    // The set must outlive the reader or be unbound before being destroyed. Set it to NULL to unbind it and go back
+    // to the reader's own set.
+    void useSubscriptions(Subscriptions* subscriptions);
+
+    // Methods to share a configuration across readers and threads (see CONFIG and Pool).
+
+    // Applies 'config' to the reader: it binds its subscriptions and sets the locale flag, the maximum depth, the
+    // file buffers and the memory mapping. Unlike 'useLocale', the global locale is not changed, since all threads share it: the application
+    // sets it once (e.g. calling 'useLocale' on any reader before the threads start).
+    void configure(const CONFIG& config);
+    // Associates any data to the reader (NULL by default), e.g. where the callbacks of a shared set of subscriptions
+    // store the results of the current read.
+    void setUserData(void* userData) { m_userData = userData; }
+    void* getUserData() const { return m_userData; }
+    // Returns the reader whose read is executing the callbacks in the calling thread, or NULL outside a read. The
+    // callbacks of a shared set of subscriptions, which cannot capture their reader, call its methods through it.
+    static JsonReader* getCurrentReader();
 
     // Methods related to progress notification.
 
@@ -307,14 +1487,49 @@ class JsonReader
     // The step must range from 1 to 99 and it is a target value (the actual percentage is passed to the callback).
     // To disable progress notification, set 'progressCallback' to null.
     void onProgress(int step, std::function<void(int progress)> progressCallback);
+    // Same as 'onProgress', but the callback also receives the number of bytes read, the throughput and the
+    // estimated time left. The clock is only read when the progress is notified.
+    void onProgressInfo(int step, std::function<void(const PROGRESS_INFO& progress)> progressCallback);
     // Returns the progress as the percentage of the current number of bytes read.
     double getProgress() { return m_input.getProgress(); }
 
+    // Method to read input files through a memory mapping instead of a fixed-size read buffer.
+    // The file is then parsed as a single contiguous block, avoiding the copies made by successive reads.
+    // The setting is kept across reads.
+    void useMemoryMapping(bool useMapping) { m_input.setMemoryMapping(useMapping); }
+
+    // Method to set the buffers used to read input files that are not mapped into memory.
+    // The file is read in blocks of 'bufferLen' bytes (64 KB if 0, which is the default). If 'numBuffers' is greater
+    // than 1, a background thread reads the next blocks into a ring of 'numBuffers' buffers while the parser consumes
+    // the current one, so that the latency of the storage overlaps with the parsing. The setting is kept across reads.
+    void setFileBuffers(size_t bufferLen, unsigned numBuffers = 1) { m_input.setFileBuffers(bufferLen, numBuffers); }
+
     // Methods that return a list of unique paths of all elements found in a JSON text.
     // These may help to find out the exact element's path in order to subscribe to its events.
 
     bool getPathsFromFile(const char* fileFullPath, std::set<std::wstring>& paths);
     bool getPathsFromBuffer(const char* buffer, std::set<std::wstring>& paths);
+    bool getPathsFromBuffer(const char* buffer, size_t bufferLen, std::set<std::wstring>& paths);
+    // Same as above, but also return how many times each path was found and the types of its elements. The paths of
+    // the items of an array are not included, since they are the path of the array.
+    bool getPathsFromFile(const char* fileFullPath, PATH_INFO_MAP& paths);
+    bool getPathsFromBuffer(const char* buffer, size_t bufferLen, PATH_INFO_MAP& paths);
+
+#ifdef JSONREADER_STATS
+    // Methods to instrument the reader, available if compiled with JSONREADER_STATS. Otherwise, the counters are not
+    // compiled at all.
+
+    // Returns the counters accumulated by the reads since the reader was created or 'resetStats' was called.
+    // The readers of the threads used by the methods that read in parallel keep their own counters.
+    STATS getStats() const;
+    void resetStats();
+    // Sets a hook called after the callbacks of an event have been executed, receiving the type of event, the path of
+    // the element (as UTF-8) and the time spent in them. Set it to null to remove it.
+    void onTrace(std::function<void(STATS::EVENT_TYPE type, const char* pathUtf8, double seconds)> hook)
+    {
+        m_traceHook = std::move(hook);
+    }
+#endif
 
     // Methods that provide additional information from within the callback functions.
 
@@ -333,6 +1548,25 @@ class JsonReader
     bool isValueQuoted() { return m_elemValue.isQuoted; }
     // Returns true if the current path contains only ASCII characters.
     bool isPathAscii() { return m_path.isAscii; }
+    // Returns the hash value of the current element's path, as computed by 'hashPath'.
+    uint64_t getCurrentElementPathHash();
+    // Returns the hash value of the path 'pathUtf8' of 'len' bytes (or of a string literal), which is computed at
+    // compile time if the path is a constant. Along with 'getCurrentElementPathHash', it allows a callback subscribed
+    // to all elements to find out the current element from a fixed set of paths with a switch statement, without
+    // looking up or comparing strings, e.g.:
+    //     switch (reader.getCurrentElementPathHash())
+    //     {
+    //     case JsonReader::hashPath("{data{users[{id"): ...
+    // Different paths may have the same hash value, although it is very unlikely.
+    static constexpr uint64_t hashPath(const char* pathUtf8, size_t len, uint64_t hash = Publisher::HASH_SEED)
+    {
+        return len == 0 ? hash
+                        : hashPath(pathUtf8 + 1, len - 1, (hash ^ (unsigned char)*pathUtf8) * Publisher::HASH_PRIME);
+    }
+    template <size_t N> static constexpr uint64_t hashPath(const char (&pathUtf8)[N])
+    {
+        return hashPath(pathUtf8, N - 1);
+    }
     // Returns true if the current array item is of type string, number, boolean or null.
     bool isArrayItemValue() { return m_arrayItem.isValue; }
 
@@ -343,62 +1577,293 @@ class JsonReader
 
     // Methods related to process cancellation.
 
-    void cancel() { m_cancel = true; }      // Stops reading further data.
+    // Stops reading further data. It is meant to be called from another thread, and the reader checks it every
+    // 64 KB of input, so the read ends shortly afterwards.
+    void cancel() { m_cancel = true; }
     bool isCancelled() { return m_cancel; } // Returns true if the reading has been cancelled.
+    // Stops reading further data as if the input ended after the current value, so the read succeeds. It's meant to
+    // be called from a callback, e.g. once the values being looked for have been found, and it's cheaper than an
+    // exception. In the methods that read in parallel, it only stops the current line or chunk of the thread's reader.
+    void stop()
+    {
+        m_stop = true;
+        m_nextCheck = 0; // Checked after the current value.
+    }
+    bool isStopped() { return m_stop; } // Returns true if the reading has been stopped.
 
-    // Methods to get a description when an error is found.
+    // Methods to get the error found by the last read.
 
-    std::string getErrorDescription() { return m_errDescription; }
+    // Error codes.
+    enum ERROR_CODE
+    {
+        ERROR_NONE,
+        ERROR_CANNOT_OPEN_FILE,
+        ERROR_CANNOT_SET_BUFFER,
+        ERROR_UNEXPECTED_END,
+        ERROR_UNEXPECTED_CHARACTER,
+        ERROR_INVALID_ESCAPE_SEQUENCE,
+        ERROR_INVALID_HEX_DIGIT,
+        ERROR_INVALID_NUMBER,
+        ERROR_NOT_A_NUMBER,
+        ERROR_NOT_AN_INTEGER,
+        ERROR_OUT_OF_RANGE,
+        ERROR_NOT_A_BOOLEAN,
+        ERROR_MAX_DEPTH,
+        ERROR_NOT_CONTIGUOUS,
+        ERROR_INVALID_COMPRESSED_DATA,
+        ERROR_UNSUPPORTED_COMPRESSION,
+        ERROR_CANNOT_WRITE_INDEX,
+        ERROR_CANCELLED,
+        ERROR_EXCEPTION // An exception thrown by a callback.
+    };
+    ERROR_CODE getErrorCode() { return m_errorCode; }
+    // The description is built when first requested, including the position and the path where the error was found.
+    std::string getErrorDescription();
     std::wstring getErrorDescriptionWide()
     {
-        std::wstring wsTmp(m_errDescription.begin(), m_errDescription.end());
+        std::string description = getErrorDescription();
+        std::wstring wsTmp(description.begin(), description.end());
         return wsTmp;
     }
 
   protected:
+    // Settings of a read where the items of an array are parsed concurrently (see 'readBufferParallel').
+    struct PARALLEL_READ
+    {
+        std::string arrayPath; // Path of the array, encoded in UTF-8.
+        std::function<void(JsonReader&, unsigned)>* setup;
+        std::function<void(unsigned)>* commit;
+        unsigned numThreads;
+    };
+    // Describes the array whose items are contained in the input, when a chunk of items is parsed by a thread.
+    struct ARRAY_RANGE
+    {
+        const char* path; // Path of the array.
+        size_t pathLen;
+        size_t namePos;  // Position of the array's name in its path.
+        size_t nameLen;  // Length of the array's name.
+        size_t position; // Position of the chunk in the whole input.
+        size_t depth;    // Number of objects and arrays that enclose the items, including the array.
+        uint64_t pathHash;
+    };
+    // State of an object or array being parsed.
+    struct FRAME
+    {
+        size_t pathLen;   // Length of its path, including the bracket.
+        size_t namePos;   // Position of its name in the path.
+        size_t nameLen;   // Length of its name.
+        bool isPathAscii; // True if its path was ASCII before appending its name.
+        bool isArray;
+        uint64_t pathHash; // Hash value of its path (if needed).
+        Binder* binder;    // Binder of the object, if it is bound to a struct.
+        Callback* batch;   // The only callback of the items of the array, if it receives them in batches.
+        size_t position;   // Position of its bracket in the input, if an index is written.
+    };
+    // Object or array of the index of a file (see 'writeIndex').
+    struct INDEX_ENTRY
+    {
+        uint64_t begin;    // Position of its opening bracket.
+        uint64_t end;      // Position of its closing bracket.
+        uint64_t pathHash; // Hash value of its path, which checks that the index matches the input.
+        uint64_t check;    // Hash value of the bytes next to its brackets (see 'getIndexCheck').
+    };
+    // Beginning of an index file, followed by its entries sorted by position. The values are written in little-endian
+    // byte order, so the index can be read on any machine.
+    struct INDEX_HEADER
+    {
+        char magic[4];
+        uint32_t version;
+        // Size, modification and status change times (in nanoseconds) and identifier (inode or file index) of the
+        // file, which must not change.
+        uint64_t fileSize;
+        int64_t fileTime;
+        int64_t fileChangeTime;
+        uint64_t fileId;
+        uint64_t numEntries;
+    };
+    // Patterns matched by a path (see Subscriptions::matchPatterns).
+    struct PATTERN_MATCH
+    {
+        uint64_t matches;  // Bit mask of the patterns that match the element.
+        uint64_t prefixes; // Bit mask of the patterns that may match the element or an element nested in it.
+    };
+    // Patterns matched by the paths found, keyed on their UTF-8 bytes, which are copied into 'arena'. Since paths
+    // repeat, as do those of the items of an array, each one is matched once and then costs a single lookup.
+    struct PATTERN_CACHE
+    {
+        std::unordered_map<KEY, PATTERN_MATCH, KEY_HASH, KEY_EQUAL> matches;
+        Arena arena;
+        uint64_t patternsId; // Patterns of the subscriptions that were matched (see Subscriptions::m_patternsId).
+    };
+    // Function that parses the chunk of the input from 'begin' to 'end' with 'reader'. On error, it returns false and
+    // sets the position and the description of the error.
+    typedef std::function<bool(JsonReader& reader, size_t begin, size_t end, size_t& errorPosition,
+                               std::string& errorDescription)>
+        CHUNK_PARSER;
+
+    // Unique paths found while reading, keyed on their UTF-8 bytes, which are copied into 'arena'. Since the hash of the
+    // path is computed as it is built, an element whose path is already known is counted without any allocation.
+    struct PATH_LIST
+    {
+        std::unordered_map<KEY, PATH_INFO, KEY_HASH, KEY_EQUAL> paths;
+        Arena arena;
+    };
+
     // Reads a file or buffer containing the JSON data encoded in UTF-8.
-    // If 'isFile' is true, 'source' is the full path of the input file. Otherwise, it's a pointer to a UTF-8 buffer.
+    // If 'isFile' is true, 'source' is the full path of the input file. Otherwise, it's a pointer to a UTF-8 buffer
+    // of 'sourceLen' bytes.
     // The optional argument 'pathList' returns a list of unique paths of all the elements found.
-    bool read(const char* source, bool isFile, std::set<std::wstring>* pathList = nullptr);
+    // If 'arrayRange' is not null, the input is a sequence of items of the array it describes.
+    bool read(const char* source, size_t sourceLen, bool isFile, PATH_LIST* pathList = nullptr,
+              const ARRAY_RANGE* arrayRange = nullptr);
+    // Adds the path of the element being notified by 'publisher' to 'm_pathList'. See 'notify' for the arguments.
+    void addPath(Publisher* publisher, size_t pathLen, uint64_t pathHash, STR* value);
+    // Returns the path of the index of the file 'fileFullPath', which is 'indexFullPath' unless it is NULL.
+    static std::string getIndexPath(const char* fileFullPath, const char* indexFullPath);
+    // Reads the index 'indexPath' of the file 'fileFullPath' into 'entries'. Returns false if it cannot be read or it
+    // does not match the file.
+    static bool loadIndex(const char* fileFullPath, const std::string& indexPath, std::vector<INDEX_ENTRY>& entries);
+    // Fills the members of 'header' that describe the file 'fileFullPath'. Returns false if it cannot be found.
+    static bool getFileInfo(const char* fileFullPath, INDEX_HEADER& header);
+    // Returns the hash value of the INDEX_CHECK_LEN bytes that follow the opening bracket at 'begin' and of those
+    // that precede the closing bracket at 'end', which detects most changes to a file that keep its size and times.
+    uint64_t getIndexCheck(uint64_t begin, uint64_t end);
+    // If the object or array that begins at the current character, whose path has the hash value 'pathHash', is found
+    // in 'm_index', moves to its closing bracket and returns true.
+    bool jumpOverValue(uint64_t pathHash);
+    // Reads the unique paths of the input and returns them in 'paths' (converted into wide strings) and 'pathInfo'.
+    bool getPaths(const char* source, size_t sourceLen, bool isFile, std::set<std::wstring>* paths,
+                  PATH_INFO_MAP* pathInfo);
+    // Reads the lines of a buffer of 'bufferLen' bytes concurrently (see 'readBufferLines').
+    bool readLines(const char* buffer, size_t bufferLen, std::function<void(JsonReader&, unsigned)>& setup,
+                   std::function<void(unsigned)>& commit, unsigned numThreads);
+    // Parses the chunks of the input described by 'chunkEnds' concurrently with 'parseChunk', where the first chunk
+    // begins at 'begin' and every other one begins at the end of the previous one. The rest of arguments are those
+    // of 'readBufferLines'. On error, the description of the first one in the input is stored.
+    bool parseChunks(size_t begin, const std::vector<size_t>& chunkEnds, CHUNK_PARSER& parseChunk,
+                     std::function<void(JsonReader&, unsigned)>& setup, std::function<void(unsigned)>& commit,
+                     unsigned numThreads);
 
     // Methods to reset the state.
     void clear();
     void clearStrings();
-    void unsubscribe(); // Removes all callbacks.
+    // Drops the text received by 'feed' and not finished, along with the pending batches, without parsing it.
+    void discardStream();
+    void setStringsLocale(bool useLocale); // Sets whether the strings are converted with the locale.
 
     // Methods used for parsing.
-    void parseValue(size_t pathLen, ARRAY_ITEM* arrayItem = nullptr);
-    void parseObject(size_t pathLen, size_t namePos, size_t elemNameLen);
-    void parseArray(size_t pathLen, size_t namePos, size_t elemNameLen);
+    // Parses the value at the current character, including all the members of objects and arrays. If 'isArrayItem'
+    // is true, a scalar value is stored in 'm_arrayItem' instead of being notified as a pair.
+    // The argument 'pathHash' is the hash value of the path of 'pathLen' bytes where the value is found (if needed).
+    // If 'isResumed' is true, the parsing goes on from the last member completed by the previous fragment of a
+    // stream and the other arguments are ignored.
+    void parseValue(size_t pathLen, uint64_t pathHash, bool isArrayItem = false, bool isResumed = false);
+    void parseArrayInParallel(size_t pathLen, size_t namePos, size_t elemNameLen); // Parses the items concurrently.
+    void parseArrayItems(const ARRAY_RANGE& range); // Parses a chunk of items of an array.
+    // Called once the position reaches 'm_nextCheck'. Notifies the progress if due and returns true if the read
+    // must end, because it has been stopped or cancelled.
+    bool checkpoint();
     void parseString(STR& text);
     void parseNumber(STR& number);
     bool parseTrue();
     bool parseFalse();
     bool parseNull();
+    // Returns false if the current character is not the first one of 'literal' (e.g. "true"). Otherwise, the rest of
+    // the characters must follow, and true is returned.
+    bool parseLiteral(const char* literal);
     bool isNumericCharacter(char ch);        // True if 'ch' may be part of a number (digit, decimal, sign...).
     void updateCurrentPath(size_t& pathLen); // Updates the length of the current path according to the context.
 
+    // Passes the value of an array item to 'batch', the only callback of the array, without looking it up. The rest
+    // of arguments are those of 'notify'.
+    void notifyBatch(Callback* batch, size_t namePos, size_t nameLen, size_t pathLen, uint64_t pathHash, STR* value);
+    // Flushes the batches of the items of the array described by 'namePos', 'nameLen', 'pathLen' and 'pathHash'
+    // (see 'notify' and Callback::flush).
+    void flushBatches(size_t namePos, size_t nameLen, size_t pathLen, uint64_t pathHash, bool isDiscarded);
+    // Flushes the batches of the arrays being parsed, from the innermost one, including the array whose items are
+    // parsed by 'parseArrayItems' (if any). It is called when a read ends, and when an array begins whose items would
+    // be added to a batch holding the items of an enclosing array.
+    void flushPendingBatches(bool isDiscarded);
+    // Returns the callback of the items of the array with path 'pathLen' bytes of 'm_path' if it receives them in
+    // batches, and no other callback is subscribed to them (see Publisher::findBatch). The rest of arguments are
+    // those of 'notify'.
+    Callback* findBatch(size_t namePos, size_t nameLen, size_t pathLen, uint64_t pathHash, bool& hasPending);
+
+    // Returns the patterns matched by the path of 'pathLen' bytes of 'm_path', whose hash value is 'pathHash'.
+    const PATTERN_MATCH& matchPatterns(size_t pathLen, uint64_t pathHash);
+    // Stores in 'callbacks', which holds Subscriptions::MAX_PATTERNS items, the callbacks of the patterns subscribed
+    // to the events of 'publisher' that match the element with path 'pathLen' bytes of 'm_path', in the order they
+    // were subscribed. Returns their number.
+    size_t findPatterns(const Publisher* publisher, size_t pathLen, uint64_t pathHash, Callback** callbacks);
+    // Returns true if the value of the element with path 'pathLen' bytes of 'm_path', which begins with 'ch', may
+    // raise the events of a pattern (see Subscriptions::isValueNeeded).
+    bool isPatternValueNeeded(size_t pathLen, uint64_t pathHash, char ch, bool isArrayItem);
+
     // Notifies an event.
     // The argument 'publisher' determines the type of event (new object, new array...).
-    // The arguments 'namePos', 'nameLen' and 'pathLen' describe the element that raised the event.
+    // The arguments 'namePos', 'nameLen', 'pathLen' and 'pathHash' describe the element that raised the event.
     // If applicable, the argument 'value' contains the string to be sent to the client. Otherwise it is NULL.
-    void notify(Publisher* publisher, size_t namePos, size_t nameLen, size_t pathLen, STR* value = nullptr);
+    void notify(Publisher* publisher, size_t namePos, size_t nameLen, size_t pathLen, uint64_t pathHash,
+                STR* value = nullptr);
 
     // Throws a runtime exception from a variable argument list.
     [[noreturn]] static void throwException(const char* format, ...);
+    // Errors found while reading are thrown as an ERROR_INFO, which is caught by 'read'. Its argument, if any, is
+    // either the string 'arg' (which must remain valid until then) or the character 'ch'.
+    struct ERROR_INFO
+    {
+        ERROR_CODE code;
+        const char* arg;
+        char ch;
+    };
+    [[noreturn]] static void throwError(ERROR_CODE code, const char* arg = nullptr);
+    [[noreturn]] static void throwError(ERROR_CODE code, char ch);
+    // Thrown when the text received by 'feed' is consumed in the middle of a member, which is caught by 'read'.
+    struct FRAGMENT_END
+    {
+        bool isInString; // True if a string is being read, so the member cannot end before a quotation mark.
+    };
+    // Stores the context of an error, which is described by 'getErrorDescription'.
+    void setError(ERROR_CODE code, const std::string& arg);
 
   protected:
     // Represents the JSON input stream.
     JsonInput m_input;
 
-    // Publishers used to notify one type of event (new object, new array, etc.) to their subscribed callbacks.
-    Publisher m_onObjectBegin;
-    Publisher m_onObjectEnd;
-    Publisher m_onArrayBegin;
-    Publisher m_onArrayEnd;
-    Publisher m_onArrayItem;
-    Publisher m_onPair;
-    Publisher* m_currentPublisher; // Points to the publisher that is currently sending a notification.
+    // Callbacks to notify the events to.
+    Subscriptions m_ownSubscriptions; // Set filled by the 'on...' methods if no other set is bound to the reader.
+    Subscriptions* m_subscriptions;   // Set used by the reader, which is either its own set or a bound one.
+    PATTERN_CACHE m_patternCache;     // Patterns of 'm_subscriptions' matched by the paths found.
+
+    // Name of the current element being notified, which refers to the current path.
+    const char* m_currentName;
+    size_t m_currentNameLen;
+    uint64_t m_currentPathHash; // Hash value of the path of the element being notified (if needed).
+
+    // If not null, stores the unique paths of all the elements found.
+    PATH_LIST* m_pathList;
+
+    // If not null, the items of an array are parsed concurrently.
+    PARALLEL_READ* m_parallelRead;
+    // If not null, the input is a chunk of the items of the array it describes.
+    const ARRAY_RANGE* m_arrayRange;
+
+    // If not null, the objects and arrays found are added to it, as an index of the input is written.
+    std::vector<INDEX_ENTRY>* m_newIndex;
+    // If not null, index of the input used to jump over the objects and arrays skipped, where 'm_indexPos' is the
+    // first entry that has not been reached yet.
+    const std::vector<INDEX_ENTRY>* m_index;
+    size_t m_indexPos;
+
+    void* m_userData; // Data associated by the client (see 'setUserData').
+
+    // If not null, the input is being received through 'feed'.
+    STREAM* m_stream;
+
+    // Objects and arrays currently being parsed, from the outermost to the innermost.
+    std::vector<FRAME> m_frames;
+    size_t m_maxDepth;  // Maximum number of nested objects and arrays (0 if unlimited).
+    size_t m_baseDepth; // Number of objects and arrays that enclose the input, if it is part of a larger one.
 
     // Strings used during the parsing of the JSON data.
     STR m_elemName;        // Stores the name of the last element found.
@@ -406,12 +1871,29 @@ class JsonReader
     STR m_path;            // Stores the path of the current element being parsed.
     STR m_currentElemName; // Auxiliary string that stores the name of the current element being notified.
                            // It is only updated when the client requests the current element's name.
+    NUMBER m_number;       // Stores the value of the last number found.
 
     // Flags
-    bool m_useLocale;      // If true, UTF-8 strings are notified as non-Unicode multibyte strings.
-    bool m_notifyProgress; // If true, the progress is notified.
-    bool m_cancel;         // If true, the parsing is interrupted.
+    bool m_skipValues;          // If true, values whose path is not a prefix of a subscribed path are skipped.
+    bool m_hashPaths;           // If true, the hash value of the path is computed as it is built.
+    bool m_useLocale;           // If true, UTF-8 strings are notified as non-Unicode multibyte strings.
+    bool m_notifyProgress;      // If true, the progress is notified.
+    std::atomic<bool> m_cancel; // If true, the parsing is interrupted. It may be set by another thread.
+    bool m_stop;                // If true, the parsing finishes after the current value.
+    // The progress, the cancellation and the stop are only checked once the position reaches 'm_nextCheck'. It is
+    // moved forward by 64 KB at most, or up to the next progress notification.
+    size_t m_nextCheck;
+
+#ifdef JSONREADER_STATS
+    STATS m_stats; // Counters of the reader, to which those of the input and the strings are added by 'getStats'.
+    std::function<void(STATS::EVENT_TYPE, const char*, double)> m_traceHook; // Called after the callbacks of an event.
+#endif
 
-    // Stores the description of the last error.
+    // Context of the last error.
+    ERROR_CODE m_errorCode;
+    std::string m_errorArg;  // Argument of the error message.
+    size_t m_errorPosition;  // Position of the input where the error was found.
+    std::string m_errorPath; // Path of the element where the error was found.
+    // Stores the description of the last error, once built.
     std::string m_errDescription;
 };
@@ -0,0 +1,928 @@
+﻿/*
+    Tests of the JsonReader class, run by 'ctest' (see CMakeLists.txt):
+    - Reads a text during the dynamic initialization of this file, which may come before that of the library.
+    - Reads malformed and truncated JSON text from every kind of input, which must fail without reading out of
+      bounds (best run in a build with the address sanitizer enabled).
+    - Reads files with buffers smaller than the text.
+    - Passes texts to 'feed' in fragments of every length, which must give the events of a single read.
+    - Destroys readers in the middle of a text passed to 'feed', which must not notify anything else.
+    - Keeps the memory mapping setting across reads, including those that map the file regardless of it.
+    - Passes array items in batches of sizes that do not divide their number, when a read is stopped or fails, and
+      along with patterns.
+    - Reads the items of a large array in parallel, which must give the results of a sequential read, and fails on
+      truncated and mismatched brackets.
+    - Reads files through an index, which must give the events of a plain read, including when the index is missing,
+      corrupt or stale.
+    - Borrows readers from a pool, which must not keep anything the previous borrower left.
+    - Rejects the JSON Pointers with array indices, and notifies members named with digits by path.
+    - Notifies every pattern that matches an element, in the order they were subscribed.
+    - Binds objects to structs with members of each type, ignoring null values and failing on numbers out of range,
+      and finds the members of a binding with many names.
+    - Fails on values nested beyond the maximum depth, and parses 100000 nested arrays and objects.
+    - Converts numbers that need to be correctly rounded, and fails on those out of the range of a double or an int64_t.
+    - Reads a file compressed with Zstandard, whole and truncated (if built with JSONREADER_ZSTD).
+*/
+
+#include "JsonReader.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int numFailures = 0;
+
+#define CHECK(condition)                                                                                             \
+    do                                                                                                               \
+    {                                                                                                                \
+        if (!(condition))                                                                                            \
+        {                                                                                                            \
+            std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl;                  \
+            numFailures++;                                                                                           \
+        }                                                                                                            \
+    } while (false)
+
+// Source that returns the text in blocks of at most 'blockLen' bytes.
+class BlockSource : public JsonReader::Source
+{
+  public:
+    BlockSource(const std::string& text, size_t blockLen) : m_text(text), m_blockLen(blockLen), m_position(0) {}
+    size_t read(char* buffer, size_t len)
+    {
+        size_t numBytes = std::min(std::min(len, m_blockLen), m_text.size() - m_position);
+        memcpy(buffer, m_text.data() + m_position, numBytes);
+        m_position += numBytes;
+        return numBytes;
+    }
+
+  private:
+    std::string m_text;
+    size_t m_blockLen;
+    size_t m_position;
+};
+
+// Reads a text with the vector scanning functions, which must not depend on the order of the initializations.
+static std::string readDuringStaticInit()
+{
+    std::string values;
+    JsonReader reader;
+    reader.onArrayItem("[", [&](const char* value) { values += value; });
+    reader.readBuffer("[  \"a long string to scan in blocks of many bytes\",   1,   2]");
+    return values;
+}
+static const std::string staticValues = readDuringStaticInit();
+
+// Subscribes to all pairs and array items, so that every value is parsed. The values of objects and arrays are null.
+static void subscribeAll(JsonReader& reader, std::string& values)
+{
+    auto append = [&values](const char* value)
+    {
+        values += value ? value : "{}";
+        values += ',';
+    };
+    reader.onPair((const char*)nullptr, append);
+    reader.onArrayItem((const char*)nullptr, append);
+}
+
+static const char* validText = "{\"a\":[true,false,null,\"x\\u00e9\\n\",-1.5e3,{\"c\":\"dd\"}],\"e\":{}}";
+static const char* truncatedTexts[] = {"{\"a\":tr", "{\"a\":nul", "[fals", "{\"a\":\"open", "{\"a\":\"\\u12", "{\"a\":1,\"b", "{\"a\""};
+
+static void testTruncatedSource()
+{
+    std::string expected;
+    JsonReader reader;
+    subscribeAll(reader, expected);
+    CHECK(reader.readBuffer(validText));
+
+    for (size_t blockLen : {1, 2, 3, 7, 64})
+    {
+        std::string values;
+        JsonReader reader;
+        subscribeAll(reader, values);
+        BlockSource source(validText, blockLen);
+        CHECK(reader.readSource(source));
+        CHECK(values == expected);
+
+        // Every prefix of the valid text is truncated.
+        std::string text = validText;
+        for (size_t len = 1; len < text.size(); len++)
+        {
+            BlockSource source(text.substr(0, len), blockLen);
+            subscribeAll(reader, values); // The subscriptions are cleared after each read.
+            CHECK(!reader.readSource(source));
+            CHECK(reader.getErrorCode() != JsonReader::ERROR_NONE);
+        }
+        for (const char* truncated : truncatedTexts)
+        {
+            BlockSource source(truncated, blockLen);
+            subscribeAll(reader, values);
+            CHECK(!reader.readSource(source));
+            CHECK(reader.getErrorCode() == JsonReader::ERROR_UNEXPECTED_END);
+        }
+
+        // The object is closed by a square bracket, which is reported instead of searching for a name up to the end.
+        JsonReader pairReader;
+        pairReader.onPair("b", [](const char*) {});
+        BlockSource malformedSource("[{\"b\":[1]]}", blockLen);
+        CHECK(!pairReader.readSource(malformedSource));
+        CHECK(pairReader.getErrorCode() == JsonReader::ERROR_UNEXPECTED_CHARACTER);
+    }
+}
+
+static void writeFile(const char* fileName, const std::string& text)
+{
+    std::ofstream file(fileName, std::ios::binary);
+    file << text;
+}
+
+static void testTinyFileBuffers()
+{
+    const char* fileName = "TestTinyFileBuffers.json";
+    std::string expected;
+    JsonReader reader;
+    subscribeAll(reader, expected);
+    CHECK(reader.readBuffer(validText));
+
+    // Buffers smaller than the text, with and without reading ahead.
+    for (unsigned numBuffers : {1, 3})
+    {
+        for (size_t bufferLen : {1, 2, 5})
+        {
+            std::string values;
+            JsonReader reader;
+            subscribeAll(reader, values);
+            reader.setFileBuffers(bufferLen, numBuffers);
+            writeFile(fileName, validText);
+            CHECK(reader.readFile(fileName));
+            CHECK(values == expected);
+
+            for (const char* truncated : truncatedTexts)
+            {
+                writeFile(fileName, truncated);
+                subscribeAll(reader, values); // The subscriptions are cleared after each read.
+                CHECK(!reader.readFile(fileName));
+                CHECK(reader.getErrorCode() == JsonReader::ERROR_UNEXPECTED_END);
+            }
+            writeFile(fileName, "{\"a\":\"a long string that does not end");
+            subscribeAll(reader, values);
+            CHECK(!reader.readFile(fileName));
+            CHECK(reader.getErrorCode() == JsonReader::ERROR_UNEXPECTED_END);
+
+            JsonReader pairReader;
+            pairReader.onPair("b", [](const char*) {});
+            pairReader.setFileBuffers(bufferLen, numBuffers);
+            writeFile(fileName, "[{\"b\":[1]]}");
+            CHECK(!pairReader.readFile(fileName));
+            CHECK(pairReader.getErrorCode() == JsonReader::ERROR_UNEXPECTED_CHARACTER);
+        }
+    }
+    std::remove(fileName);
+}
+
+// Reads 'fileName' and returns true if the values passed to the callback pointed to the mapped file, which is
+// the case if their distance is the same as in the text. Otherwise, they are copied as they span several buffers.
+static bool isReadMapped(JsonReader& reader, const char* fileName, bool isIndexed)
+{
+    std::vector<const char*> values;
+    reader.onArrayItem("[", [&](const char* value, size_t) { values.push_back(value); });
+    bool succeeded = isIndexed ? reader.readFileIndexed(fileName) : reader.readFile(fileName);
+    CHECK(succeeded && values.size() == 2);
+    return values.size() == 2 && values[1] - values[0] == 13;
+}
+
+static void testMemoryMapping()
+{
+    const char* fileName = "TestMemoryMapping.json";
+    writeFile(fileName, "[\"abcdefghij\",\"klmnopqrst\"]");
+    JsonReader reader;
+    reader.setFileBuffers(4);
+    CHECK(!isReadMapped(reader, fileName, false));
+    CHECK(isReadMapped(reader, fileName, true)); // An indexed read always maps the file.
+    CHECK(!isReadMapped(reader, fileName, false));
+
+    reader.useMemoryMapping(true);
+    CHECK(isReadMapped(reader, fileName, false));
+    CHECK(isReadMapped(reader, fileName, false));
+    CHECK(isReadMapped(reader, fileName, true));
+    CHECK(isReadMapped(reader, fileName, false));
+    reader.useMemoryMapping(false);
+    CHECK(!isReadMapped(reader, fileName, false));
+    std::remove(fileName);
+}
+
+// Returns a callback that appends the batches it receives to 'batches', as "(1,2)".
+static std::function<void(const int64_t*, size_t)> appendBatches(std::string& batches)
+{
+    return [&batches](const int64_t* values, size_t count)
+    {
+        batches += '(';
+        for (size_t i = 0; i < count; i++)
+            batches += (i > 0 ? "," : "") + std::to_string(values[i]);
+        batches += ')';
+    };
+}
+
+static void testBatches()
+{
+    std::string batches;
+    JsonReader reader;
+    reader.onArrayItemsInt64("[", appendBatches(batches), 3);
+    CHECK(reader.readBuffer("[1,2,3,4,5,6,7,8,9,10]"));
+    CHECK(batches == "(1,2,3)(4,5,6)(7,8,9)(10)");
+
+    // Each array gets its own batches, and the values that do not refer to the input remain valid until passed.
+    std::string items;
+    reader.onArrayItems("[", [&](const JsonReader::ITEM_VALUE* values, size_t count)
+    {
+        items += '(';
+        for (size_t i = 0; i < count; i++)
+        {
+            std::string value = values[i].value ? std::string(values[i].value, values[i].length) : "{}";
+            items += (i > 0 ? "," : "") + (values[i].isQuoted ? '"' + value + '"' : value);
+        }
+        items += ')';
+    }, 2);
+    reader.onArrayItems("[[", [&](const JsonReader::ITEM_VALUE*, size_t count) { items += std::to_string(count); }, 4);
+    CHECK(reader.readBuffer("[\"a\\u00e9\",null,[1,2,3,4,5],true,{\"x\":1},\"b\\n\",-2.5]"));
+    CHECK(items == "(\"a\xc3\xa9\",{})41({},true)({},\"b\n\")(-2.5)");
+
+    // The items pending when the read is stopped are passed, and those pending when it fails are dropped.
+    batches.clear();
+    reader.onArrayItemsInt64("{a[", appendBatches(batches), 10);
+    reader.onPair("{a[{stop", [&](const char*) { reader.stop(); });
+    CHECK(reader.readBuffer("{\"a\":[1,2,{\"stop\":1},4]}"));
+    CHECK(batches == "(1,2)");
+    batches.clear();
+    reader.onArrayItemsInt64("[", appendBatches(batches), 2);
+    CHECK(!reader.readBuffer("[1,2,3,4,5,x]"));
+    CHECK(batches == "(1,2)(3,4)");
+    batches.clear();
+    reader.onArrayItemsInt64("[", appendBatches(batches), 10);
+    CHECK(!reader.readBuffer("[1,2,3"));
+    CHECK(batches.empty());
+
+    // A batch subscribed by a pattern gets its batches although the items are also notified one by one.
+    batches.clear();
+    reader.onArrayItemsInt64("/*/*", appendBatches(batches), 2);
+    reader.onArrayItem("{a[", [&](const char* value) { batches += value; });
+    CHECK(reader.readBuffer("{\"a\":[1,2,3],\"b\":[4,5,6]}"));
+    CHECK(batches == "12(1,2)3(3)(4,5)(6)"); // The path is notified before the pattern.
+}
+
+// Results of reading the items of the array "data", which the threads of a parallel read accumulate separately.
+struct ITEM_TOTALS
+{
+    int64_t sum = 0;
+    size_t numItems = 0;
+    size_t numStrings = 0; // Strings with commas and brackets.
+    size_t numNested = 0;  // Strings with a bracket in nested objects.
+
+    void subscribe(JsonReader& reader)
+    {
+        reader.onPairInt64("{data[{id", [this](int64_t id)
+        {
+            sum += id;
+            numItems++;
+        });
+        reader.onPair("{data[{s", [this](const char* value) { numStrings += strcmp(value, "a,b]") == 0; });
+        reader.onPair("{data[{n{x[{y", [this](const char* value) { numNested += strcmp(value, "}") == 0; });
+    }
+    void add(const ITEM_TOTALS& totals)
+    {
+        sum += totals.sum;
+        numItems += totals.numItems;
+        numStrings += totals.numStrings;
+        numNested += totals.numNested;
+    }
+    bool operator==(const ITEM_TOTALS& totals) const
+    {
+        return sum == totals.sum && numItems == totals.numItems && numStrings == totals.numStrings &&
+               numNested == totals.numNested;
+    }
+};
+
+// Reads the array "data" of 'text' (or of the file 'fileName' if not NULL) with 'numThreads' threads, and returns
+// in 'totals' the results of all of them, and in 'metaId' the value outside the array.
+static bool readParallel(const std::string& text, const char* fileName, unsigned numThreads, ITEM_TOTALS& totals,
+                         std::string& metaId)
+{
+    std::vector<ITEM_TOTALS> threadTotals(numThreads);
+    JsonReader reader;
+    reader.onPair("{meta", [&](const char* value) { metaId = value; });
+    auto setup = [&](JsonReader& threadReader, unsigned thread) { threadTotals[thread].subscribe(threadReader); };
+    bool succeeded = fileName ? reader.readFileParallel(fileName, "{data[", setup, nullptr, numThreads)
+                              : reader.readBufferParallel(text.data(), text.length(), "{data[", setup, nullptr,
+                                                          numThreads);
+    totals = ITEM_TOTALS();
+    for (const ITEM_TOTALS& threadTotal : threadTotals)
+        totals.add(threadTotal);
+    return succeeded;
+}
+
+static void testParallel()
+{
+    std::string text = "{\"data\":[";
+    for (int i = 0; i < 100000; i++)
+        text += "{\"id\":" + std::to_string(i) + ",\"s\":\"a,b]\",\"n\":{\"x\":[{},{\"y\":\"}\"}]}},";
+    text += "{}],\"meta\":\"m\"}";
+
+    ITEM_TOTALS expected;
+    std::string expectedMeta;
+    JsonReader reader;
+    expected.subscribe(reader);
+    reader.onPair("{meta", [&](const char* value) { expectedMeta = value; });
+    CHECK(reader.readBuffer(text.data(), text.length()));
+    CHECK(expected.numItems == 100000 && expected.numStrings == 100000 && expected.numNested == 100000);
+
+    const char* fileName = "TestParallel.json";
+    writeFile(fileName, text);
+    for (unsigned numThreads : {1, 4})
+    {
+        ITEM_TOTALS totals;
+        std::string metaId;
+        CHECK(readParallel(text, nullptr, numThreads, totals, metaId));
+        CHECK(totals == expected && metaId == expectedMeta);
+        CHECK(readParallel(text, fileName, numThreads, totals, metaId));
+        CHECK(totals == expected && metaId == expectedMeta);
+
+        // A truncated array, and an item in the middle of the array closed by a mismatched bracket.
+        CHECK(!readParallel(text.substr(0, text.length() / 2), nullptr, numThreads, totals, metaId));
+        std::string mismatched = text;
+        size_t itemEnd = mismatched.find("}},", mismatched.length() / 2);
+        mismatched[itemEnd + 1] = ']';
+        CHECK(!readParallel(mismatched, nullptr, numThreads, totals, metaId));
+        CHECK(reader.getErrorCode() == JsonReader::ERROR_NONE); // The reader of the sequential read is not affected.
+    }
+    std::remove(fileName);
+}
+
+// Reads 'fileName' through the index 'indexName', subscribing to the ids out of the array "big", which is jumped over.
+static std::string readIndexed(const char* fileName, const char* indexName)
+{
+    std::string ids;
+    JsonReader reader;
+    reader.onPair("{meta{id", [&](const char* value) { ids += value; });
+    reader.onPair("{after", [&](const char* value) { ids += value; });
+    CHECK(reader.readFileIndexed(fileName, indexName));
+    return ids;
+}
+
+static void testIndex()
+{
+    const char* fileName = "TestIndex.json";
+    const char* indexName = "TestIndex.json.jri";
+    std::string big = "[";
+    for (int i = 0; i < 200; i++)
+        big += "{\"id\":" + std::to_string(i) + ",\"meta\":{\"id\":\"inner\"},\"s\":\"a,b]}\"},";
+    big += "{}]";
+    std::string text = "{\"big\":" + big + ",\"meta\":{\"id\":1},\"after\":2}";
+    writeFile(fileName, text);
+    std::remove(indexName);
+    CHECK(readIndexed(fileName, nullptr) == "12"); // Without an index.
+
+    JsonReader writer;
+    std::string ids;
+    writer.onPair("{meta{id", [&](const char* value) { ids += value; });
+    CHECK(writer.writeIndex(fileName));
+    CHECK(ids == "1");
+    std::ifstream index(indexName, std::ios::binary);
+    std::string indexData((std::istreambuf_iterator<char>(index)), std::istreambuf_iterator<char>());
+    index.close();
+    CHECK(indexData.compare(0, 8, std::string("JRIX\x02\0\0\0", 8)) == 0); // Little-endian version.
+    CHECK(indexData.length() > 48);
+    CHECK(readIndexed(fileName, nullptr) == "12");
+
+    // A corrupt or truncated index is ignored.
+    writeFile(indexName, indexData.substr(0, indexData.length() - 5));
+    CHECK(readIndexed(fileName, nullptr) == "12");
+    std::string corrupt = indexData;
+    corrupt[60] ^= 0x55; // An entry's position.
+    writeFile(indexName, corrupt);
+    CHECK(readIndexed(fileName, nullptr) == "12");
+    writeFile(indexName, "JRIX");
+    CHECK(readIndexed(fileName, nullptr) == "12");
+
+    // The file is rewritten with the same size right away, with its members after a shorter array and a closing
+    // bracket where the indexed array ended.
+    writeFile(indexName, indexData);
+    std::string modified = "{\"big\":[],\"meta\":{\"id\":3},\"after\":4,\"pad\":\"";
+    modified += std::string(text.length() - modified.length() - 2, ']') + "\"}";
+    CHECK(modified.length() == text.length());
+    writeFile(fileName, modified);
+    CHECK(readIndexed(fileName, nullptr) == "34");
+    std::remove(fileName);
+    std::remove(indexName);
+}
+
+static void testPool()
+{
+    const char* fileName = "TestPool.json";
+    writeFile(fileName, "[\"abcdefghij\",\"klmnopqrst\"]");
+    JsonReader::CONFIG config;
+    config.fileBufferLen = 4;
+    JsonReader::Pool pool(config, 1);
+    JsonReader* pooled = nullptr;
+    size_t numItems = 0, numPairs = 0;
+    {
+        JsonReader::Pool::Handle reader = pool.acquire();
+        pooled = &*reader;
+        reader->onArrayItem("[", [&](const char*) { numItems++; });
+        CHECK(reader->feed("[1,", 3));
+        CHECK(numItems == 1);
+        reader->useMemoryMapping(true);
+    }
+    {
+        // The text fed by the previous borrower is discarded, along with its callbacks and its settings.
+        JsonReader::Pool::Handle reader = pool.acquire();
+        CHECK(&*reader == pooled);
+        std::string x;
+        reader->onPair("x", [&](const char* value) { x = value; });
+        CHECK(reader->feed("{\"x\":2}", 7));
+        CHECK(reader->finish());
+        CHECK(x == "2" && numItems == 1);
+        CHECK(!isReadMapped(*reader, fileName, false));
+        reader->onPair("x", [&](const char*) { numPairs++; }); // Never read.
+    }
+    {
+        JsonReader::Pool::Handle reader = pool.acquire();
+        CHECK(reader->readBuffer("{\"x\":3}"));
+        CHECK(numPairs == 0);
+    }
+
+    config.useMapping = true;
+    JsonReader::Pool mappingPool(config, 1);
+    {
+        JsonReader::Pool::Handle reader = mappingPool.acquire();
+        CHECK(isReadMapped(*reader, fileName, false));
+        reader->useMemoryMapping(false);
+    }
+    CHECK(isReadMapped(*mappingPool.acquire(), fileName, false));
+    std::remove(fileName);
+}
+
+// Subscribes to a few paths, so that the other values are skipped, and records the events with their paths.
+static void subscribeSome(JsonReader& reader, std::string& events)
+{
+    reader.onObjectBegin("{a[{", [&events, &reader]() { events += reader.getCurrentElementPath() + " begin,"; });
+    reader.onPair("{a[{c", [&events](const char* value) { events += std::string("c=") + value + ','; });
+    reader.onArrayItem("{a[", [&events](const char* value) { events += value ? value : "{}"; });
+    reader.onArrayEnd("a", [&events]() { events += "end,"; });
+    reader.onPair("e", [&events](const char* value) { events += std::string("e=") + (value ? value : "{}") + ','; });
+}
+
+static void testFeed()
+{
+    std::string texts[] = {validText, "[1, 22, 333, \"\\\"x\\\"\", [true, [false]], {\"k\": null}]  ",
+                           "{\"skipped\": [{\"x\": \"}]\"}, [1, 2]], \"a\": [{\"c\": \"\\ud83d\\ude00\"}], \"e\": 1.5}",
+                           "\"root string\"", " -12.5e2 "};
+    for (const std::string& text : texts)
+    {
+        std::string expected, expectedSome;
+        JsonReader reader;
+        subscribeAll(reader, expected);
+        CHECK(reader.readBuffer(text.c_str()));
+        JsonReader someReader;
+        subscribeSome(someReader, expectedSome);
+        CHECK(someReader.readBuffer(text.c_str()));
+
+        for (size_t fragmentLen = 1; fragmentLen <= text.size(); fragmentLen++)
+        {
+            std::string values, events;
+            JsonReader reader, someReader;
+            subscribeAll(reader, values);
+            subscribeSome(someReader, events);
+            for (size_t i = 0; i < text.size(); i += fragmentLen)
+            {
+                // The fragment does not remain valid after 'feed' returns.
+                std::string fragment = text.substr(i, fragmentLen);
+                CHECK(reader.feed(fragment.data(), fragment.size()));
+                CHECK(someReader.feed(fragment.data(), fragment.size()));
+                fragment.assign(fragment.size(), '?');
+            }
+            CHECK(reader.finish());
+            CHECK(someReader.finish());
+            CHECK(values == expected);
+            CHECK(events == expectedSome);
+        }
+    }
+}
+
+static void testTruncatedFeed()
+{
+    std::string texts[] = {"{\"a\":tr", "{\"a\":nul", "{\"a\":\"open", "[1,\"ab", "{\"a\":[1,{\"b\"", "{\"a\":\"\\u12"};
+    for (const std::string& text : texts)
+    {
+        for (size_t fragmentLen = 1; fragmentLen <= text.size(); fragmentLen++)
+        {
+            std::string values;
+            JsonReader reader;
+            subscribeAll(reader, values);
+            for (size_t i = 0; i < text.size(); i += fragmentLen)
+            {
+                std::string fragment = text.substr(i, fragmentLen);
+                CHECK(reader.feed(fragment.data(), fragment.size()));
+            }
+            CHECK(!reader.finish());
+            CHECK(reader.getErrorCode() == JsonReader::ERROR_UNEXPECTED_END);
+        }
+    }
+
+    // The fragments after an error are ignored until 'finish' is called.
+    JsonReader reader;
+    reader.onArrayItem("[", [](const char*) {});
+    CHECK(reader.feed("[1,", 3));
+    CHECK(!reader.feed("x]", 2));
+    CHECK(!reader.feed("[]", 2));
+    CHECK(!reader.finish());
+    CHECK(reader.getErrorCode() == JsonReader::ERROR_UNEXPECTED_CHARACTER);
+    CHECK(reader.feed("[]", 2));
+    CHECK(reader.finish());
+}
+
+static void testFeedThread()
+{
+    // The callbacks are executed by the thread that calls 'feed' and 'finish', which is the current reader's.
+    JsonReader reader;
+    std::thread::id callerId = std::this_thread::get_id();
+    size_t numCalls = 0;
+    reader.onArrayItem("[", [&](const char*)
+    {
+        CHECK(std::this_thread::get_id() == callerId);
+        CHECK(JsonReader::getCurrentReader() == &reader);
+        numCalls++;
+    });
+    CHECK(reader.feed("[1,", 3));
+    CHECK(numCalls == 1);
+    CHECK(JsonReader::getCurrentReader() == nullptr);
+    CHECK(reader.feed("2", 1));
+    CHECK(numCalls == 1); // The number may go on in the next fragment.
+    CHECK(reader.feed("]", 1));
+    CHECK(numCalls == 2);
+    CHECK(reader.finish());
+}
+
+static void testFeedDiscarded()
+{
+    size_t numItems = 0, numBatched = 0;
+    {
+        JsonReader reader;
+        reader.onArrayItem("[", [&](const char*) { numItems++; });
+        CHECK(reader.feed("[1", 2));
+    }
+    CHECK(numItems == 0); // The number could have gone on.
+    {
+        JsonReader reader;
+        reader.onArrayItemsInt64("[", [&](const int64_t*, size_t count) { numBatched += count; }, 10);
+        CHECK(reader.feed("[1,2,3,", 7));
+    }
+    CHECK(numBatched == 0); // The batch was not complete.
+}
+
+// Returns true if subscribing 'pointer' throws an exception.
+static bool isRejected(JsonReader& reader, const char* pointer)
+{
+    try
+    {
+        reader.onPair(pointer, [](const char*) {});
+    }
+    catch (const std::runtime_error&)
+    {
+        return true;
+    }
+    return false;
+}
+
+static void testPointerIndices()
+{
+    JsonReader reader;
+    CHECK(isRejected(reader, "/list/0"));
+    CHECK(isRejected(reader, "/list/12/id"));
+    CHECK(isRejected(reader, "/**/3"));
+    CHECK(!isRejected(reader, "/list/01"));
+    CHECK(!isRejected(reader, "/list/*/id"));
+    CHECK(!isRejected(reader, "/list/x1"));
+
+    // A member named with digits is subscribed by path, and the items of an array with '*'.
+    std::string values;
+    reader.onPair("{codes{404", [&](const char* value) { values += std::string(value) + ','; });
+    reader.onPair("/list/*/id", [&](const char* value) { values += std::string(value) + ','; });
+    CHECK(reader.readBuffer("{\"codes\":{\"404\":\"a\"},\"list\":[{\"id\":1},{\"id\":2}]}"));
+    CHECK(values == "a,1,2,");
+}
+
+static void testOverlappingPatterns()
+{
+    std::string events;
+    JsonReader reader;
+    reader.onPair("{data{*[{id", [&](const char* value) { events += std::string("path:") + value + ','; });
+    reader.onPair("**{id", [&](const char* value) { events += std::string("any:") + value + ','; });
+    reader.onPair("/data/*/*/id", [&](const char* value) { events += std::string("pointer:") + value + ','; });
+    reader.onPair("{data{users[{id", [&](const char* value) { events += std::string("exact:") + value + ','; });
+    reader.onArrayItemsInt64("/data/codes/*", [&](const int64_t* values, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+            events += "batch:" + std::to_string(values[i]) + ',';
+    });
+    reader.onArrayItem("{data{*[", [&](const char* value) { events += std::string("item:") + (value ? value : "{}") + ','; });
+    CHECK(reader.readBuffer("{\"data\":{\"users\":[{\"id\":1}],\"codes\":[7,8]},\"id\":2}"));
+    CHECK(events == "exact:1,path:1,any:1,pointer:1,item:{},item:7,item:8,batch:7,batch:8,any:2,");
+}
+
+struct BOUND
+{
+    std::string name;
+    std::wstring wideName;
+    bool isActive;
+    int id;
+    int8_t small;
+    uint16_t port;
+    int64_t big;
+    double ratio;
+    float weight;
+};
+
+// Returns the error code of a read of 'text' that binds the objects of the array to 'binding'.
+static JsonReader::ERROR_CODE readBound(const JsonReader::Binding<BOUND>& binding, const char* text,
+                                        std::vector<BOUND>& items)
+{
+    JsonReader reader;
+    reader.bind("[{", binding, items);
+    reader.readBuffer(text);
+    return reader.getErrorCode();
+}
+
+static void testBinding()
+{
+    JsonReader::Binding<BOUND> binding;
+    binding.field("name", &BOUND::name).field("wideName", &BOUND::wideName).field("isActive", &BOUND::isActive);
+    binding.field("id", &BOUND::id).field("small", &BOUND::small).field("port", &BOUND::port);
+    binding.field("big", &BOUND::big).field("ratio", &BOUND::ratio).field("weight", &BOUND::weight);
+
+    // Each type of member, with nested values and unknown names being ignored.
+    std::vector<BOUND> items;
+    CHECK(readBound(binding,
+                    "[{\"name\":\"a\\u00e9\",\"wideName\":\"b\\u00e9\",\"isActive\":true,\"id\":-7,\"small\":-128,"
+                    "\"port\":65535,\"big\":-9223372036854775808,\"ratio\":0.5,\"weight\":1.25,\"other\":1,"
+                    "\"list\":[{\"id\":8}],\"sub\":{\"name\":\"c\"}},{\"isActive\":false,\"big\":9223372036854775807}]",
+                    items) == JsonReader::ERROR_NONE);
+    CHECK(items.size() == 2);
+    if (items.size() == 2)
+    {
+        const BOUND& item = items[0];
+        CHECK(item.name == "a\xc3\xa9" && item.wideName == L"b\u00e9" && item.isActive);
+        CHECK(item.id == -7 && item.small == -128 && item.port == 65535 && item.big == INT64_MIN);
+        CHECK(item.ratio == 0.5 && item.weight == 1.25f);
+        CHECK(!items[1].isActive && items[1].big == INT64_MAX && items[1].name.empty() && items[1].id == 0);
+    }
+
+    // Null values leave the members as they were, and a callback receives objects reset to their default values.
+    std::vector<BOUND> nulls;
+    nulls.emplace_back();
+    CHECK(readBound(binding, "[{\"name\":null,\"wideName\":null,\"isActive\":null,\"id\":null,\"ratio\":null}]",
+                    nulls) == JsonReader::ERROR_NONE);
+    CHECK(nulls.size() == 2 && nulls[1].name.empty() && !nulls[1].isActive && nulls[1].id == 0);
+    std::string objects;
+    JsonReader reader;
+    reader.bind("[{", binding, [&](BOUND& object)
+    {
+        objects += object.name + std::to_string(object.id) + ',';
+    });
+    CHECK(reader.readBuffer("[{\"name\":\"x\",\"id\":1},{\"id\":null},{\"name\":null,\"id\":3}]"));
+    CHECK(objects == "x1,0,3,");
+
+    // Numbers out of the range of the member, and values of other types, raise an error.
+    const char* outOfRange[] = {"[{\"small\":128}]", "[{\"small\":-129}]", "[{\"port\":-1}]", "[{\"port\":65536}]",
+                                "[{\"id\":4294967296}]", "[{\"big\":9223372036854775808}]",
+                                "[{\"big\":-9223372036854775809}]"};
+    for (const char* text : outOfRange)
+    {
+        std::vector<BOUND> failed;
+        CHECK(readBound(binding, text, failed) == JsonReader::ERROR_OUT_OF_RANGE);
+    }
+    CHECK(readBound(binding, "[{\"id\":1.5}]", items) == JsonReader::ERROR_NOT_AN_INTEGER);
+    CHECK(readBound(binding, "[{\"id\":\"1\"}]", items) == JsonReader::ERROR_NOT_A_NUMBER);
+    CHECK(readBound(binding, "[{\"isActive\":1}]", items) == JsonReader::ERROR_NOT_A_BOOLEAN);
+
+    // A table grown by many names, some bound to the same member, must still find each one.
+    JsonReader::Binding<BOUND> many;
+    const int numNames = 200;
+    for (int i = 0; i < numNames; i++)
+    {
+        std::string name = "f" + std::to_string(i);
+        if (i % 2 == 0)
+            many.field(name.c_str(), &BOUND::id);
+        else
+            many.field(name.c_str(), &BOUND::big);
+    }
+    many.field("f0", &BOUND::big); // Replaces the member of an existing name.
+    std::string text = "[";
+    for (int i = 0; i < numNames; i++)
+        text += "{\"f" + std::to_string(i) + "\":" + std::to_string(i + 1) + ",\"g" + std::to_string(i) + "\":-1},";
+    text += "{\"f" + std::to_string(numNames) + "\":1}]";
+    std::vector<BOUND> found;
+    CHECK(readBound(many, text.c_str(), found) == JsonReader::ERROR_NONE);
+    CHECK(found.size() == numNames + 1);
+    for (int i = 0; i < numNames && i < (int)found.size(); i++)
+    {
+        bool isBig = (i % 2 == 1 || i == 0);
+        CHECK(found[i].id == (isBig ? 0 : i + 1) && found[i].big == (isBig ? i + 1 : 0));
+    }
+    if (found.size() == numNames + 1)
+        CHECK(found[numNames].id == 0 && found[numNames].big == 0);
+}
+
+static void testMaxDepth()
+{
+    // The limit counts the objects and arrays that enclose a value, and it is kept across reads.
+    const char* text = "{\"a\":[{\"b\":[1]}],\"c\":2}";
+    std::string values;
+    JsonReader reader;
+    reader.setMaxDepth(4);
+    reader.onArrayItem("{a[{b[", [&](const char* value) { values += value; });
+    CHECK(reader.readBuffer(text));
+    reader.setMaxDepth(3);
+    reader.onArrayItem("{a[{b[", [&](const char* value) { values += value; });
+    reader.onPair("{c", [&](const char* value) { values += value; });
+    CHECK(!reader.readBuffer(text));
+    CHECK(values == "1");
+    CHECK(reader.getErrorCode() == JsonReader::ERROR_MAX_DEPTH);
+    CHECK(reader.getErrorDescription().find("The nesting depth exceeds the maximum of 3.") == 0);
+    reader.onArrayItem("{a[{b[", [&](const char* value) { values += value; });
+    CHECK(reader.feed(text, 10) && !reader.feed(text + 10, strlen(text) - 10)); // The limit is reached in the second.
+    CHECK(!reader.finish());
+    CHECK(reader.getErrorCode() == JsonReader::ERROR_MAX_DEPTH);
+    reader.setMaxDepth(0);
+    reader.onArrayItem("{a[{b[", [&](const char* value) { values += value; });
+    CHECK(reader.readBuffer(text));
+    CHECK(values == "11");
+
+    // Deeply nested values are parsed without recursion, whether they are skipped or not. A member subscribed by name
+    // may be anywhere, so nothing is skipped, as the maximum depth shows.
+    const size_t depth = 100000;
+    std::string texts[2] = {std::string(depth, '[') + "1" + std::string(depth, ']'), ""};
+    for (size_t i = 0; i < depth; i++)
+        texts[1] += "{\"a\":";
+    texts[1] += "2" + std::string(depth, '}');
+    values.clear();
+    for (const std::string& deepText : texts)
+    {
+        CHECK(reader.readBuffer(deepText.c_str()));
+        reader.setMaxDepth(depth);
+        reader.onPair("a", [&](const char* value) { values += value; });
+        CHECK(reader.readBuffer(deepText.c_str()));
+        reader.setMaxDepth(depth - 1);
+        reader.onPair("a", [&](const char* value) { values += value; });
+        CHECK(!reader.readBuffer(deepText.c_str()) && reader.getErrorCode() == JsonReader::ERROR_MAX_DEPTH);
+        reader.setMaxDepth(0);
+    }
+    CHECK(values == "2");
+}
+
+// Returns the error code of a read of 'text' that converts its items to doubles, appending them to 'values'.
+static JsonReader::ERROR_CODE readDoubles(const char* text, std::vector<double>& values)
+{
+    JsonReader reader;
+    reader.onArrayItemDouble("[", [&](double value) { values.push_back(value); });
+    reader.readBuffer(text);
+    return reader.getErrorCode();
+}
+
+static JsonReader::ERROR_CODE readInt64(const char* text, int64_t& value)
+{
+    JsonReader reader;
+    reader.onPairInt64("{a", [&](int64_t number) { value = number; });
+    reader.readBuffer(text);
+    return reader.getErrorCode();
+}
+
+static void testTypedNumbers()
+{
+    // Numbers that are correctly rounded only if the conversion does not rely on the fast path, including one too
+    // long to be copied into the buffer of the conversion.
+    std::string longNumber = "0." + std::string(70, '0') + "1e71";
+    std::string text = "[0.1,1e23,9007199254740993,2.2250738585072011e-308,4.9e-324,1.7976931348623157e308,-1e-400,"
+                       "123456789012345678901234567890," + longNumber + "]";
+    std::vector<double> values;
+    CHECK(readDoubles(text.c_str(), values) == JsonReader::ERROR_NONE);
+    CHECK(values.size() == 9);
+    if (values.size() == 9)
+    {
+        CHECK(values[0] == 0.1 && values[1] == 1e23 && values[2] == 9007199254740992.0);
+        CHECK(values[3] == DBL_MIN - 4.9406564584124654e-324 && values[4] == 4.9406564584124654e-324);
+        CHECK(values[5] == DBL_MAX && values[6] == 0.0 && std::signbit(values[6]));
+        CHECK(values[7] == 1.2345678901234568e29 && values[8] == 1.0);
+    }
+    const char* overflows[] = {"[1e400]", "[-1e400]", "[1.7976931348623159e308]"};
+    for (const char* overflow : overflows)
+        CHECK(readDoubles(overflow, values) == JsonReader::ERROR_OUT_OF_RANGE);
+
+    // The limits of int64_t, and the numbers beyond them.
+    int64_t value = 0;
+    CHECK(readInt64("{\"a\":-9223372036854775808}", value) == JsonReader::ERROR_NONE && value == INT64_MIN);
+    CHECK(readInt64("{\"a\":9223372036854775807}", value) == JsonReader::ERROR_NONE && value == INT64_MAX);
+    CHECK(readInt64("{\"a\":-0}", value) == JsonReader::ERROR_NONE && value == 0);
+    CHECK(readInt64("{\"a\":-9223372036854775809}", value) == JsonReader::ERROR_OUT_OF_RANGE);
+    CHECK(readInt64("{\"a\":9223372036854775808}", value) == JsonReader::ERROR_OUT_OF_RANGE);
+    CHECK(readInt64("{\"a\":92233720368547758070}", value) == JsonReader::ERROR_OUT_OF_RANGE);
+    CHECK(readInt64("{\"a\":1e2}", value) == JsonReader::ERROR_NOT_AN_INTEGER);
+}
+
+#ifdef JSONREADER_ZSTD
+// Text compressed by 'zstd -19' in two frames, the first one ending in the middle of a string (see 'getZstdText').
+static const unsigned char zstdData[] = {
+    0x28, 0xB5, 0x2F, 0xFD, 0x64, 0xFC, 0xD1, 0x7D, 0x01, 0x00, 0x54, 0x02, 0x5B, 0x7B, 0x22, 0x69, 0x64, 0x22,
+    0x3A, 0x31, 0x2C, 0x22, 0x6E, 0x61, 0x6D, 0x65, 0x22, 0x3A, 0x22, 0x63, 0x61, 0x66, 0x5C, 0x75, 0x30, 0x30,
+    0x65, 0x39, 0x20, 0x61, 0x75, 0x20, 0x6C, 0x61, 0x69, 0x74, 0x22, 0x7D, 0x2C, 0x01, 0x00, 0xA5, 0x96, 0x1E,
+    0x5D, 0x3D, 0x01, 0x57, 0x51, 0xF2, 0xD3, 0x28, 0xB5, 0x2F, 0xFD, 0x64, 0xEE, 0xD1, 0x8D, 0x01, 0x00, 0x74,
+    0x02, 0x6D, 0x65, 0x22, 0x3A, 0x22, 0x63, 0x61, 0x66, 0x5C, 0x75, 0x30, 0x30, 0x65, 0x39, 0x20, 0x61, 0x75,
+    0x20, 0x6C, 0x61, 0x69, 0x74, 0x22, 0x7D, 0x2C, 0x7B, 0x22, 0x69, 0x64, 0x22, 0x3A, 0x31, 0x2C, 0x22, 0x6E,
+    0x61, 0x32, 0x7D, 0x5D, 0x01, 0x00, 0x24, 0x96, 0x1E, 0x5D, 0x3D, 0x01, 0x43, 0x5F, 0xA7, 0x42};
+static const size_t zstdFirstFrameLen = 61;
+
+static std::string getZstdText()
+{
+    std::string text = "[";
+    for (int i = 0; i < 3000; i++)
+        text += "{\"id\":1,\"name\":\"caf\\u00e9 au lait\"},";
+    return text + "{\"id\":2}]";
+}
+
+static void testZstd()
+{
+    const char* fileName = "TestZstd.json.zst";
+    std::string text = getZstdText();
+    std::string expected;
+    JsonReader reader;
+    subscribeAll(reader, expected);
+    CHECK(reader.readBuffer(text.c_str()));
+
+    for (size_t bufferLen : {(size_t)16, (size_t)65536})
+    {
+        std::string values;
+        JsonReader reader;
+        subscribeAll(reader, values);
+        reader.setFileBuffers(bufferLen, 1);
+        writeFile(fileName, std::string((const char*)zstdData, sizeof(zstdData)));
+        CHECK(reader.readFile(fileName));
+        CHECK(values == expected);
+
+        // The same data through a Source.
+        values.clear();
+        subscribeAll(reader, values); // The subscriptions are cleared after each read.
+        std::ifstream file(fileName, std::ios::binary);
+        JsonReader::ZstdSource source(file, sizeof(zstdData));
+        CHECK(reader.readSource(source));
+        CHECK(values == expected);
+
+        // The first frame is complete but the text is not.
+        writeFile(fileName, std::string((const char*)zstdData, zstdFirstFrameLen));
+        subscribeAll(reader, values);
+        CHECK(!reader.readFile(fileName));
+        CHECK(reader.getErrorCode() == JsonReader::ERROR_UNEXPECTED_END);
+        // Frames truncated before the end of their text. A truncated checksum after the end of the text is not read.
+        for (size_t len : {(size_t)20, zstdFirstFrameLen - 1, sizeof(zstdData) - 5, sizeof(zstdData) - 12})
+        {
+            writeFile(fileName, std::string((const char*)zstdData, len));
+            subscribeAll(reader, values);
+            CHECK(!reader.readFile(fileName));
+            CHECK(reader.getErrorCode() == JsonReader::ERROR_INVALID_COMPRESSED_DATA);
+        }
+    }
+    std::remove(fileName);
+}
+#endif
+
+int main()
+{
+    CHECK(staticValues == "a long string to scan in blocks of many bytes12");
+    testTruncatedSource();
+    testTinyFileBuffers();
+    testMemoryMapping();
+    testBatches();
+    testParallel();
+    testIndex();
+    testPool();
+    testFeed();
+    testTruncatedFeed();
+    testFeedThread();
+    testFeedDiscarded();
+    testPointerIndices();
+    testOverlappingPatterns();
+    testBinding();
+    testMaxDepth();
+    testTypedNumbers();
+#ifdef JSONREADER_ZSTD
+    testZstd();
+#endif
+
+    if (numFailures == 0)
+        std::cout << "All tests passed" << std::endl;
+    return numFailures == 0 ? 0 : 1;
+}